@@ -0,0 +1,59 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file 3d_model_info.h
+ * defines the model summary returned by the optional
+ * GetModelInfo() function of 3D plugins.
+ */
+
+#ifndef MODEL_INFO_3D_H
+#define MODEL_INFO_3D_H
+
+// maximum number of distinct colors reported by GetModelInfo()
+#define S3D_INFO_MAX_COLORS 16
+
+/**
+ * Struct S3D_MODEL_INFO
+ * summarizes a model without the cost of creating a SCENEGRAPH
+ */
+struct S3D_MODEL_INFO
+{
+    double       m_BBoxMin[3];      // lower bound of the model extents
+    double       m_BBoxMax[3];      // upper bound of the model extents
+    unsigned int m_Solids;          // number of solid instances
+    unsigned int m_Faces;           // number of face instances
+    unsigned int m_EstTriangles;    // estimated triangle count of a full Load()
+    unsigned int m_ColorsSize;      // number of valid entries in m_Colors
+    float        m_Colors[S3D_INFO_MAX_COLORS][3];  // distinct RGB colors
+
+    // statistics of the most recent Load() of the model; these are only
+    // valid if m_Loaded is set
+    bool         m_Loaded;          // the model has been loaded in its current form
+    unsigned int m_MeshedFaces;     // faces tessellated
+    unsigned int m_SlowFaces;       // faces which exceeded the per-face time budget
+    unsigned int m_CoarseFaces;     // faces tessellated more coarsely than requested
+    unsigned int m_ProxyFaces;      // faces replaced by their bounding box
+};
+
+#endif  // MODEL_INFO_3D_H
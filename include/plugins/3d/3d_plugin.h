@@ -39,11 +39,12 @@
 // Note: the plugin class name must match the name expected by the loader
 #define KICAD_PLUGIN_CLASS "PLUGIN_3D"
 #define MAJOR 1
-#define MINOR 0
+#define MINOR 1
 #define REVISION 0
 #define PATCH 0
 
 #include "../kicad_plugin.h"
+#include "3d_model_info.h"
 
 
 KICAD_PLUGIN_EXPORT char const* GetKicadPluginClass( void )
@@ -135,4 +136,20 @@ KICAD_PLUGIN_EXPORT bool CanRender( void );
  */
 KICAD_PLUGIN_EXPORT SCENEGRAPH* Load( char const* aFileName );
 
+/**
+ * Function GetModelInfo
+ * reads the model file and determines its extents, the number of solids
+ * and faces, an estimate of the triangle count and the colors in use
+ * without tessellating the model or building a scene graph. If the model
+ * has been loaded the statistics of its tessellation, such as the number of
+ * faces which were coarsened or replaced to stay within the time budget,
+ * are included. This function is optional (class version 1.1); the caller
+ * must check for its presence.
+ *
+ * @param aFileName is the full path of the model file
+ * @param aInfo receives the model summary
+ * @return true if the model was successfully read
+ */
+KICAD_PLUGIN_EXPORT bool GetModelInfo( char const* aFileName, S3D_MODEL_INFO* aInfo );
+
 #endif  // PLUGIN_3D_H
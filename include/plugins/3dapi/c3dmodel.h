@@ -63,6 +63,8 @@ typedef struct
 ///     m_Texcoords can be NULL, textures will not be applied in that case
 ///     m_Color can be NULL, it will use the m_Diffuse color for every triangle
 ///     any m_FaceIdx must be an index of a the element lists
+///     exactly one of m_FaceIdx and m_FaceIdx16 is not NULL; m_FaceIdx16 is
+///     only used if requested (S3D::GETMODEL_INDEX16) and m_VertexSize <= 65536
 ///     m_MaterialIdx must be an existent material index stored in the parent model
 /// SCALES:
 /// m_Positions units are in mm, example:
@@ -80,12 +82,32 @@ typedef struct
     SFVEC3F        *m_Normals;      ///< Vertex normals array
     SFVEC2F        *m_Texcoords;    ///< Vertex texture coordinates array, can be NULL
     SFVEC3F        *m_Color;        ///< Vertex color array, can be NULL
-    unsigned int    m_FaceIdxSize;  ///< Number of elements of the m_FaceIdx array
-    unsigned int   *m_FaceIdx;      ///< Triangle Face Indexes
+    unsigned int    m_FaceIdxSize;  ///< Number of elements of the m_FaceIdx or m_FaceIdx16 array
+    unsigned int   *m_FaceIdx;      ///< Triangle Face Indexes, NULL if m_FaceIdx16 is used
     unsigned int    m_MaterialIdx;  ///< Material Index to be used in this mesh (must be < m_MaterialsSize )
+    SFVEC3F         m_BBoxMin;      ///< Lower corner of the bounding box of m_Positions
+    SFVEC3F         m_BBoxMax;      ///< Upper corner of the bounding box of m_Positions
+    unsigned short *m_FaceIdx16;    ///< 16 bit Triangle Face Indexes replacing m_FaceIdx, can be NULL
 } SMESH;
 
 
+/// Line segment structure, typically the feature edges of a model.
+/// CONDITIONS:
+///     m_LineIdx holds index pairs; each pair describes one segment
+///     any m_LineIdx must be an index of m_Positions
+///     m_MaterialIdx must be an existent material index stored in the parent model
+/// SCALES:
+/// m_Positions units are in mm as per SMESH
+typedef struct
+{
+    unsigned int    m_VertexSize;   ///< Number of vertex in the array
+    SFVEC3F        *m_Positions;    ///< Vertex position array
+    unsigned int    m_LineIdxSize;  ///< Number of elements of the m_LineIdx array
+    unsigned int   *m_LineIdx;      ///< Segment Indexes (pairs)
+    unsigned int    m_MaterialIdx;  ///< Material Index to be used for these lines
+} SLINES;
+
+
 /// Store the a model based on meshes and materials
 typedef struct
 {
@@ -94,6 +116,12 @@ typedef struct
 
     unsigned int    m_MaterialsSize;    ///< Number of materials in the material array
     SMATERIAL      *m_Materials;        ///< The materials list of this model
+
+    unsigned int    m_LinesSize;        ///< Number of line sets in the array
+    SLINES         *m_Lines;            ///< The feature edge lines of this model, can be NULL
+
+    SFVEC3F         m_BBoxMin;          ///< Lower corner of the bounding box of all meshes and lines
+    SFVEC3F         m_BBoxMax;          ///< Upper corner of the bounding box of all meshes and lines
 } S3DMODEL;
 
 #endif // C3DMODEL_H
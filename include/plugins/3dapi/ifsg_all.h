@@ -34,4 +34,5 @@
 #include "plugins/3dapi/ifsg_coordindex.h"
 #include "plugins/3dapi/ifsg_normals.h"
 #include "plugins/3dapi/ifsg_shape.h"
+#include "plugins/3dapi/ifsg_lineset.h"
 #include "plugins/3dapi/ifsg_api.h"
@@ -35,6 +35,7 @@
 
 class SGNODE;
 class SCENEGRAPH;
+class SGBVH;
 struct S3D_INFO;
 struct S3D_POINT;
 
@@ -100,7 +101,8 @@ namespace S3D
     // NOTE: The following functions are used in combination to create a VRML
     // assembly which may use various instances of each SG* representation of a module.
     // A typical use case would be:
-    // 1. invoke 'ResetNodeIndex()' to reset the global node name indices
+    // 1. invoke 'ResetNodeIndex()' to reset the node name indices of the calling thread;
+    //    steps 1, 2 and 6 must all be performed on the same thread
     // 2. for each model pointer provided by 'S3DCACHE->Load()', invoke 'RenameNodes()' once;
     //    this ensures that all nodes have a unique name to present to the final output file.
     //    Internally, RenameNodes() will only rename the given node and all Child subnodes;
@@ -123,7 +125,7 @@ namespace S3D
 
     /**
      * Function ResetNodeIndex
-     * resets the global SG* class indices
+     * resets the SG* class indices of the calling thread
      *
      * @param aNode may be any valid SGNODE
      */
@@ -132,7 +134,7 @@ namespace S3D
     /**
      * Function RenameNodes
      * renames a node and all children nodes based on the current
-     * values of the global SG* class indices
+     * values of the SG* class indices of the calling thread
      *
      * @param aNode is a top level node
      */
@@ -146,6 +148,134 @@ namespace S3D
      */
     SGLIB_API void DestroyNode( SGNODE* aNode );
 
+    /**
+     * Function BeginArena
+     * directs the allocation of all SG* nodes subsequently created on the
+     * calling thread into a new arena of large memory blocks; the arena
+     * stays in use until EndArena() is invoked. The memory of the arena is
+     * released as a whole once all of its nodes have been deleted, which
+     * makes the creation and destruction of large scenes much cheaper.
+     * Only the node objects are placed in the arena; the geometry arrays
+     * of the nodes are still allocated and freed individually. Calls may
+     * be nested; use ARENA_SCOPE to ensure that the arena is ended when
+     * an exception is thrown.
+     */
+    SGLIB_API void BeginArena( void );
+
+    /**
+     * Function EndArena
+     * stops the allocation of nodes from the arena created by the
+     * matching call to BeginArena(); nodes already created remain valid.
+     */
+    SGLIB_API void EndArena( void );
+
+    /**
+     * Class ARENA_SCOPE
+     * keeps a new arena active on the calling thread for the lifetime of
+     * the object (see BeginArena())
+     */
+    class ARENA_SCOPE
+    {
+    private:
+        ARENA_SCOPE( const ARENA_SCOPE& );
+        ARENA_SCOPE& operator=( const ARENA_SCOPE& );
+
+    public:
+        ARENA_SCOPE() { BeginArena(); }
+        ~ARENA_SCOPE() { EndArena(); }
+    };
+
+    /**
+     * Function FlattenTransforms
+     * reduces the depth of the transform hierarchy below the given
+     * transform node by merging identity and rigid single-child transforms;
+     * if aBakeGeometry is true, rigid transforms are also applied directly
+     * to geometry which is not shared with any other node; vertex arrays
+     * shared between shapes of the same transform remain shared and a
+     * transform whose arrays are shared beyond it is kept. The resulting
+     * scene renders identically but requires far fewer matrix operations
+     * during GetModel().
+     *
+     * @param aNode is a top level transform node
+     * @param aBakeGeometry enables baking of transforms into vertex data
+     */
+    SGLIB_API void FlattenTransforms( SGNODE* aNode, bool aBakeGeometry );
+
+    // size of a scene or part of a scene as reported by GetSceneStats()
+    struct SCENESTATS
+    {
+        SGNODE* m_Node;                 // the node which was examined
+        size_t  m_Nodes[SGTYPE_END];    // number of distinct nodes of each type
+        size_t  m_References;           // number of links to nodes held by reference (USE)
+
+        // stored data; data shared by several nodes is counted once
+        size_t  m_Vertices;             // face and line vertices
+        size_t  m_Normals;
+        size_t  m_Colors;
+        size_t  m_Indices;              // face and line indices
+
+        // data as it is rendered, that is with every reference expanded
+        size_t  m_InstancedVertices;
+        size_t  m_InstancedIndices;
+
+        // memory in bytes
+        size_t  m_NodeBytes;            // the nodes themselves
+        size_t  m_VertexBytes;
+        size_t  m_NormalBytes;
+        size_t  m_ColorBytes;
+        size_t  m_IndexBytes;
+        size_t  m_PreparedBytes;        // meshes kept by shapes for GetModel()
+    };
+
+    /**
+     * Function GetSceneStats
+     * reports the number of nodes, the amount of geometry and the memory
+     * used by the tree below aNode. Nodes and data which are reached more
+     * than once through references are counted once in the totals. If
+     * aChildren is not NULL it receives one entry for each node linked to
+     * aNode, owned nodes first, describing the subtree of that node alone;
+     * data shared between the subtrees is counted in every subtree using it.
+     *
+     * @param aNode is the node to examine, typically a top level transform
+     * @param aTotal receives the totals for the whole tree
+     * @param aChildren is NULL or a caller allocated array which receives
+     * the totals per subtree
+     * @param aNumChildren is NULL if aChildren is NULL; otherwise it holds the
+     * size of aChildren and receives the number of nodes linked to aNode.
+     * If that number exceeds the size of the array only the first entries
+     * are filled; a call with aChildren set to NULL and aNumChildren not NULL
+     * only retrieves the number.
+     * @return false if aNode is NULL
+     */
+    SGLIB_API bool GetSceneStats( SGNODE* aNode, SCENESTATS& aTotal,
+        SCENESTATS* aChildren, size_t* aNumChildren );
+
+    /**
+     * Function MergeDuplicates
+     * finds coordinate, normal, color and appearance nodes with identical
+     * content within the tree below aNode and replaces all but one of each
+     * set by a reference to the remaining node; identical coordinate index
+     * lists are made to share one copy of their data. The scene renders
+     * identically afterwards. Wrappers of removed nodes are invalidated.
+     *
+     * @param aNode is the node to examine, typically a top level transform
+     * @return the number of bytes of node and geometry data released
+     */
+    SGLIB_API size_t MergeDuplicates( SGNODE* aNode );
+
+    /**
+     * Function RemoveDegenerateFaces
+     * removes the triangles with repeated vertices or zero area and the
+     * repeated triangles from every face set within the tree below aNode.
+     * Vertices which are then unused are removed from coordinate nodes
+     * whose data is held by a single face set.
+     *
+     * @param aNode is the node to examine, typically a top level transform
+     * @param aVertices optionally receives the number of vertices removed
+     * @return the number of triangles removed
+     */
+    SGLIB_API size_t RemoveDegenerateFaces( SGNODE* aNode, size_t* aVertices );
+
     // NOTE: The following functions facilitate the creation and destruction
     // of data structures for rendering
 
@@ -158,6 +288,28 @@ namespace S3D
      */
     SGLIB_API S3DMODEL* GetModel( SCENEGRAPH* aNode );
 
+    /**
+     * Function GetModel
+     * creates an S3DMODEL representation of aNode with the given options.
+     * With GETMODEL_KEEP_PREPARED the prepared geometry of each shape is
+     * retained so that repeated calls do not recompute the meshes of shapes
+     * which did not change since the last call. Only that per-shape work is
+     * saved: every call still visits all nodes of the scene and the returned
+     * model is always a new, independent copy of the retained meshes. The
+     * retained geometry occupies as much memory as the returned model; it is
+     * released by the next call without that flag. Retained entries which a
+     * call from the same aNode no longer used are discarded; calls from
+     * other top level nodes sharing the shapes do not discard them.
+     * With GETMODEL_INDEX16 every mesh of at most 65536 vertices holds its
+     * indices in m_FaceIdx16 instead of m_FaceIdx, which is then NULL; the
+     * caller must be prepared to read either array.
+     *
+     * @param aNode is the node to be transcribed into an S3DMODEL representation
+     * @param aFlags is a combination of S3D::GETMODEL_FLAGS values
+     * @return an S3DMODEL representation of aNode on success, otherwise NULL
+     */
+    SGLIB_API S3DMODEL* GetModel( SCENEGRAPH* aNode, unsigned int aFlags );
+
     /**
      * Function Destroy3DModel
      * frees memory used by an S3DMODEL structure and sets the pointer to
@@ -194,6 +346,84 @@ namespace S3D
      * creates and initializes an SMESH struct
      */
     SGLIB_API void Init3DMesh( SMESH& aMesh );
+
+    // NOTE: The following functions provide ray queries on the
+    // triangles of a model for ray tracing and picking
+
+    // the result of a ray query on an SGBVH
+    struct BVHHIT
+    {
+        float        m_Distance;    // distance along the ray in units of the ray direction
+        unsigned int m_MeshIdx;     // index of the mesh within the S3DMODEL
+        unsigned int m_TriangleIdx; // index of the triangle within the mesh (m_FaceIdx or m_FaceIdx16 / 3)
+        float        m_U;           // barycentric coordinates of the hit within the triangle
+        float        m_V;
+    };
+
+    /**
+     * Function BuildBVH
+     * creates a bounding volume hierarchy over the triangles of the given
+     * model; the mesh and triangle indices reported by queries refer to
+     * aModel. The hierarchy does not refer to aModel once built.
+     *
+     * @return the hierarchy or NULL if the model holds no triangles
+     */
+    SGLIB_API SGBVH* BuildBVH( const S3DMODEL* aModel );
+
+    /**
+     * Function BuildBVH
+     * creates a bounding volume hierarchy over the triangles of the model
+     * which GetModel() creates from aNode; the mesh and triangle indices
+     * reported by queries refer to that model.
+     */
+    SGLIB_API SGBVH* BuildBVH( SCENEGRAPH* aNode );
+
+    /**
+     * Function IntersectBVH
+     * finds the nearest triangle hit by a ray
+     *
+     * @param aOrigin is the start of the ray
+     * @param aDirection is the direction of the ray; it need not be normalized
+     * @param aMaxDistance is the length of the ray in units of aDirection
+     * @param aHit receives the nearest hit
+     * @return true if any triangle was hit
+     */
+    SGLIB_API bool IntersectBVH( const SGBVH* aBVH, const SFVEC3F& aOrigin,
+        const SFVEC3F& aDirection, float aMaxDistance, BVHHIT& aHit );
+
+    /**
+     * Function OccludedBVH
+     * returns true if any triangle is hit by the ray; this is cheaper
+     * than IntersectBVH() since the search ends at the first hit.
+     */
+    SGLIB_API bool OccludedBVH( const SGBVH* aBVH, const SFVEC3F& aOrigin,
+        const SFVEC3F& aDirection, float aMaxDistance );
+
+    /**
+     * Function WriteBVH
+     * writes the hierarchy to a binary file; it is intended to be stored
+     * alongside the cache file of the model so that it need not be rebuilt
+     * when the cache is read back.
+     *
+     * @param aFileName is the name of the file to write
+     * @param overwrite must be set to true to overwrite an existing file
+     * @return true on success
+     */
+    SGLIB_API bool WriteBVH( const char* aFileName, bool overwrite, const SGBVH* aBVH );
+
+    /**
+     * Function ReadBVH
+     * reads a hierarchy written by WriteBVH()
+     *
+     * @return the hierarchy or NULL on failure
+     */
+    SGLIB_API SGBVH* ReadBVH( const char* aFileName );
+
+    /**
+     * Function DestroyBVH
+     * frees a hierarchy and sets the pointer to NULL
+     */
+    SGLIB_API void DestroyBVH( SGBVH** aBVH );
 };
 
 #endif  // IFSG_API_H
@@ -53,6 +53,16 @@ public:
     bool SetColorList( size_t aListSize, const SGCOLOR* aColorList );
     bool AddColor( double aRedValue, double aGreenValue, double aBlueValue );
     bool AddColor( const SGCOLOR& aColor );
+
+    /**
+     * Function ShareColorList
+     * makes this node refer to the color data held by aSource rather than
+     * holding a copy; the data is shared until either node modifies it.
+     *
+     * @param aSource [in] the node which holds the data to be shared
+     * @return true on success
+     */
+    bool ShareColorList( IFSG_COLORS& aSource );
 };
 
 #endif  // IFSG_COLORS_H
@@ -30,7 +30,9 @@
 #ifndef IFSG_COORDS_H
 #define IFSG_COORDS_H
 
+#include <vector>
 #include "plugins/3dapi/ifsg_node.h"
+#include "plugins/3dapi/c3dmodel.h"
 
 
 /**
@@ -52,6 +54,41 @@ public:
     bool SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList );
     bool AddCoord( double aXValue, double aYValue, double aZValue );
     bool AddCoord( const SGPOINT& aPoint );
+
+    /**
+     * Function SetSinglePrecision
+     * selects single precision (float) storage for the vertices rather
+     * than the default double precision; this halves the memory used by
+     * the vertices, which are converted to float by GetModel() in any case.
+     * Existing vertices are converted.
+     */
+    bool SetSinglePrecision( bool aSinglePrecision );
+    bool IsSinglePrecision( void );
+
+    // single precision accessors; setting a list selects single precision storage
+    bool GetCoordsList( size_t& aListSize, SFVEC3F*& aCoordsList );
+    bool SetCoordsList( size_t aListSize, const SFVEC3F* aCoordsList );
+
+    /**
+     * Function TakeCoordsList
+     * transfers the contents of the given list to the node without copying
+     * the data; the storage precision is set to match the type of the list.
+     * On success aCoordsList is left empty.
+     *
+     * @param aCoordsList [in,out] the vertex data to be adopted
+     */
+    bool TakeCoordsList( std::vector< SGPOINT >& aCoordsList );
+    bool TakeCoordsList( std::vector< SFVEC3F >& aCoordsList );
+
+    /**
+     * Function ShareCoordsList
+     * makes this node refer to the vertex data held by aSource rather than
+     * holding a copy; the data is shared until either node modifies it.
+     *
+     * @param aSource [in] the node which holds the data to be shared
+     * @return true on success
+     */
+    bool ShareCoordsList( IFSG_COORDS& aSource );
 };
 
 #endif  // IFSG_COORDS_H
@@ -48,7 +48,30 @@ public:
     bool NewNode( SGNODE* aParent );
     bool NewNode( IFSG_NODE& aParent );
 
+    /**
+     * Function CalcNormals
+     * creates per-vertex normals from the triangles which use the
+     * coordinates of this faceset unless the faceset already has normals.
+     * A faceset without normals is still valid; its normals are then
+     * calculated from its own triangles when the model is prepared.
+     *
+     * The triangle normals are weighted by the area of the triangles.
+     *
+     * @param aPtr optionally receives the new normals node
+     * @return true if the faceset has normals
+     */
     bool CalcNormals( SGNODE** aPtr );
+
+    /**
+     * Function CalcNormals
+     * creates per-vertex normals as above with the given weighting
+     * of the triangle normals
+     *
+     * @param aPtr optionally receives the new normals node
+     * @param aWeight selects the weighting of the triangle normals
+     * @return true if the faceset has normals
+     */
+    bool CalcNormals( SGNODE** aPtr, S3D::NORMALWEIGHT aWeight );
 };
 
 #endif  // IFSG_FACESET_H
@@ -30,6 +30,7 @@
 #ifndef IFSG_INDEX_H
 #define IFSG_INDEX_H
 
+#include <vector>
 #include "plugins/3dapi/ifsg_node.h"
 
 
@@ -66,6 +67,35 @@ public:
      * @param aIndexList [in] the index data
      */
     bool AddIndex( int aIndex );
+
+    /**
+     * Function AddIndices
+     * appends a block of indices to the list
+     *
+     * @param nIndices [in] the number of indices to be appended
+     * @param aIndexList [in] the index data
+     */
+    bool AddIndices( size_t nIndices, const int* aIndexList );
+
+    /**
+     * Function TakeIndices
+     * transfers the contents of the given list to the node; indices which
+     * all fit 16 bits are stored at that width, otherwise the data is adopted
+     * without copying. On success aIndexList is left empty.
+     *
+     * @param aIndexList [in,out] the index data to be adopted
+     */
+    bool TakeIndices( std::vector< int >& aIndexList );
+
+    /**
+     * Function ShareIndices
+     * makes this node refer to the index data held by aSource rather than
+     * holding a copy; the data is shared until either node modifies it.
+     *
+     * @param aSource [in] the node which holds the data to be shared
+     * @return true on success
+     */
+    bool ShareIndices( IFSG_INDEX& aSource );
 };
 
 #endif  // IFSG_INDEX_H
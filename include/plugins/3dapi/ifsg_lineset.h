@@ -0,0 +1,75 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file ifsg_lineset.h
+ * defines the line set (feature edges) wrapper
+ */
+
+
+#ifndef IFSG_LINESET_H
+#define IFSG_LINESET_H
+
+#include "plugins/3dapi/ifsg_node.h"
+
+
+/**
+ * Class IFSG_LINESET
+ * is the wrapper for SGLINESET; the line set must be attached to
+ * an IFSG_SHAPE which holds no IFSG_FACESET.
+ */
+class SGLIB_API IFSG_LINESET : public IFSG_NODE
+{
+public:
+    IFSG_LINESET( bool create );
+    IFSG_LINESET( SGNODE* aParent );
+    IFSG_LINESET( IFSG_NODE& aParent );
+
+    bool Attach( SGNODE* aNode );
+    bool NewNode( SGNODE* aParent );
+    bool NewNode( IFSG_NODE& aParent );
+
+    bool GetCoordsList( size_t& aListSize, SGPOINT*& aCoordsList );
+    bool SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList );
+    bool AddCoord( const SGPOINT& aPoint );
+
+    bool GetIndices( size_t& nIndices, int*& aIndexList );
+
+    /**
+     * Function SetIndices
+     * sets the segment indices; indices are given in pairs with
+     * each pair describing one line segment.
+     *
+     * @param nIndices [in] the number of indices to be stored
+     * @param aIndexList [in] the index data
+     */
+    bool SetIndices( size_t nIndices, int* aIndexList );
+
+    /**
+     * Function AddSegment
+     * adds a single line segment between two coordinates
+     */
+    bool AddSegment( int aIndex0, int aIndex1 );
+};
+
+#endif  // IFSG_LINESET_H
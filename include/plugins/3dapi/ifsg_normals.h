@@ -31,6 +31,7 @@
 #define IFSG_NORMALS_H
 
 #include "plugins/3dapi/ifsg_node.h"
+#include "plugins/3dapi/c3dmodel.h"
 
 
 /**
@@ -52,6 +53,29 @@ public:
     bool SetNormalList( size_t aListSize, const SGVECTOR* aNormalList );
     bool AddNormal( double aXValue, double aYValue, double aZValue );
     bool AddNormal( const SGVECTOR& aNormal );
+
+    /**
+     * Function SetSinglePrecision
+     * selects single precision (float) storage for the normals rather
+     * than the default double precision; existing normals are converted.
+     */
+    bool SetSinglePrecision( bool aSinglePrecision );
+    bool IsSinglePrecision( void );
+
+    // single precision accessors; setting a list selects single precision
+    // storage. The normals are stored as given and must be of unit length.
+    bool GetNormalList( size_t& aListSize, SFVEC3F*& aNormalList );
+    bool SetNormalList( size_t aListSize, const SFVEC3F* aNormalList );
+
+    /**
+     * Function ShareNormalList
+     * makes this node refer to the normal data held by aSource rather than
+     * holding a copy; the data is shared until either node modifies it.
+     *
+     * @param aSource [in] the node which holds the data to be shared
+     * @return true on success
+     */
+    bool ShareNormalList( IFSG_NORMALS& aSource );
 };
 
 #endif  // IFSG_NORMALS_H
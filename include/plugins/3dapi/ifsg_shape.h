@@ -47,6 +47,24 @@ public:
     bool Attach( SGNODE* aNode );
     bool NewNode( SGNODE* aParent );
     bool NewNode( IFSG_NODE& aParent );
+
+    /**
+     * Function GetBounds
+     * retrieves the axis aligned bounds of the vertices of this shape
+     * in the local coordinates of the shape; the bounds are
+     * kept by the scene graph and only recomputed after a change.
+     *
+     * @return false if there is no geometry or the object is invalid
+     */
+    bool GetBounds( SGPOINT& aMin, SGPOINT& aMax );
+
+    /**
+     * Function GetWorldBounds
+     * retrieves the bounds with the transforms of all parent nodes applied
+     *
+     * @return false if there is no geometry or the object is invalid
+     */
+    bool GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax );
 };
 
 #endif  // IFSG_SHAPE_H
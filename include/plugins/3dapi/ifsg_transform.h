@@ -50,12 +50,43 @@ public:
     bool NewNode( SGNODE* aParent );
     bool NewNode( IFSG_NODE& aParent );
 
+    /**
+     * Function SetMatrix
+     * assigns the transform as an affine matrix given as 3 rows of 4 values
+     * (the rotation and scale part followed by the translation in each row).
+     * The matrix is applied exactly as given and takes the place of the
+     * values set by the other functions until one of them is called again.
+     *
+     * @param aMatrix is the row-major 3x4 matrix
+     * @return false if the object is invalid or aMatrix is NULL
+     */
+    bool SetMatrix( const double* aMatrix );
+
     bool SetScaleOrientation( const SGVECTOR& aScaleAxis, double aAngle );
     bool SetRotation( const SGVECTOR& aRotationAxis, double aAngle );
     bool SetScale( const SGPOINT& aScale );
     bool SetScale( double aScale );
     bool SetCenter( const SGPOINT& aCenter );
     bool SetTranslation( const SGPOINT& aTranslation );
+
+    /**
+     * Function GetBounds
+     * retrieves the axis aligned bounds of all geometry below this transform
+     * in its local coordinates, that is
+     * without the transform of this node itself; the bounds are
+     * kept by the scene graph and only recomputed after a change.
+     *
+     * @return false if there is no geometry or the object is invalid
+     */
+    bool GetBounds( SGPOINT& aMin, SGPOINT& aMax );
+
+    /**
+     * Function GetWorldBounds
+     * retrieves the bounds with the transforms of all parent nodes applied
+     *
+     * @return false if there is no geometry or the object is invalid
+     */
+    bool GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax );
 };
 
 #endif  // IFSG_TRANSFORM_H
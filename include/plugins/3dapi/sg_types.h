@@ -42,8 +42,25 @@ namespace S3D
         SGTYPE_COORDINDEX,
         SGTYPE_NORMALS,
         SGTYPE_SHAPE,
+        SGTYPE_LINESET,
         SGTYPE_END
     };
+
+    // weighting of the triangle normals which are summed to form
+    // the normal of a vertex (see IFSG_FACESET::CalcNormals())
+    enum NORMALWEIGHT
+    {
+        NORMALWEIGHT_AREA = 0,      // by the area of the triangle
+        NORMALWEIGHT_ANGLE          // by the angle of the triangle at the vertex
+    };
+
+    // options which may be combined and passed to GetModel()
+    enum GETMODEL_FLAGS
+    {
+        GETMODEL_KEEP_PREPARED = 0x01,  // shapes retain their prepared geometry; saves the
+                                        // recompute of unchanged shapes, not the copy
+        GETMODEL_INDEX16 = 0x02         // SMESH::m_FaceIdx16 replaces m_FaceIdx where possible
+    };
 };
 
 #endif  // SG_TYPES_H
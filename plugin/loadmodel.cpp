@@ -21,18 +21,20 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
  */
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstdlib>
 #include <cstring>
 #include <map>
 #include <vector>
-
-#if ( defined( DEBUG_OCE ) && DEBUG_OCE > 3 )
+#include <chrono>
+#include <mutex>
+#include <wx/log.h>
 #include <wx/filename.h>
 #include <wx/string.h>
-#endif
 
 #include <TDocStd_Document.hxx>
 #include <TopoDS.hxx>
@@ -57,12 +59,18 @@
 
 #include <BRep_Tool.hxx>
 #include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepBndLib.hxx>
+#include <Standard_Version.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <Bnd_Box.hxx>
 
 #include <TopoDS.hxx>
 #include <TopoDS_Shape.hxx>
 #include <TopoDS_Face.hxx>
 #include <TopoDS_Compound.hxx>
+#include <TopoDS_Edge.hxx>
 #include <TopExp_Explorer.hxx>
+#include <TopTools_MapOfShape.hxx>
 
 #include <Quantity_Color.hxx>
 #include <Poly_Triangulation.hxx>
@@ -73,6 +81,9 @@
 #include <TDF_ChildIterator.hxx>
 
 #include "plugins/3dapi/ifsg_all.h"
+#include "plugins/3d/3d_model_info.h"
+#include "stepscan.h"
+#include "loadmodel.h"
 
 // log mask for wxLogTrace
 #define MASK_OCE "PLUGIN_OCE"
@@ -85,6 +96,23 @@
 // 30 deg (12 faces per circle) = 0.52359878
 #define USER_ANGLE (0.52359878)
 
+// complexity (see MODEL_SCAN::GetComplexity) above which the
+// tessellation is coarsened to keep the load time reasonable
+#define LARGE_MODEL (20000.0)
+#define HUGE_MODEL (100000.0)
+
+// meshing time budgets in seconds; a face which takes longer than
+// FACE_BUDGET coarsens the tessellation of the remaining faces and once
+// LOAD_BUDGET is spent the remaining faces are replaced by bounding boxes
+#define FACE_BUDGET (2.0)
+#define LOAD_BUDGET (60.0)
+// limit on the coarsening of the tessellation relative to USER_PREC
+#define MAX_COARSEN (8.0)
+// BRepMesh cannot be interrupted, so a face which is predicted to exceed
+// this triangle count is meshed more coarsely or replaced by a bounding box
+// before meshing starts
+#define FACE_TRIANGLES (200000.0)
+
 typedef std::map< Standard_Real, SGNODE* > COLORMAP;
 typedef std::map< std::string, SGNODE* >   FACEMAP;
 typedef std::map< std::string, std::vector< SGNODE* > > NODEMAP;
@@ -101,6 +129,13 @@ bool processComp( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
 bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
     std::vector< SGNODE* >* items, Quantity_Color* color );
 
+bool makeProxy( const TopoDS_Face& face, std::vector< SFVEC3F >& vertices,
+    std::vector< int >& indices, std::vector< int >* indices2 );
+
+SGNODE* processEdges( const TopoDS_Face& face, DATA& data,
+    const Handle(Poly_Triangulation)& triangulation, const TopLoc_Location& loc,
+    SGNODE* ocolor );
+
 struct DATA
 {
     Handle( TDocStd_Document ) m_doc;
@@ -112,8 +147,18 @@ struct DATA
     NODEMAP  shapes;    // SGNODE lists representing a TopoDS_SOLID / COMPOUND
     COLORMAP colors;    // SGAPPEARANCE nodes
     FACEMAP  faces;     // SGSHAPE items representing a TopoDS_FACE
+    TopTools_MapOfShape rootEdges;  // feature edges emitted outside of any solid or compound
+    TopTools_MapOfShape* edges; // TopoDS_EDGE items already emitted under the current transform
     bool renderBoth;    // set TRUE if we're processing IGES
     bool hasSolid;      // set TRUE if there is no parent SOLID
+    double precision;   // linear deflection for meshing
+    double angle;       // angular deflection for meshing
+    double meshTime;    // time spent in BRepMesh so far (seconds)
+    unsigned int nMeshed;   // faces tessellated by BRepMesh
+    unsigned int nSlow;     // faces which exceeded FACE_BUDGET
+    unsigned int nCoarse;   // faces meshed more coarsely to stay within FACE_TRIANGLES
+    unsigned int nProxies;  // faces replaced by a bounding box
+    bool lazyNormals;   // set TRUE to leave the normals to be calculated by GetModel()
 
     DATA()
     {
@@ -122,6 +167,15 @@ struct DATA
         refColor.SetValues( Quantity_NOC_BLACK );
         renderBoth = false;
         hasSolid = false;
+        precision = USER_PREC;
+        angle = USER_ANGLE;
+        meshTime = 0.0;
+        nMeshed = 0;
+        nSlow = 0;
+        nCoarse = 0;
+        nProxies = 0;
+        lazyNormals = false;
+        edges = &rootEdges;
     }
 
     ~DATA()
@@ -258,50 +312,6 @@ struct DATA
 };
 
 
-enum FormatType
-{
-    FMT_NONE = 0,
-    FMT_STEP = 1,
-    FMT_IGES = 2
-};
-
-
-FormatType fileType( const char* aFileName )
-{
-    std::ifstream ifile;
-    ifile.open( aFileName );
-
-    if( !ifile.is_open() )
-        return FMT_NONE;
-
-    char iline[82];
-    memset( iline, 0, 82 );
-    ifile.getline( iline, 82 );
-    ifile.close();
-    iline[81] = 0;  // ensure NULL termination when string is too long
-
-    // check for STEP in Part 21 format
-    // (this can give false positives since Part 21 is not exclusively STEP)
-    if( !strncmp( iline, "ISO-10303-21;", 13 ) )
-        return FMT_STEP;
-
-    std::string fstr = iline;
-
-    // check for STEP in XML format
-    // (this can give both false positive and false negatives)
-    if( fstr.find( "urn:oid:1.0.10303." ) != std::string::npos )
-        return FMT_STEP;
-
-    // Note: this is a very simple test which can yield false positives; the only
-    // sure method for determining if a file *not* an IGES model is to attempt
-    // to load it.
-    if( iline[72] == 'S' && ( iline[80] == 0 || iline[80] == 13 || iline[80] == 10 ) )
-        return FMT_IGES;
-
-    return FMT_NONE;
-}
-
-
 void getTag( TDF_Label& label, std::string& aTag )
 {
     aTag.clear();
@@ -458,36 +468,82 @@ bool readSTEP( Handle(TDocStd_Document)& m_doc, const char* fname )
 }
 
 
-SCENEGRAPH* LoadModel( char const* filename )
+// select the tessellation quality based on the estimated model complexity
+void setQuality( DATA& data, const MODEL_SCAN& scan, const char* filename )
 {
-    DATA data;
+    double complexity = scan.GetComplexity();
+
+    if( complexity > HUGE_MODEL )
+    {
+        data.precision = 4.0 * USER_PREC;
+        data.angle = 2.0 * USER_ANGLE;
 
+        wxLogTrace( MASK_OCE, "%s: very complex model (%u faces, %u free-form surfaces); "
+            "using coarse tessellation\n", filename, scan.nFaces, scan.nBSplineSurfaces );
+    }
+    else if( complexity > LARGE_MODEL )
+    {
+        data.precision = 2.0 * USER_PREC;
+        data.angle = 1.5 * USER_ANGLE;
+    }
+
+    return;
+}
+
+
+// create the document and read the model into it
+bool openModel( char const* filename, DATA& data, MODEL_SCAN& scan )
+{
     Handle(XCAFApp_Application) m_app = XCAFApp_Application::GetApplication();
     m_app->NewDocument( "MDTV-XCAF", data.m_doc );
-    FormatType modelFmt = fileType( filename );
 
-    switch( modelFmt )
+    if( !ScanModel( filename, scan ) )
+        return false;
+
+    switch( scan.format )
     {
         case FMT_IGES:
             data.renderBoth = true;
 
             if( !readIGES( data.m_doc, filename ) )
-                return NULL;
+                return false;
             break;
 
         case FMT_STEP:
             if( !readSTEP( data.m_doc, filename ) )
-                return NULL;
+                return false;
             break;
 
         default:
-            return NULL;
+            return false;
             break;
     }
 
     data.m_assy = XCAFDoc_DocumentTool::ShapeTool( data.m_doc->Main() );
     data.m_color = XCAFDoc_DocumentTool::ColorTool( data.m_doc->Main() );
 
+    return true;
+}
+
+
+SCENEGRAPH* LoadModel( char const* filename )
+{
+    DATA data;
+    MODEL_SCAN scan;
+
+    if( !openModel( filename, data, scan ) )
+        return NULL;
+
+    FormatType modelFmt = scan.format;
+    setQuality( data, scan, filename );
+
+    // normals are stored in the scene graph unless the user opts to have
+    // them calculated when the model is prepared; this saves one normal per
+    // vertex in the scene graph and the cache at the cost of smoothing only
+    // within each face set
+    const char* lazy = getenv( "KICAD_OCE_LAZY_NORMALS" );
+    data.lazyNormals = ( NULL != lazy && atoi( lazy ) > 0 );
+
     // retrieve all free shapes
     TDF_LabelSequence frshapes;
     data.m_assy->GetFreeShapes( frshapes );
@@ -496,25 +552,47 @@ SCENEGRAPH* LoadModel( char const* filename )
     int id = 1;
     bool ret = false;
 
-    // create the top level SG node
-    IFSG_TRANSFORM topNode( true );
-    data.scene = topNode.GetRawPtr();
-
-    while( id <= nshapes )
+    // place the scene in an arena so that it can be released cheaply; the
+    // arena is ended when the scope is left, even by an OCE exception
+    do
     {
-        TopoDS_Shape shape = data.m_assy->GetShape( frshapes.Value(id) );
+        S3D::ARENA_SCOPE arena;
 
-        if ( !shape.IsNull() && processNode( shape, data, data.scene, NULL ) )
-            ret = true;
+        // create the top level SG node
+        IFSG_TRANSFORM topNode( true );
+        data.scene = topNode.GetRawPtr();
 
-        ++id;
-    };
+        while( id <= nshapes )
+        {
+            TopoDS_Shape shape = data.m_assy->GetShape( frshapes.Value(id) );
+
+            if ( !shape.IsNull() && processNode( shape, data, data.scene, NULL ) )
+                ret = true;
+
+            ++id;
+        };
+    } while( 0 );
+
+    LOAD_STATS stats;
+    stats.nMeshed = data.nMeshed;
+    stats.nSlow = data.nSlow;
+    stats.nCoarse = data.nCoarse;
+    stats.nProxies = data.nProxies;
+    SetLoadStats( filename, stats );
 
     if( !ret )
         return NULL;
 
     SCENEGRAPH* scene = (SCENEGRAPH*)data.scene;
 
+    // remove the slivers and collapsed triangles left by the mesher
+    size_t nVertices = 0;
+    size_t nFaces = S3D::RemoveDegenerateFaces( data.scene, &nVertices );
+
+    if( nFaces > 0 || nVertices > 0 )
+        wxLogTrace( MASK_OCE, "%s: removed %u degenerate triangles and %u unused "
+            "vertices\n", filename, (unsigned int)nFaces, (unsigned int)nVertices );
+
     // DEBUG: WRITE OUT VRML2 FILE TO CONFIRM STRUCTURE
     #if ( defined( DEBUG_OCE ) && DEBUG_OCE > 3 )
     if( data.scene )
@@ -533,6 +611,11 @@ SCENEGRAPH* LoadModel( char const* filename )
     }
     #endif
 
+    if( data.nSlow > 0 || data.nCoarse > 0 || data.nProxies > 0 )
+        wxLogTrace( MASK_OCE, "%s: meshed %u faces in %.1fs; %u slow faces, %u coarsened "
+            "faces, %u faces replaced by bounding boxes\n", filename, data.nMeshed,
+            data.meshTime, data.nSlow, data.nCoarse, data.nProxies );
+
     // set to NULL to prevent automatic destruction of the scene data
     data.scene = NULL;
 
@@ -540,6 +623,41 @@ SCENEGRAPH* LoadModel( char const* filename )
 }
 
 
+SCENEGRAPH* LoadScene( char const* filename )
+{
+    SCENEGRAPH* scene = LoadModel( filename );
+
+    // every compound and solid introduces a transform level; remove
+    // the redundant levels so that rendering requires fewer matrix products
+    if( NULL != scene )
+        S3D::FlattenTransforms( (SGNODE*)scene, true );
+
+    return scene;
+}
+
+
+// sets the transform of aNode from the location of a shape; the matrix
+// (which includes any scale factor) is passed on as is rather than
+// converted to an axis and angle and back again
+static void setMatrix( IFSG_TRANSFORM& aNode, const TopLoc_Location& aLoc )
+{
+    if( aLoc.IsIdentity() )
+        return;
+
+    gp_Trsf T = aLoc.Transformation();
+    double tx[12];
+
+    for( int row = 0; row < 3; ++row )
+    {
+        for( int col = 0; col < 4; ++col )
+            tx[row * 4 + col] = T.Value( row + 1, col + 1 );
+    }
+
+    aNode.SetMatrix( tx );
+    return;
+}
+
+
 bool processShell( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
     std::vector< SGNODE* >* items, Quantity_Color* color )
 {
@@ -587,20 +705,15 @@ bool processSolid( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
     TopoDS_Iterator it;
     IFSG_TRANSFORM childNode( parent );
     SGNODE* pptr = childNode.GetRawPtr();
-    TopLoc_Location loc = shape.Location();
     bool ret = false;
 
-    if( !loc.IsIdentity() )
-    {
-        gp_Trsf T = loc.Transformation();
-        gp_XYZ coord = T.TranslationPart();
-        childNode.SetTranslation( SGPOINT( coord.X(), coord.Y(), coord.Z() ) );
-        gp_XYZ axis;
-        Standard_Real angle;
+    setMatrix( childNode, shape.Location() );
 
-        if( T.GetRotation( axis, angle ) )
-            childNode.SetRotation( SGVECTOR( axis.X(), axis.Y(), axis.Z() ), angle );
-    }
+    // the edges of another instance of this solid are located elsewhere
+    // so they are only deduplicated within this transform
+    TopTools_MapOfShape edges;
+    TopTools_MapOfShape* outerEdges = data.edges;
+    data.edges = &edges;
 
     std::vector< SGNODE* >* component = NULL;
 
@@ -626,6 +739,8 @@ bool processSolid( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
             ret = true;
     }
 
+    data.edges = outerEdges;
+
     if( !ret )
         childNode.Destroy();
     else if( NULL != items )
@@ -641,20 +756,13 @@ bool processComp( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
     TopoDS_Iterator it;
     IFSG_TRANSFORM childNode( parent );
     SGNODE* pptr = childNode.GetRawPtr();
-    TopLoc_Location loc = shape.Location();
     bool ret = false;
 
-    if( !loc.IsIdentity() )
-    {
-        gp_Trsf T = loc.Transformation();
-        gp_XYZ coord = T.TranslationPart();
-        childNode.SetTranslation( SGPOINT( coord.X(), coord.Y(), coord.Z() ) );
-        gp_XYZ axis;
-        Standard_Real angle;
+    setMatrix( childNode, shape.Location() );
 
-        if( T.GetRotation( axis, angle ) )
-            childNode.SetRotation( SGVECTOR( axis.X(), axis.Y(), axis.Z() ), angle );
-    }
+    TopTools_MapOfShape edges;
+    TopTools_MapOfShape* outerEdges = data.edges;
+    data.edges = &edges;
 
     for( it.Initialize( shape, false, false ); it.More(); it.Next() )
     {
@@ -690,6 +798,8 @@ bool processComp( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
         }
     }
 
+    data.edges = outerEdges;
+
     if( !ret )
         childNode.Destroy();
     else if( NULL != items )
@@ -737,6 +847,54 @@ bool processNode( const TopoDS_Shape& shape, DATA& data, SGNODE* parent,
 }
 
 
+// estimate the number of triangles BRepMesh would create for a face at the
+// given deflection; the count of a free-form surface grows with the number
+// of its knot spans and with the inverse of the deflection
+static double estimateTriangles( const TopoDS_Face& face, double aDeflection )
+{
+    // segments per full turn of a curved surface at USER_ANGLE
+    static const unsigned int nSeg = (unsigned int)( 6.28318531 / USER_ANGLE + 0.5 );
+    unsigned int nEdges = 0;
+
+    for( TopExp_Explorer ex( face, TopAbs_EDGE ); ex.More(); ex.Next() )
+        ++nEdges;
+
+    BRepAdaptor_Surface surf( face, Standard_False );
+    double nPatch = 1.0;
+
+    switch( surf.GetType() )
+    {
+        case GeomAbs_Plane:
+            return nEdges + 2;
+
+        case GeomAbs_Cylinder:
+        case GeomAbs_Cone:
+        case GeomAbs_SurfaceOfExtrusion:
+            return 2 * nSeg + nEdges;
+
+        case GeomAbs_Sphere:
+        case GeomAbs_Torus:
+        case GeomAbs_SurfaceOfRevolution:
+            return nSeg * nSeg;
+
+        case GeomAbs_BSplineSurface:
+            nPatch = (double)( surf.NbUKnots() - 1 ) * surf.UDegree()
+                     * (double)( surf.NbVKnots() - 1 ) * surf.VDegree();
+            break;
+
+        case GeomAbs_BezierSurface:
+            nPatch = (double)( surf.NbUPoles() - 1 ) * ( surf.NbVPoles() - 1 );
+            break;
+
+        default:
+            break;
+    }
+
+    // free-form surfaces are typically refined further
+    return 2.0 * std::max( (double)( nSeg * nSeg ), nPatch ) * USER_PREC / aDeflection;
+}
+
+
 bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
     std::vector< SGNODE* >* items, Quantity_Color* color )
 {
@@ -771,6 +929,21 @@ bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
         if( NULL != items )
             items->push_back( ashape );
 
+        std::string idE = partID;
+        idE.append( "e" );
+        SGNODE* shapeE = data.GetFace( idE );
+
+        if( shapeE )
+        {
+            if( NULL == S3D::GetSGNodeParent( shapeE ) )
+                S3D::AddSGNodeChild( parent, shapeE );
+            else
+                S3D::AddSGNodeRef( parent, shapeE );
+
+            if( NULL != items )
+                items->push_back( shapeE );
+        }
+
         if( useBothSides )
         {
             std::string id2 = partID;
@@ -793,17 +966,74 @@ bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
     Standard_Boolean isTessellate (Standard_False);
     Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation( face, loc );
 
-    if( triangulation.IsNull() || triangulation->Deflection() > USER_PREC + Precision::Confusion() )
+    if( triangulation.IsNull() || triangulation->Deflection() > data.precision + Precision::Confusion() )
         isTessellate = Standard_True;
 
-    if (isTessellate)
+    bool useProxy = false;
+
+    if( isTessellate )
     {
-        BRepMesh_IncrementalMesh IM(face, USER_PREC, Standard_False, USER_ANGLE );
-        triangulation = BRep_Tool::Triangulation( face, loc );
+        // a face predicted to be too costly is meshed more coarsely, or
+        // replaced up front if even the coarsest deflection will not do
+        double precision = data.precision;
+        double angle = data.angle;
+        double nTri = estimateTriangles( face, precision );
+
+        while( nTri > FACE_TRIANGLES && precision < MAX_COARSEN * USER_PREC )
+        {
+            precision *= 2.0;
+            angle *= 1.5;
+            nTri = estimateTriangles( face, precision );
+        }
+
+        if( data.meshTime > LOAD_BUDGET || nTri > FACE_TRIANGLES )
+        {
+            useProxy = true;
+        }
+        else
+        {
+            if( precision > data.precision )
+                ++data.nCoarse;
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            BRepMesh_IncrementalMesh IM(face, precision, Standard_False, angle );
+            double dt = std::chrono::duration< double >( std::chrono::steady_clock::now() - t0 ).count();
+            triangulation = BRep_Tool::Triangulation( face, loc );
+
+            data.meshTime += dt;
+            ++data.nMeshed;
+
+            // a face which was slow despite the prediction coarsens the faces which follow
+            if( dt > FACE_BUDGET )
+            {
+                ++data.nSlow;
+
+                if( data.precision < MAX_COARSEN * USER_PREC )
+                {
+                    data.precision *= 2.0;
+                    data.angle *= 1.5;
+                }
+            }
+        }
     }
 
-    if( triangulation.IsNull() == Standard_True )
+    // the vertices are kept in single precision since GetModel() produces
+    // float data in any case; this halves the memory held by the scene
+    std::vector< SFVEC3F > vertices;
+    std::vector< int > indices;
+    std::vector< int > indices2;
+
+    if( useProxy )
+    {
+        if( !makeProxy( face, vertices, indices, useBothSides ? &indices2 : NULL ) )
+            return false;
+
+        ++data.nProxies;
+    }
+    else if( triangulation.IsNull() == Standard_True )
+    {
         return false;
+    }
 
     Quantity_Color lcolor;
 
@@ -835,57 +1065,77 @@ bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
     else
         S3D::AddSGNodeRef( vshape.GetRawPtr(), ocolor );
 
-    const TColgp_Array1OfPnt&    arrPolyNodes = triangulation->Nodes();
-    const Poly_Array1OfTriangle& arrTriangles = triangulation->Triangles();
-
-    std::vector< SGPOINT > vertices;
-    std::vector< int > indices;
-    std::vector< int > indices2;
-    gp_Trsf tx;
-
-    for(int i = 1; i <= triangulation->NbNodes(); i++)
+    if( !useProxy )
     {
-        gp_XYZ v( arrPolyNodes(i).Coord() );
-        vertices.push_back( SGPOINT( v.X(), v.Y(), v.Z() ) );
-    }
-
-    for(int i = 1; i <= triangulation->NbTriangles(); i++)
-    {
-        int a, b, c;
-        arrTriangles( i ).Get( a, b, c );
-        a--;
+        const TColgp_Array1OfPnt&    arrPolyNodes = triangulation->Nodes();
+        const Poly_Array1OfTriangle& arrTriangles = triangulation->Triangles();
 
-        if( reverse )
+        for(int i = 1; i <= triangulation->NbNodes(); i++)
         {
-            int tmp = b - 1;
-            b = c - 1;
-            c = tmp;
-        } else {
-            b--;
-            c--;
+            gp_XYZ v( arrPolyNodes(i).Coord() );
+            vertices.push_back( SFVEC3F( v.X(), v.Y(), v.Z() ) );
         }
 
-        indices.push_back( a );
-        indices.push_back( b );
-        indices.push_back( c );
-
-        if( useBothSides )
+        for(int i = 1; i <= triangulation->NbTriangles(); i++)
         {
-            indices2.push_back( b );
-            indices2.push_back( a );
-            indices2.push_back( c );
+            int a, b, c;
+            arrTriangles( i ).Get( a, b, c );
+            a--;
+
+            if( reverse )
+            {
+                int tmp = b - 1;
+                b = c - 1;
+                c = tmp;
+            } else {
+                b--;
+                c--;
+            }
+
+            indices.push_back( a );
+            indices.push_back( b );
+            indices.push_back( c );
+
+            if( useBothSides )
+            {
+                indices2.push_back( b );
+                indices2.push_back( a );
+                indices2.push_back( c );
+            }
         }
     }
 
-    vcoords.SetCoordsList( vertices.size(), &vertices[0] );
-    coordIdx.SetIndices( indices.size(), &indices[0] );
-    vface.CalcNormals( NULL );
+    // the node adopts the vertex and index lists; no copies are made
+    vcoords.TakeCoordsList( vertices );
+    coordIdx.TakeIndices( indices );
+
+    if( !data.lazyNormals )
+        vface.CalcNormals( NULL );
+
     vshape.SetParent( parent );
 
     if( !partID.empty() )
         data.faces.insert( std::pair< std::string,
             SGNODE* >( partID, vshape.GetRawPtr() ) );
 
+    // feature edges are only created for the front side of the face
+    SGNODE* eshape = NULL;
+
+    if( !useProxy )
+        eshape = processEdges( face, data, triangulation, loc, ocolor );
+
+    if( NULL != eshape )
+    {
+        S3D::AddSGNodeChild( parent, eshape );
+
+        if( !partID.empty() )
+        {
+            std::string idE = partID;
+            idE.append( "e" );
+            data.faces.insert( std::pair< std::string, SGNODE* >( idE, eshape ) );
+        }
+    }
+
     // The outer surface of an IGES model is indeterminate so
     // we must render both sides of a surface.
     if( useBothSides )
@@ -898,9 +1148,14 @@ bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
         IFSG_COORDINDEX coordIdx2( vface2 );
         S3D::AddSGNodeRef( vshape2.GetRawPtr(), ocolor );
 
-        vcoords2.SetCoordsList( vertices.size(), &vertices[0] );
-        coordIdx2.SetIndices( indices2.size(), &indices2[0] );
-        vface2.CalcNormals( NULL );
+        // the back side requires its own coordinate node since the normals
+        // are calculated per coordinate node, but the vertex data is shared
+        vcoords2.ShareCoordsList( vcoords );
+        coordIdx2.TakeIndices( indices2 );
+
+        if( !data.lazyNormals )
+            vface2.CalcNormals( NULL );
+
         vshape2.SetParent( parent );
 
         if( !partID.empty() )
@@ -910,3 +1165,300 @@ bool processFace( const TopoDS_Face& face, DATA& data, SGNODE* parent,
 
     return true;
 }
+
+
+SGNODE* processEdges( const TopoDS_Face& face, DATA& data,
+    const Handle(Poly_Triangulation)& triangulation, const TopLoc_Location& loc,
+    SGNODE* ocolor )
+{
+    const TColgp_Array1OfPnt& arrPolyNodes = triangulation->Nodes();
+    std::map< int, int > nodeMap;   // triangulation node -> line set vertex
+    std::vector< SGPOINT > vertices;
+    std::vector< int > indices;
+
+    for( TopExp_Explorer ex( face, TopAbs_EDGE ); ex.More(); ex.Next() )
+    {
+        const TopoDS_Edge& edge = TopoDS::Edge( ex.Current() );
+
+        // skip collapsed edges (such as the poles of a sphere) and seams
+        // which merely close a periodic surface; neither is a visible feature
+        if( BRep_Tool::Degenerated( edge ) || BRep_Tool::IsClosed( edge, face ) )
+            continue;
+
+        // an edge shared by two faces is only emitted once per instance
+        if( !data.edges->Add( edge ) )
+            continue;
+
+        Handle(Poly_PolygonOnTriangulation) poly =
+            BRep_Tool::PolygonOnTriangulation( edge, triangulation, loc );
+
+        if( poly.IsNull() )
+            continue;
+
+        const TColStd_Array1OfInteger& arrNodes = poly->Nodes();
+        int lastIdx = -1;
+
+        for( int i = arrNodes.Lower(); i <= arrNodes.Upper(); ++i )
+        {
+            int tIdx = arrNodes( i );
+            std::map< int, int >::iterator mI = nodeMap.find( tIdx );
+            int vIdx;
+
+            if( mI == nodeMap.end() )
+            {
+                gp_XYZ v( arrPolyNodes( tIdx ).Coord() );
+                vIdx = (int)vertices.size();
+                vertices.push_back( SGPOINT( v.X(), v.Y(), v.Z() ) );
+                nodeMap.insert( std::pair< int, int >( tIdx, vIdx ) );
+            }
+            else
+            {
+                vIdx = mI->second;
+            }
+
+            if( lastIdx >= 0 && lastIdx != vIdx )
+            {
+                indices.push_back( lastIdx );
+                indices.push_back( vIdx );
+            }
+
+            lastIdx = vIdx;
+        }
+    }
+
+    if( indices.empty() )
+        return NULL;
+
+    IFSG_SHAPE eshape( true );
+    IFSG_LINESET lset( eshape );
+    S3D::AddSGNodeRef( eshape.GetRawPtr(), ocolor );
+
+    lset.SetCoordsList( vertices.size(), &vertices[0] );
+    lset.SetIndices( indices.size(), &indices[0] );
+
+    return eshape.GetRawPtr();
+}
+
+
+// add the exact bounds of a shape to a box. BRepBndLib::AddOptimal() is
+// only available from OCCT 7.2; before that BRepBndLib::Add() is used and
+// its tolerance padding is removed, but the bounds of a free-form surface
+// may still enclose its control points rather than the surface itself
+static void addExactBounds( const TopoDS_Shape& shape, Bnd_Box& box )
+{
+#if defined( OCC_VERSION_HEX ) && OCC_VERSION_HEX >= 0x070200
+    BRepBndLib::AddOptimal( shape, box, Standard_False, Standard_False );
+#else
+    BRepBndLib::Add( shape, box, Standard_False );
+    box.SetGap( 0.0 );
+#endif
+
+    return;
+}
+
+
+bool makeProxy( const TopoDS_Face& face, std::vector< SFVEC3F >& vertices,
+    std::vector< int >& indices, std::vector< int >* indices2 )
+{
+    // the box is computed from the exact geometry in the same (local)
+    // frame as the face triangulation
+    Bnd_Box box;
+    addExactBounds( face.Located( TopLoc_Location() ), box );
+
+    if( box.IsVoid() )
+        return false;
+
+    Standard_Real x[2], y[2], z[2];
+    box.Get( x[0], y[0], z[0], x[1], y[1], z[1] );
+
+    for( int i = 0; i < 8; ++i )
+        vertices.push_back( SFVEC3F( x[i & 1], y[( i >> 1 ) & 1], z[( i >> 2 ) & 1] ) );
+
+    // two outward facing triangles per side of the box
+    static const int boxIdx[36] =
+    {
+        0, 2, 3,  0, 3, 1,      // -Z
+        4, 5, 7,  4, 7, 6,      // +Z
+        0, 1, 5,  0, 5, 4,      // -Y
+        2, 6, 7,  2, 7, 3,      // +Y
+        0, 4, 6,  0, 6, 2,      // -X
+        1, 3, 7,  1, 7, 5       // +X
+    };
+
+    indices.insert( indices.end(), boxIdx, boxIdx + 36 );
+
+    // a closed box needs no back side but the shape must still be created
+    if( NULL != indices2 )
+        indices2->insert( indices2->end(), boxIdx, boxIdx + 36 );
+
+    return true;
+}
+
+
+struct INFO_CACHE_ENTRY
+{
+    wxDateTime     modTime;
+    wxULongLong    size;
+    S3D_MODEL_INFO info;
+};
+
+struct LOAD_STATS_ENTRY
+{
+    wxDateTime     modTime;
+    wxULongLong    size;
+    LOAD_STATS     stats;
+};
+
+// results of previous queries; the model data is not retained
+static std::map< std::string, INFO_CACHE_ENTRY > info_cache;
+// statistics of previous loads, reported by LoadModelInfo()
+static std::map< std::string, LOAD_STATS_ENTRY > load_stats;
+static std::mutex info_cache_lock;
+
+
+bool GetLoadStats( char const* filename, LOAD_STATS& aStats )
+{
+    wxFileName fn( wxString::FromUTF8Unchecked( filename ) );
+    std::lock_guard< std::mutex > lock( info_cache_lock );
+    std::map< std::string, LOAD_STATS_ENTRY >::iterator item = load_stats.find( filename );
+
+    if( item == load_stats.end() || item->second.modTime != fn.GetModTime()
+        || item->second.size != fn.GetSize() )
+        return false;
+
+    aStats = item->second.stats;
+    return true;
+}
+
+
+void SetLoadStats( char const* filename, const LOAD_STATS& aStats )
+{
+    wxFileName fn( wxString::FromUTF8Unchecked( filename ) );
+    LOAD_STATS_ENTRY entry;
+    entry.modTime = fn.GetModTime();
+    entry.size = fn.GetSize();
+    entry.stats = aStats;
+
+    std::lock_guard< std::mutex > lock( info_cache_lock );
+    load_stats[filename] = entry;
+
+    return;
+}
+
+
+// copies the statistics of the most recent load, if any, into aInfo
+static void addLoadStats( char const* filename, S3D_MODEL_INFO& aInfo )
+{
+    LOAD_STATS stats;
+    aInfo.m_Loaded = GetLoadStats( filename, stats );
+
+    if( !aInfo.m_Loaded )
+        memset( &stats, 0, sizeof( stats ) );
+
+    aInfo.m_MeshedFaces = stats.nMeshed;
+    aInfo.m_SlowFaces = stats.nSlow;
+    aInfo.m_CoarseFaces = stats.nCoarse;
+    aInfo.m_ProxyFaces = stats.nProxies;
+
+    return;
+}
+
+
+bool LoadModelInfo( char const* filename, S3D_MODEL_INFO& aInfo )
+{
+    wxFileName fn( wxString::FromUTF8Unchecked( filename ) );
+    wxDateTime modTime = fn.GetModTime();
+    wxULongLong fsize = fn.GetSize();
+    bool found = false;
+
+    do
+    {
+        std::lock_guard< std::mutex > lock( info_cache_lock );
+        std::map< std::string, INFO_CACHE_ENTRY >::iterator item = info_cache.find( filename );
+
+        if( item != info_cache.end() && item->second.modTime == modTime
+            && item->second.size == fsize )
+        {
+            aInfo = item->second.info;
+            found = true;
+        }
+    } while( 0 );
+
+    if( found )
+    {
+        addLoadStats( filename, aInfo );
+        return true;
+    }
+
+    DATA data;
+    MODEL_SCAN scan;
+
+    if( !openModel( filename, data, scan ) )
+        return false;
+
+    memset( &aInfo, 0, sizeof( aInfo ) );
+
+    TDF_LabelSequence frshapes;
+    data.m_assy->GetFreeShapes( frshapes );
+    Bnd_Box box;
+
+    for( int id = 1; id <= frshapes.Length(); ++id )
+    {
+        TopoDS_Shape shape = data.m_assy->GetShape( frshapes.Value( id ) );
+
+        if( shape.IsNull() )
+            continue;
+
+        // no triangulation exists so the box is computed from the exact geometry
+        addExactBounds( shape, box );
+
+        for( TopExp_Explorer ex( shape, TopAbs_SOLID ); ex.More(); ex.Next() )
+            ++aInfo.m_Solids;
+
+        for( TopExp_Explorer ex( shape, TopAbs_FACE ); ex.More(); ex.Next() )
+        {
+            ++aInfo.m_Faces;
+            aInfo.m_EstTriangles += (unsigned int) estimateTriangles(
+                TopoDS::Face( ex.Current() ), USER_PREC );
+        }
+    }
+
+    if( box.IsVoid() )
+        return false;
+
+    box.Get( aInfo.m_BBoxMin[0], aInfo.m_BBoxMin[1], aInfo.m_BBoxMin[2],
+        aInfo.m_BBoxMax[0], aInfo.m_BBoxMax[1], aInfo.m_BBoxMax[2] );
+
+    TDF_LabelSequence colors;
+    data.m_color->GetColors( colors );
+
+    for( int id = 1; id <= colors.Length()
+        && aInfo.m_ColorsSize < S3D_INFO_MAX_COLORS; ++id )
+    {
+        Quantity_Color col;
+
+        if( !data.m_color->GetColor( colors.Value( id ), col ) )
+            continue;
+
+        float* rgb = aInfo.m_Colors[aInfo.m_ColorsSize];
+        rgb[0] = (float) col.Red();
+        rgb[1] = (float) col.Green();
+        rgb[2] = (float) col.Blue();
+        ++aInfo.m_ColorsSize;
+    }
+
+    INFO_CACHE_ENTRY entry;
+    entry.modTime = modTime;
+    entry.size = fsize;
+    entry.info = aInfo;
+
+    do
+    {
+        std::lock_guard< std::mutex > lock( info_cache_lock );
+        info_cache[filename] = entry;
+    } while( 0 );
+
+    addLoadStats( filename, aInfo );
+
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file loadmodel.h
+ * declares the OCE model loader which is shared by the plugin and
+ * the worker program
+ */
+
+#ifndef OCE_LOADMODEL_H
+#define OCE_LOADMODEL_H
+
+#include "plugins/3d/3d_model_info.h"
+
+class SCENEGRAPH;
+
+/**
+ * Struct LOAD_STATS
+ * describes the tessellation performed by the most recent load of a model
+ */
+struct LOAD_STATS
+{
+    unsigned int nMeshed;   // faces tessellated by BRepMesh
+    unsigned int nSlow;     // faces which exceeded the per-face time budget
+    unsigned int nCoarse;   // faces predicted to be costly and meshed more coarsely
+    unsigned int nProxies;  // faces replaced by a bounding box
+};
+
+SCENEGRAPH* LoadModel( char const* filename );
+
+/**
+ * Function LoadScene
+ * loads a model and flattens its transform hierarchy for rendering
+ */
+SCENEGRAPH* LoadScene( char const* filename );
+
+bool LoadModelInfo( char const* filename, S3D_MODEL_INFO& aInfo );
+
+/**
+ * Function GetLoadStats
+ * retrieves the statistics recorded by the most recent load of a model
+ *
+ * @return false if the current version of the file has not been loaded
+ */
+bool GetLoadStats( char const* filename, LOAD_STATS& aStats );
+
+/**
+ * Function SetLoadStats
+ * records the statistics of a load of the given model; this is used to
+ * pass on the statistics of a load performed by a worker process
+ */
+void SetLoadStats( char const* filename, const LOAD_STATS& aStats );
+
+#endif  // OCE_LOADMODEL_H
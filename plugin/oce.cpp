@@ -29,8 +29,8 @@
 #include <wx/filename.h>
 #include "plugins/3d/3d_plugin.h"
 #include "plugins/3dapi/ifsg_all.h"
-
-SCENEGRAPH* LoadModel( char const* filename );
+#include "loadmodel.h"
+#include "worker.h"
 
 #define PLUGIN_OCE_MAJOR 1
 #define PLUGIN_OCE_MINOR 1
@@ -163,5 +163,19 @@ SCENEGRAPH* Load( char const* aFileName )
     if( !wxFileName::FileExists( fname ) )
         return NULL;
 
-    return LoadModel( aFileName );
+    return LoadInWorker( aFileName, LoadScene );
+}
+
+
+bool GetModelInfo( char const* aFileName, S3D_MODEL_INFO* aInfo )
+{
+    if( NULL == aFileName || NULL == aInfo )
+        return false;
+
+    wxString fname = wxString::FromUTF8Unchecked( aFileName );
+
+    if( !wxFileName::FileExists( fname ) )
+        return false;
+
+    return LoadModelInfo( aFileName, *aInfo );
 }
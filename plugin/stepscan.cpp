@@ -0,0 +1,450 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <cctype>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wx/string.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "stepscan.h"
+
+// relative cost of meshing a free-form surface compared to an analytic one
+#define BSPLINE_WEIGHT (4.0)
+
+
+/**
+ * Class MAPPED_FILE
+ * provides a read-only memory mapping of an entire file
+ */
+class MAPPED_FILE
+{
+private:
+    const char* m_data;
+    size_t      m_size;
+#ifdef _WIN32
+    HANDLE      m_file;
+    HANDLE      m_map;
+#endif
+
+public:
+    MAPPED_FILE( const char* aFileName );
+    ~MAPPED_FILE();
+
+    const char* Data( void ) const { return m_data; }
+    size_t Size( void ) const { return m_size; }
+};
+
+
+#ifdef _WIN32
+
+MAPPED_FILE::MAPPED_FILE( const char* aFileName )
+{
+    m_data = NULL;
+    m_size = 0;
+    m_map = NULL;
+
+    wxString fname = wxString::FromUTF8Unchecked( aFileName );
+    m_file = CreateFileW( fname.wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+
+    if( INVALID_HANDLE_VALUE == m_file )
+        return;
+
+    LARGE_INTEGER fsize;
+
+    if( !GetFileSizeEx( m_file, &fsize ) || 0 == fsize.QuadPart )
+        return;
+
+    m_map = CreateFileMappingW( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+
+    if( NULL == m_map )
+        return;
+
+    m_data = (const char*) MapViewOfFile( m_map, FILE_MAP_READ, 0, 0, 0 );
+
+    if( NULL != m_data )
+        m_size = (size_t) fsize.QuadPart;
+
+    return;
+}
+
+
+MAPPED_FILE::~MAPPED_FILE()
+{
+    if( NULL != m_data )
+        UnmapViewOfFile( m_data );
+
+    if( NULL != m_map )
+        CloseHandle( m_map );
+
+    if( INVALID_HANDLE_VALUE != m_file )
+        CloseHandle( m_file );
+
+    return;
+}
+
+#else
+
+MAPPED_FILE::MAPPED_FILE( const char* aFileName )
+{
+    m_data = NULL;
+    m_size = 0;
+
+    int fd = open( aFileName, O_RDONLY );
+
+    if( fd < 0 )
+        return;
+
+    struct stat fs;
+
+    if( 0 == fstat( fd, &fs ) && fs.st_size > 0 )
+    {
+        void* ptr = mmap( NULL, (size_t) fs.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if( MAP_FAILED != ptr )
+        {
+            m_data = (const char*) ptr;
+            m_size = (size_t) fs.st_size;
+            madvise( ptr, m_size, MADV_SEQUENTIAL );
+        }
+    }
+
+    // the mapping remains valid after the descriptor is closed
+    close( fd );
+
+    return;
+}
+
+
+MAPPED_FILE::~MAPPED_FILE()
+{
+    if( NULL != m_data )
+        munmap( (void*) m_data, m_size );
+
+    return;
+}
+
+#endif
+
+
+// entity classes of interest; a single instance is counted at most
+// once per class even when a complex instance names several variants
+enum ENTITY_CLASS
+{
+    EC_FACE     = 0x01,
+    EC_BSPLINE  = 0x02,
+    EC_EDGE     = 0x04,
+    EC_SHELL    = 0x08,
+    EC_SOLID    = 0x10,
+    EC_NAUO     = 0x20
+};
+
+
+static int classifyEntity( const char* aName, size_t aLen )
+{
+    static const struct
+    {
+        const char* name;
+        bool        prefix;     // true if the name also matches longer names
+        int         eclass;
+    } entities[] =
+    {
+        { "ADVANCED_FACE", false, EC_FACE },
+        { "FACE_SURFACE", false, EC_FACE },
+        { "B_SPLINE_SURFACE", true, EC_BSPLINE },
+        { "RATIONAL_B_SPLINE_SURFACE", false, EC_BSPLINE },
+        { "EDGE_CURVE", false, EC_EDGE },
+        { "CLOSED_SHELL", false, EC_SHELL },
+        { "OPEN_SHELL", false, EC_SHELL },
+        { "MANIFOLD_SOLID_BREP", false, EC_SOLID },
+        { "BREP_WITH_VOIDS", false, EC_SOLID },
+        { "NEXT_ASSEMBLY_USAGE_OCCURRENCE", false, EC_NAUO }
+    };
+
+    for( size_t i = 0; i < sizeof( entities ) / sizeof( entities[0] ); ++i )
+    {
+        size_t nlen = strlen( entities[i].name );
+
+        if( aLen < nlen || ( aLen > nlen && !entities[i].prefix ) )
+            continue;
+
+        if( aName[0] == entities[i].name[0] && !strncmp( aName, entities[i].name, nlen ) )
+            return entities[i].eclass;
+    }
+
+    return 0;
+}
+
+
+static inline bool isKeywordChar( char c )
+{
+    return isalnum( (unsigned char) c ) || '_' == c;
+}
+
+
+// skips a quoted string; an embedded quote is written as a pair of
+// quotes which is simply treated as two consecutive strings
+static inline const char* skipString( const char* p, const char* end )
+{
+    ++p;
+
+    while( p < end && '\'' != *p )
+        ++p;
+
+    return p < end ? p + 1 : end;
+}
+
+
+static inline const char* skipComment( const char* p, const char* end )
+{
+    p += 2;
+
+    while( p + 1 < end && !( '*' == p[0] && '/' == p[1] ) )
+        ++p;
+
+    return p + 1 < end ? p + 2 : end;
+}
+
+
+// parses the body of an entity instance starting just after '#';
+// returns the position at which scanning should continue
+static const char* scanInstance( const char* p, const char* end, MODEL_SCAN& aResult )
+{
+    while( p < end && isdigit( (unsigned char) *p ) )
+        ++p;
+
+    while( p < end && isspace( (unsigned char) *p ) )
+        ++p;
+
+    if( p >= end || '=' != *p )
+        return p;
+
+    ++p;
+
+    while( p < end && isspace( (unsigned char) *p ) )
+        ++p;
+
+    if( p >= end )
+        return p;
+
+    int mask = 0;
+
+    if( '(' == *p )
+    {
+        // complex instance: the type names are the keywords at depth 1
+        int depth = 0;
+
+        while( p < end && ';' != *p )
+        {
+            if( '\'' == *p )
+            {
+                p = skipString( p, end );
+                continue;
+            }
+
+            if( '(' == *p )
+                ++depth;
+            else if( ')' == *p )
+                --depth;
+
+            if( 1 == depth && isalpha( (unsigned char) *p ) )
+            {
+                const char* name = p;
+
+                while( p < end && isKeywordChar( *p ) )
+                    ++p;
+
+                mask |= classifyEntity( name, p - name );
+                continue;
+            }
+
+            ++p;
+        }
+    }
+    else
+    {
+        const char* name = p;
+
+        while( p < end && isKeywordChar( *p ) )
+            ++p;
+
+        mask = classifyEntity( name, p - name );
+    }
+
+    ++aResult.nEntities;
+
+    if( mask & EC_FACE )
+        ++aResult.nFaces;
+
+    if( mask & EC_BSPLINE )
+        ++aResult.nBSplineSurfaces;
+
+    if( mask & EC_EDGE )
+        ++aResult.nEdges;
+
+    if( mask & EC_SHELL )
+        ++aResult.nShells;
+
+    if( mask & EC_SOLID )
+        ++aResult.nSolids;
+
+    if( mask & EC_NAUO )
+        ++aResult.nAssemblyUsages;
+
+    return p;
+}
+
+
+static void scanPart21( const char* p, const char* end, MODEL_SCAN& aResult )
+{
+    bool stmtStart = true;
+
+    while( p < end )
+    {
+        char c = *p;
+
+        if( '\'' == c )
+        {
+            p = skipString( p, end );
+            stmtStart = false;
+            continue;
+        }
+
+        if( '/' == c && p + 1 < end && '*' == p[1] )
+        {
+            p = skipComment( p, end );
+            continue;
+        }
+
+        if( ';' == c )
+        {
+            stmtStart = true;
+            ++p;
+            continue;
+        }
+
+        if( !stmtStart || isspace( (unsigned char) c ) )
+        {
+            ++p;
+            continue;
+        }
+
+        stmtStart = false;
+
+        if( '#' == c )
+        {
+            p = scanInstance( p + 1, end, aResult );
+            continue;
+        }
+
+        // HEADER section entries
+        if( aResult.schema.empty() && end - p > 11 && !strncmp( p, "FILE_SCHEMA", 11 ) )
+        {
+            const char* sp = p + 11;
+
+            while( sp < end && '\'' != *sp && ';' != *sp )
+                ++sp;
+
+            if( sp < end && '\'' == *sp )
+            {
+                const char* se = skipString( sp, end );
+                aResult.schema.assign( sp + 1, se - sp - 2 );
+                p = se;
+                continue;
+            }
+        }
+
+        ++p;
+    }
+
+    return;
+}
+
+
+double MODEL_SCAN::GetComplexity( void ) const
+{
+    return nFaces + BSPLINE_WEIGHT * nBSplineSurfaces;
+}
+
+
+bool ScanModel( const char* aFileName, MODEL_SCAN& aResult )
+{
+    aResult = MODEL_SCAN();
+
+    if( NULL == aFileName )
+        return false;
+
+    MAPPED_FILE file( aFileName );
+
+    if( NULL == file.Data() )
+        return false;
+
+    const char* data = file.Data();
+    const char* end = data + file.Size();
+    aResult.fileSize = file.Size();
+
+    // extract the first line (at most 81 characters)
+    char iline[82];
+    memset( iline, 0, 82 );
+
+    for( int i = 0; i < 81 && data + i < end && '\n' != data[i]; ++i )
+        iline[i] = data[i];
+
+    // check for STEP in Part 21 format
+    // (this can give false positives since Part 21 is not exclusively STEP)
+    if( !strncmp( iline, "ISO-10303-21;", 13 ) )
+    {
+        aResult.format = FMT_STEP;
+        scanPart21( data + 13, end, aResult );
+        return true;
+    }
+
+    std::string fstr = iline;
+
+    // check for STEP in XML format
+    // (this can give both false positive and false negatives)
+    if( fstr.find( "urn:oid:1.0.10303." ) != std::string::npos )
+    {
+        aResult.format = FMT_STEP;
+        return true;
+    }
+
+    // Note: this is a very simple test which can yield false positives; the only
+    // sure method for determining if a file *not* an IGES model is to attempt
+    // to load it.
+    if( iline[72] == 'S' && ( iline[80] == 0 || iline[80] == 13 || iline[80] == 10 ) )
+    {
+        aResult.format = FMT_IGES;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,96 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file stepscan.h
+ * provides a fast pre-scan of STEP and IGES files which classifies the
+ * file format and estimates the model complexity without invoking OCE
+ */
+
+#ifndef STEPSCAN_H
+#define STEPSCAN_H
+
+#include <cstddef>
+#include <string>
+
+enum FormatType
+{
+    FMT_NONE = 0,
+    FMT_STEP = 1,
+    FMT_IGES = 2
+};
+
+/**
+ * Struct MODEL_SCAN
+ * holds the results of a pre-scan; the entity counts are only
+ * available for STEP files in Part 21 (clear text) format.
+ */
+struct MODEL_SCAN
+{
+    FormatType   format;
+    size_t       fileSize;
+    std::string  schema;            // first schema named by FILE_SCHEMA
+    unsigned int nEntities;         // total number of entity instances
+    unsigned int nFaces;            // ADVANCED_FACE, FACE_SURFACE
+    unsigned int nBSplineSurfaces;  // all B_SPLINE_SURFACE variants
+    unsigned int nEdges;            // EDGE_CURVE
+    unsigned int nShells;           // CLOSED_SHELL, OPEN_SHELL
+    unsigned int nSolids;           // MANIFOLD_SOLID_BREP, BREP_WITH_VOIDS
+    unsigned int nAssemblyUsages;   // NEXT_ASSEMBLY_USAGE_OCCURRENCE
+
+    MODEL_SCAN()
+    {
+        format = FMT_NONE;
+        fileSize = 0;
+        nEntities = 0;
+        nFaces = 0;
+        nBSplineSurfaces = 0;
+        nEdges = 0;
+        nShells = 0;
+        nSolids = 0;
+        nAssemblyUsages = 0;
+    }
+
+    /**
+     * Function GetComplexity
+     * returns a relative estimate of the tessellation cost of the model;
+     * the value is roughly the number of faces with free-form surfaces
+     * weighted by the additional effort required to mesh them. It may be
+     * used to select the tessellation quality or to order a batch of files.
+     */
+    double GetComplexity( void ) const;
+};
+
+/**
+ * Function ScanModel
+ * determines the format of the given file and, for Part 21 STEP files,
+ * counts the entities which dominate the cost of loading and meshing.
+ * The file is memory mapped and scanned in a single pass.
+ *
+ * @param aFileName is the UTF-8 encoded name of the file to scan
+ * @param aResult receives the results of the scan
+ * @return true if the file was recognized as a STEP or IGES model
+ */
+bool ScanModel( const char* aFileName, MODEL_SCAN& aResult );
+
+#endif  // STEPSCAN_H
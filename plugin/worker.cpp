@@ -0,0 +1,550 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <wx/log.h>
+
+#include "plugins/3dapi/ifsg_all.h"
+#include "loadmodel.h"
+#include "worker.h"
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <wx/init.h>
+
+#define MASK_OCE "PLUGIN_OCE"
+
+// default limit on the duration of a single load, in seconds
+#define DEFAULT_TIMEOUT (300)
+
+// name of the worker program, which is installed next to the plugin
+#define WORKER_NAME "kicad_oce_worker"
+
+// descriptor through which a worker talks to the host
+#define WORKER_FD (3)
+
+// sent by a worker once it is ready to accept requests
+#define WORKER_READY ( 'R' )
+
+// writes to a worker which has died must not raise SIGPIPE in the host
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+
+static int getEnvInt( const char* aName, int aDefault )
+{
+    const char* val = getenv( aName );
+
+    if( NULL == val || 0 == val[0] )
+        return aDefault;
+
+    int ival = atoi( val );
+
+    return ival < 0 ? aDefault : ival;
+}
+
+
+int GetWorkerCount( void )
+{
+    static int nWorkers = getEnvInt( "KICAD_OCE_WORKERS", 0 );
+
+    return nWorkers;
+}
+
+
+struct WORKER
+{
+    pid_t pid;
+    int fd;     // host end of the socket connected to the worker
+};
+
+
+// holds the idle workers and limits the number of worker processes
+static struct WORKER_POOL
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector< WORKER > idle;
+    int busy;
+
+    WORKER_POOL()
+    {
+        busy = 0;
+    }
+
+    // waits until a worker may be used; returns true with an idle worker
+    // in aWorker or false if the caller may start a new worker
+    bool Acquire( int aLimit, WORKER& aWorker )
+    {
+        std::unique_lock< std::mutex > lk( lock );
+
+        while( idle.empty() && busy >= aLimit )
+            cv.wait( lk );
+
+        ++busy;
+
+        if( idle.empty() )
+            return false;
+
+        aWorker = idle.back();
+        idle.pop_back();
+        return true;
+    }
+
+    // returns aWorker to the pool, or gives up its slot if aWorker is NULL
+    void Release( const WORKER* aWorker )
+    {
+        std::lock_guard< std::mutex > lk( lock );
+        --busy;
+
+        if( NULL != aWorker )
+            idle.push_back( *aWorker );
+
+        cv.notify_one();
+    }
+
+} worker_pool;
+
+
+static bool sendAll( int aFd, const char* aData, size_t aSize )
+{
+    while( aSize > 0 )
+    {
+        ssize_t nw = send( aFd, aData, aSize, SEND_FLAGS );
+
+        if( nw < 0 && EINTR == errno )
+            continue;
+
+        if( nw <= 0 )
+            return false;
+
+        aData += nw;
+        aSize -= (size_t)nw;
+    }
+
+    return true;
+}
+
+
+static bool readAll( int aFd, char* aData, size_t aSize )
+{
+    while( aSize > 0 )
+    {
+        ssize_t nr = read( aFd, aData, aSize );
+
+        if( nr < 0 && EINTR == errno )
+            continue;
+
+        if( nr <= 0 )
+            return false;
+
+        aData += nr;
+        aSize -= (size_t)nr;
+    }
+
+    return true;
+}
+
+
+// strings are sent as a 32-bit length followed by the characters
+static bool sendString( int aFd, const std::string& aString )
+{
+    uint32_t len = (uint32_t)aString.size();
+
+    return sendAll( aFd, (const char*)&len, sizeof( len ) )
+        && sendAll( aFd, aString.data(), aString.size() );
+}
+
+
+static bool readString( int aFd, std::string& aString )
+{
+    uint32_t len = 0;
+
+    if( !readAll( aFd, (char*)&len, sizeof( len ) ) )
+        return false;
+
+    aString.resize( len );
+
+    return 0 == len || readAll( aFd, &aString[0], len );
+}
+
+
+// waits up to aTimeout seconds (0 = no limit) for a status byte from a
+// worker; returns false if the worker timed out or closed its socket
+static bool readStatus( int aFd, char& aStatus, int aTimeout )
+{
+    struct pollfd pfd;
+    pfd.fd = aFd;
+    pfd.events = POLLIN;
+
+    while( true )
+    {
+        int nr = poll( &pfd, 1, aTimeout > 0 ? aTimeout * 1000 : -1 );
+
+        if( nr < 0 && EINTR == errno )
+            continue;
+
+        if( nr <= 0 )
+        {
+            wxLogTrace( MASK_OCE, " * [INFO] model worker timed out\n" );
+            return false;
+        }
+
+        ssize_t rd = read( aFd, &aStatus, 1 );
+
+        if( rd < 0 && EINTR == errno )
+            continue;
+
+        // EOF without a status byte indicates a crash
+        if( rd <= 0 )
+        {
+            wxLogTrace( MASK_OCE, " * [INFO] model worker exited unexpectedly\n" );
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+// terminates a worker and collects its exit status
+static void discardWorker( WORKER& aWorker )
+{
+    kill( aWorker.pid, SIGKILL );
+    close( aWorker.fd );
+
+    int wstat = 0;
+
+    while( waitpid( aWorker.pid, &wstat, 0 ) < 0 && EINTR == errno );
+
+    if( WIFSIGNALED( wstat ) && SIGKILL != WTERMSIG( wstat ) )
+        wxLogTrace( MASK_OCE, " * [INFO] model worker terminated by signal %d\n",
+            WTERMSIG( wstat ) );
+
+    return;
+}
+
+
+// returns the path of the worker program; it is expected in the same
+// directory as this plugin unless KICAD_OCE_WORKER names another path
+static std::string workerPath( void )
+{
+    const char* path = getenv( "KICAD_OCE_WORKER" );
+
+    if( NULL != path && 0 != path[0] )
+        return path;
+
+    Dl_info info;
+
+    if( 0 == dladdr( (void*)&GetWorkerCount, &info ) || NULL == info.dli_fname )
+        return std::string();
+
+    std::string dir = info.dli_fname;
+    size_t sep = dir.rfind( '/' );
+
+    if( std::string::npos == sep )
+        dir = ".";
+    else
+        dir.erase( sep );
+
+    return dir + "/" WORKER_NAME;
+}
+
+
+// starts a new worker; the host is typically multi-threaded so the child
+// only makes async-signal-safe calls until it executes the worker program
+static bool startWorker( const std::string& aPath, WORKER& aWorker, int aTimeout )
+{
+    int sv[2];
+
+    if( socketpair( AF_UNIX, SOCK_STREAM, 0, sv ) < 0 )
+        return false;
+
+    // the sockets must not leak into processes which the host executes;
+    // the worker receives its end through dup2() which clears the flag
+    fcntl( sv[0], F_SETFD, FD_CLOEXEC );
+    fcntl( sv[1], F_SETFD, FD_CLOEXEC );
+
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt( sv[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof( on ) );
+#endif
+
+    char* argv[2] = { (char*)aPath.c_str(), NULL };
+    pid_t pid = fork();
+
+    if( 0 == pid )
+    {
+        if( WORKER_FD == sv[1] )
+            fcntl( WORKER_FD, F_SETFD, 0 );
+        else if( dup2( sv[1], WORKER_FD ) < 0 )
+            _exit( 127 );
+
+        execv( argv[0], argv );
+        _exit( 127 );
+    }
+
+    close( sv[1] );
+
+    if( pid < 0 )
+    {
+        close( sv[0] );
+        return false;
+    }
+
+    aWorker.pid = pid;
+    aWorker.fd = sv[0];
+
+    // a worker which could not be executed closes the socket unannounced
+    char status = 0;
+
+    if( !readStatus( aWorker.fd, status, aTimeout ) || WORKER_READY != status )
+    {
+        discardWorker( aWorker );
+        return false;
+    }
+
+    return true;
+}
+
+
+SCENEGRAPH* LoadInWorker( char const* aFileName, MODEL_LOADER aLoader )
+{
+    int nWorkers = GetWorkerCount();
+
+    if( nWorkers <= 0 )
+        return aLoader( aFileName );
+
+    static const std::string path = workerPath();
+
+    if( path.empty() || 0 != access( path.c_str(), X_OK ) )
+    {
+        wxLogTrace( MASK_OCE, " * [INFO] no model worker at '%s'; loading in-process\n",
+            path.c_str() );
+        return aLoader( aFileName );
+    }
+
+    const char* tmpdir = getenv( "TMPDIR" );
+    std::string output = ( NULL != tmpdir && 0 != tmpdir[0] ) ? tmpdir : "/tmp";
+    output.append( "/kicad_oce_XXXXXX" );
+
+    int tfd = mkstemp( &output[0] );
+
+    if( tfd < 0 )
+        return aLoader( aFileName );
+
+    close( tfd );
+
+    int timeout = getEnvInt( "KICAD_OCE_TIMEOUT", DEFAULT_TIMEOUT );
+    WORKER worker;
+    bool reused = worker_pool.Acquire( nWorkers, worker );
+    bool sent = reused && sendString( worker.fd, aFileName ) && sendString( worker.fd, output );
+
+    // an idle worker may have died since its last load; it is replaced
+    if( reused && !sent )
+    {
+        discardWorker( worker );
+        reused = false;
+    }
+
+    if( !reused )
+    {
+        if( !startWorker( path, worker, timeout ) )
+        {
+            worker_pool.Release( NULL );
+            unlink( output.c_str() );
+            wxLogTrace( MASK_OCE, " * [INFO] could not start model worker; loading in-process\n" );
+
+            return aLoader( aFileName );
+        }
+
+        sent = sendString( worker.fd, aFileName ) && sendString( worker.fd, output );
+    }
+
+    // the status is followed by the statistics of the load
+    char status = 0;
+    LOAD_STATS stats;
+    bool ok = sent && readStatus( worker.fd, status, timeout )
+              && readAll( worker.fd, (char*)&stats, sizeof( stats ) );
+
+    if( ok )
+    {
+        worker_pool.Release( &worker );
+    }
+    else
+    {
+        discardWorker( worker );
+        worker_pool.Release( NULL );
+    }
+
+    SCENEGRAPH* scene = NULL;
+
+    if( ok )
+        SetLoadStats( aFileName, stats );
+
+    if( ok && 1 == status )
+        scene = (SCENEGRAPH*)S3D::ReadCache( output.c_str(), NULL, NULL );
+    else
+        wxLogTrace( MASK_OCE, " * [INFO] model worker failed on '%s'\n", aFileName );
+
+    unlink( output.c_str() );
+
+    return scene;
+}
+
+
+// closes every descriptor other than the standard streams and WORKER_FD
+// which the worker inherited from the host
+static void closeInherited( void )
+{
+#ifdef SYS_close_range
+    if( 0 == syscall( SYS_close_range, WORKER_FD + 1, ~0U, 0 ) )
+        return;
+#endif
+
+    // the descriptors are listed in full before any is closed so that
+    // the directory stream is not disturbed
+    DIR* dir = opendir( "/proc/self/fd" );
+
+    if( NULL == dir )
+        dir = opendir( "/dev/fd" );
+
+    if( NULL != dir )
+    {
+        std::vector< int > fds;
+        struct dirent* entry;
+        int dfd = dirfd( dir );
+
+        while( NULL != ( entry = readdir( dir ) ) )
+        {
+            char* end = NULL;
+            long fd = strtol( entry->d_name, &end, 10 );
+
+            if( end != entry->d_name && 0 == *end && fd > WORKER_FD && fd != dfd )
+                fds.push_back( (int)fd );
+        }
+
+        closedir( dir );
+
+        for( size_t i = 0; i < fds.size(); ++i )
+            close( fds[i] );
+
+        return;
+    }
+
+    long maxFd = sysconf( _SC_OPEN_MAX );
+
+    if( maxFd <= 0 )
+        maxFd = 1024;
+
+    for( int fd = WORKER_FD + 1; fd < (int)maxFd; ++fd )
+        close( fd );
+
+    return;
+}
+
+
+int RunWorker( MODEL_LOADER aLoader )
+{
+    closeInherited();
+
+    wxInitializer initializer;
+
+    if( !initializer.IsOk() )
+        return 1;
+
+    char status = WORKER_READY;
+
+    if( !sendAll( WORKER_FD, &status, 1 ) )
+        return 1;
+
+    std::string fileName;
+    std::string output;
+
+    // the host closes its end of the socket when it exits
+    while( readString( WORKER_FD, fileName ) && readString( WORKER_FD, output ) )
+    {
+        status = 0;
+        SCENEGRAPH* scene = aLoader( fileName.c_str() );
+        LOAD_STATS stats;
+
+        if( !GetLoadStats( fileName.c_str(), stats ) )
+            memset( &stats, 0, sizeof( stats ) );
+
+        if( NULL != scene )
+        {
+            if( S3D::WriteCache( output.c_str(), true, (SGNODE*)scene, "PLUGIN_3D_OCE" ) )
+                status = 1;
+
+            S3D::DestroyNode( (SGNODE*)scene );
+        }
+
+        if( !sendAll( WORKER_FD, &status, 1 )
+            || !sendAll( WORKER_FD, (const char*)&stats, sizeof( stats ) ) )
+            return 1;
+    }
+
+    return 0;
+}
+
+#else   // _WIN32
+
+// there is no worker support on Windows; models are always loaded in-process
+int GetWorkerCount( void )
+{
+    return 0;
+}
+
+
+SCENEGRAPH* LoadInWorker( char const* aFileName, MODEL_LOADER aLoader )
+{
+    return aLoader( aFileName );
+}
+
+
+int RunWorker( MODEL_LOADER aLoader )
+{
+    return 1;
+}
+
+#endif
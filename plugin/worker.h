@@ -0,0 +1,72 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file worker.h
+ * provides out-of-process model loading so that a crash or hang within
+ * OCE cannot take down the host application
+ */
+
+#ifndef OCE_WORKER_H
+#define OCE_WORKER_H
+
+class SCENEGRAPH;
+
+typedef SCENEGRAPH* (*MODEL_LOADER)( char const* aFileName );
+
+/**
+ * Function GetWorkerCount
+ * returns the maximum number of worker processes as set by the
+ * environment variable KICAD_OCE_WORKERS; 0 (the default, and the only
+ * value on Windows) means models are loaded in-process.
+ */
+int GetWorkerCount( void );
+
+/**
+ * Function LoadInWorker
+ * loads a model in a worker process which serializes the resulting scene
+ * graph to a temporary cache file; the host then reads the scene back.
+ * Workers are instances of the kicad_oce_worker program found next to the
+ * plugin (or at the path in KICAD_OCE_WORKER) and are kept for reuse by
+ * later loads. At most GetWorkerCount() workers exist at once; further
+ * callers wait for an idle worker. A worker which crashes or exceeds the
+ * time limit set by KICAD_OCE_TIMEOUT (seconds, default 300) is discarded.
+ * If no worker can be started the model is loaded in-process by aLoader.
+ *
+ * @param aFileName is the model file to load
+ * @param aLoader is the function which creates the scene graph in-process
+ * @return the scene graph or NULL if the worker did not succeed
+ */
+SCENEGRAPH* LoadInWorker( char const* aFileName, MODEL_LOADER aLoader );
+
+/**
+ * Function RunWorker
+ * is the body of the kicad_oce_worker program; it serves load requests
+ * from the host with aLoader until the host closes the connection.
+ *
+ * @param aLoader is the function which creates the scene graph
+ * @return the exit status of the worker
+ */
+int RunWorker( MODEL_LOADER aLoader );
+
+#endif  // OCE_WORKER_H
@@ -24,6 +24,10 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
 #include <wx/filename.h>
 #include <wx/log.h>
 #include "plugins/3dapi/ifsg_api.h"
@@ -33,6 +37,14 @@
 #include "3d_cache/sg/sg_appearance.h"
 #include "3d_cache/sg/sg_shape.h"
 #include "3d_cache/sg/sg_helpers.h"
+#include "3d_cache/sg/sg_arena.h"
+#include "3d_cache/sg/sg_bvh.h"
+#include "3d_cache/sg/sg_faceset.h"
+#include "3d_cache/sg/sg_coords.h"
+#include "3d_cache/sg/sg_normals.h"
+#include "3d_cache/sg/sg_colors.h"
+#include "3d_cache/sg/sg_coordindex.h"
+#include "3d_cache/sg/sg_lineset.h"
 
 
 #ifdef DEBUG
@@ -40,7 +52,8 @@ static char BadNode[] = " * [BUG] NULL pointer passed for aNode\n";
 #endif
 
 // version format of the cache file
-#define SG_VERSION_TAG "VERSION:2"
+#define SG_VERSION_TAG "VERSION:5"
+#define SG_BVH_TAG "BVH:1"
 
 
 static void formatMaterial( SMATERIAL& mat, SGAPPEARANCE const* app )
@@ -160,8 +173,8 @@ bool S3D::WriteVRML( const char* filename, bool overwrite, SGNODE* aTopNode,
 
     if( renameNodes )
     {
-        aTopNode->ResetNodeIndex();
-        aTopNode->ReNameNodes();
+        S3D::NAMECTX names;
+        aTopNode->ReNameNodes( names );
     }
 
     aTopNode->WriteVRML( op, reuse );
@@ -224,7 +237,7 @@ void S3D::RenameNodes( SGNODE* aNode )
         return;
     }
 
-    aNode->ReNameNodes();
+    aNode->ReNameNodes( S3D::GetThreadNames() );
 
     return;
 }
@@ -246,12 +259,613 @@ void S3D::DestroyNode( SGNODE* aNode )
         return;
     }
 
-    delete aNode;
+    SGNODE::DestroyTree( aNode );
 
     return;
 }
 
 
+void S3D::BeginArena( void )
+{
+    SG_ARENA::Begin();
+    return;
+}
+
+
+void S3D::EndArena( void )
+{
+    SG_ARENA::End();
+    return;
+}
+
+
+void S3D::FlattenTransforms( SGNODE* aNode, bool aBakeGeometry )
+{
+    if( NULL == aNode || S3D::SGTYPE_TRANSFORM != aNode->GetNodeType() )
+    {
+        #ifdef DEBUG
+        do {
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << BadNode;
+            wxLogTrace( MASK_3D_SG, "%s", ostr.str().c_str() );
+        } while( 0 );
+        #endif
+
+        return;
+    }
+
+    ((SCENEGRAPH*)aNode)->Flatten( aBakeGeometry );
+
+    return;
+}
+
+
+// the nodes and data already counted in one SCENESTATS entry
+struct STATSSINK
+{
+    std::unordered_set< const void* > nodes;
+    std::unordered_set< const void* > data;
+    S3D::SCENESTATS* stats;
+};
+
+
+static size_t nodeSize( S3D::SGTYPES aType )
+{
+    switch( aType )
+    {
+    case S3D::SGTYPE_TRANSFORM:     return sizeof( SCENEGRAPH );
+    case S3D::SGTYPE_APPEARANCE:    return sizeof( SGAPPEARANCE );
+    case S3D::SGTYPE_COLORS:        return sizeof( SGCOLORS );
+    case S3D::SGTYPE_FACESET:       return sizeof( SGFACESET );
+    case S3D::SGTYPE_COORDS:        return sizeof( SGCOORDS );
+    case S3D::SGTYPE_COORDINDEX:    return sizeof( SGCOORDINDEX );
+    case S3D::SGTYPE_NORMALS:       return sizeof( SGNORMALS );
+    case S3D::SGTYPE_SHAPE:         return sizeof( SGSHAPE );
+    case S3D::SGTYPE_LINESET:       return sizeof( SGLINESET );
+    default:                        break;
+    }
+
+    return 0;
+}
+
+
+// counts aCount elements of aSize bytes held at aData unless the
+// same data was already counted through another node
+static void addData( STATSSINK& aSink, const void* aData, size_t aCount, size_t aSize,
+    size_t& aElements, size_t& aBytes )
+{
+    if( 0 == aCount || !aSink.data.insert( aData ).second )
+        return;
+
+    aElements += aCount;
+    aBytes += aCount * aSize;
+
+    return;
+}
+
+
+static void collectStats( SGNODE* aNode, STATSSINK** aSinks, int aNumSinks, bool aRecurse )
+{
+    // the node is examined for each entry which has not yet seen it; an
+    // entry which has seen the node has also seen all of its descendants
+    STATSSINK* active[2];
+    int nActive = 0;
+
+    for( int i = 0; i < aNumSinks; ++i )
+    {
+        if( aSinks[i]->nodes.insert( aNode ).second )
+            active[nActive++] = aSinks[i];
+    }
+
+    if( 0 == nActive )
+        return;
+
+    S3D::SGTYPES type = aNode->GetNodeType();
+    std::vector< SGNODE* > children;
+    std::vector< SGNODE* > refs;
+    aNode->getLinkedNodes( children, refs );
+
+    for( int i = 0; i < nActive; ++i )
+    {
+        STATSSINK& sink = *active[i];
+        S3D::SCENESTATS& st = *sink.stats;
+
+        if( type >= S3D::SGTYPE_TRANSFORM && type < S3D::SGTYPE_END )
+            ++st.m_Nodes[type];
+
+        st.m_NodeBytes += nodeSize( type );
+        st.m_References += refs.size();
+
+        switch( type )
+        {
+        case S3D::SGTYPE_COORDS:
+            {
+                SGCOORDS* pc = (SGCOORDS*)aNode;
+
+                if( pc->IsSinglePrecision() )
+                    addData( sink, pc->fcoords.data(), pc->fcoords.size(), sizeof( SFVEC3F ),
+                             st.m_Vertices, st.m_VertexBytes );
+                else
+                    addData( sink, pc->coords.data(), pc->coords.size(), sizeof( SGPOINT ),
+                             st.m_Vertices, st.m_VertexBytes );
+            }
+            break;
+
+        case S3D::SGTYPE_NORMALS:
+            {
+                SGNORMALS* pn = (SGNORMALS*)aNode;
+
+                if( pn->IsSinglePrecision() )
+                    addData( sink, pn->fnorms.data(), pn->fnorms.size(), sizeof( SFVEC3F ),
+                             st.m_Normals, st.m_NormalBytes );
+                else
+                    addData( sink, pn->norms.data(), pn->norms.size(), sizeof( SGVECTOR ),
+                             st.m_Normals, st.m_NormalBytes );
+            }
+            break;
+
+        case S3D::SGTYPE_COLORS:
+            addData( sink, ((SGCOLORS*)aNode)->colors.data(), ((SGCOLORS*)aNode)->colors.size(),
+                     sizeof( SGCOLOR ), st.m_Colors, st.m_ColorBytes );
+            break;
+
+        case S3D::SGTYPE_COORDINDEX:
+            {
+                SGINDEX* pi = (SGINDEX*)aNode;
+
+                if( pi->IsCompact() )
+                    addData( sink, pi->index16.data(), pi->index16.size(),
+                             sizeof( unsigned short ), st.m_Indices, st.m_IndexBytes );
+                else
+                    addData( sink, pi->index.data(), pi->index.size(), sizeof( int ),
+                             st.m_Indices, st.m_IndexBytes );
+            }
+            break;
+
+        case S3D::SGTYPE_LINESET:
+            {
+                SGLINESET* pl = (SGLINESET*)aNode;
+
+                if( !pl->coords.empty() )
+                    addData( sink, &pl->coords[0], pl->coords.size(), sizeof( SGPOINT ),
+                             st.m_Vertices, st.m_VertexBytes );
+
+                if( !pl->index.empty() )
+                    addData( sink, &pl->index[0], pl->index.size(), sizeof( int ),
+                             st.m_Indices, st.m_IndexBytes );
+            }
+            break;
+
+        case S3D::SGTYPE_SHAPE:
+            st.m_PreparedBytes += ((SGSHAPE*)aNode)->GetPreparedSize();
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if( !aRecurse )
+        return;
+
+    for( size_t i = 0; i < children.size(); ++i )
+        collectStats( children[i], active, nActive, true );
+
+    for( size_t i = 0; i < refs.size(); ++i )
+        collectStats( refs[i], active, nActive, true );
+
+    return;
+}
+
+
+// returns the number of vertices and indices in the tree below aNode with
+// every reference expanded; the result for each node is kept in aMemo so
+// that shared subtrees are only visited once
+static std::pair< size_t, size_t > instancedSize( SGNODE* aNode,
+    std::unordered_map< const SGNODE*, std::pair< size_t, size_t > >& aMemo )
+{
+    std::unordered_map< const SGNODE*, std::pair< size_t, size_t > >::iterator it =
+        aMemo.find( aNode );
+
+    if( it != aMemo.end() )
+        return it->second;
+
+    std::pair< size_t, size_t > size( 0, 0 );
+
+    switch( aNode->GetNodeType() )
+    {
+    case S3D::SGTYPE_COORDS:
+        size.first = ((SGCOORDS*)aNode)->GetSize();
+        break;
+
+    case S3D::SGTYPE_COORDINDEX:
+        size.second = ((SGINDEX*)aNode)->GetSize();
+        break;
+
+    case S3D::SGTYPE_LINESET:
+        size.first = ((SGLINESET*)aNode)->coords.size();
+        size.second = ((SGLINESET*)aNode)->index.size();
+        break;
+
+    default:
+        break;
+    }
+
+    std::vector< SGNODE* > links;
+    aNode->getLinkedNodes( links, links );
+
+    for( size_t i = 0; i < links.size(); ++i )
+    {
+        std::pair< size_t, size_t > sub = instancedSize( links[i], aMemo );
+        size.first += sub.first;
+        size.second += sub.second;
+    }
+
+    aMemo[aNode] = size;
+
+    return size;
+}
+
+
+bool S3D::GetSceneStats( SGNODE* aNode, SCENESTATS& aTotal,
+    SCENESTATS* aChildren, size_t* aNumChildren )
+{
+    memset( &aTotal, 0, sizeof( aTotal ) );
+
+    size_t maxChildren = 0;
+
+    if( NULL != aNumChildren )
+    {
+        if( NULL != aChildren )
+            maxChildren = *aNumChildren;
+
+        *aNumChildren = 0;
+    }
+
+    if( NULL == aNode )
+    {
+        #ifdef DEBUG
+        do {
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << BadNode;
+            wxLogTrace( MASK_3D_SG, "%s", ostr.str().c_str() );
+        } while( 0 );
+        #endif
+
+        return false;
+    }
+
+    std::unordered_map< const SGNODE*, std::pair< size_t, size_t > > memo;
+    STATSSINK total;
+    STATSSINK* sinks[2] = { &total, NULL };
+    total.stats = &aTotal;
+    aTotal.m_Node = aNode;
+
+    if( NULL == aNumChildren )
+    {
+        collectStats( aNode, sinks, 1, true );
+    }
+    else
+    {
+        // count the top node alone, then each linked subtree into its own
+        // entry and into the totals during the same walk
+        std::vector< SGNODE* > links;
+        aNode->getLinkedNodes( links, links );
+        *aNumChildren = links.size();
+        collectStats( aNode, sinks, 1, false );
+
+        for( size_t i = 0; i < links.size(); ++i )
+        {
+            if( i >= maxChildren )
+            {
+                sinks[0] = &total;
+                collectStats( links[i], sinks, 1, true );
+                continue;
+            }
+
+            S3D::SCENESTATS& st = aChildren[i];
+            memset( &st, 0, sizeof( st ) );
+            st.m_Node = links[i];
+
+            std::pair< size_t, size_t > inst = instancedSize( links[i], memo );
+            st.m_InstancedVertices = inst.first;
+            st.m_InstancedIndices = inst.second;
+
+            STATSSINK child;
+            child.stats = &st;
+            sinks[0] = &child;
+            sinks[1] = &total;
+            collectStats( links[i], sinks, 2, true );
+        }
+    }
+
+    std::pair< size_t, size_t > inst = instancedSize( aNode, memo );
+    aTotal.m_InstancedVertices = inst.first;
+    aTotal.m_InstancedIndices = inst.second;
+
+    return true;
+}
+
+
+// the content of a node as compared by MergeDuplicates()
+struct NODEDATA
+{
+    const void* data;
+    size_t      bytes;
+    int         form;           // storage form (precision or index width)
+    bool        shared;         // the data is also held by another node
+    float       values[14];     // material values of an appearance
+};
+
+
+// fills in aData for the node types which MergeDuplicates() handles
+static bool getNodeData( SGNODE* aNode, NODEDATA& aData )
+{
+    aData.data = NULL;
+    aData.bytes = 0;
+    aData.form = 0;
+    aData.shared = false;
+
+    switch( aNode->GetNodeType() )
+    {
+    case S3D::SGTYPE_COORDS:
+        {
+            SGCOORDS* pc = (SGCOORDS*)aNode;
+
+            if( pc->IsSinglePrecision() )
+            {
+                aData.data = pc->fcoords.data();
+                aData.bytes = pc->fcoords.size() * sizeof( SFVEC3F );
+                aData.form = 1;
+                aData.shared = pc->fcoords.IsShared();
+            }
+            else
+            {
+                aData.data = pc->coords.data();
+                aData.bytes = pc->coords.size() * sizeof( SGPOINT );
+                aData.shared = pc->coords.IsShared();
+            }
+        }
+        break;
+
+    case S3D::SGTYPE_NORMALS:
+        {
+            SGNORMALS* pn = (SGNORMALS*)aNode;
+
+            if( pn->IsSinglePrecision() )
+            {
+                aData.data = pn->fnorms.data();
+                aData.bytes = pn->fnorms.size() * sizeof( SFVEC3F );
+                aData.form = 1;
+                aData.shared = pn->fnorms.IsShared();
+            }
+            else
+            {
+                aData.data = pn->norms.data();
+                aData.bytes = pn->norms.size() * sizeof( SGVECTOR );
+                aData.shared = pn->norms.IsShared();
+            }
+        }
+        break;
+
+    case S3D::SGTYPE_COLORS:
+        {
+            SGCOLORS* pc = (SGCOLORS*)aNode;
+            aData.data = pc->colors.data();
+            aData.bytes = pc->colors.size() * sizeof( SGCOLOR );
+            aData.shared = pc->colors.IsShared();
+        }
+        break;
+
+    case S3D::SGTYPE_COORDINDEX:
+        {
+            SGINDEX* pi = (SGINDEX*)aNode;
+
+            if( pi->IsCompact() )
+            {
+                aData.data = pi->index16.data();
+                aData.bytes = pi->index16.size() * sizeof( unsigned short );
+                aData.form = 1;
+                aData.shared = pi->index16.IsShared();
+            }
+            else
+            {
+                aData.data = pi->index.data();
+                aData.bytes = pi->index.size() * sizeof( int );
+                aData.shared = pi->index.IsShared();
+            }
+        }
+        break;
+
+    case S3D::SGTYPE_APPEARANCE:
+        {
+            SGAPPEARANCE* pa = (SGAPPEARANCE*)aNode;
+            float* v = aData.values;
+            pa->ambient.GetColor( v[0], v[1], v[2] );
+            pa->diffuse.GetColor( v[3], v[4], v[5] );
+            pa->emissive.GetColor( v[6], v[7], v[8] );
+            pa->specular.GetColor( v[9], v[10], v[11] );
+            v[12] = pa->shininess;
+            v[13] = pa->transparency;
+            aData.data = v;
+            aData.bytes = sizeof( aData.values );
+        }
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+
+// FNV-1a hash of the node type, storage form and content
+static size_t hashNodeData( S3D::SGTYPES aType, const NODEDATA& aData )
+{
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char* p = (const unsigned char*)aData.data;
+    size_t nw = aData.bytes / sizeof( uint64_t );
+    uint64_t word;
+
+    hash = ( hash ^ (uint64_t)( aType * 4 + aData.form ) ) * prime;
+
+    for( size_t i = 0; i < nw; ++i, p += sizeof( uint64_t ) )
+    {
+        memcpy( &word, p, sizeof( uint64_t ) );
+        hash = ( hash ^ word ) * prime;
+    }
+
+    for( size_t i = nw * sizeof( uint64_t ); i < aData.bytes; ++i, ++p )
+        hash = ( hash ^ *p ) * prime;
+
+    return (size_t)hash;
+}
+
+
+// lists every distinct node of the tree below aNode, including aNode,
+// in the order in which the nodes are first reached
+static void gatherNodes( SGNODE* aNode, std::vector< SGNODE* >& aNodes )
+{
+    aNodes.assign( 1, aNode );
+    std::unordered_set< const SGNODE* > seen( aNodes.begin(), aNodes.end() );
+    std::vector< SGNODE* > links;
+
+    for( size_t i = 0; i < aNodes.size(); ++i )
+    {
+        links.clear();
+        aNodes[i]->getLinkedNodes( links, links );
+
+        for( size_t j = 0; j < links.size(); ++j )
+        {
+            if( seen.insert( links[j] ).second )
+                aNodes.push_back( links[j] );
+        }
+    }
+
+    return;
+}
+
+
+size_t S3D::MergeDuplicates( SGNODE* aNode )
+{
+    if( NULL == aNode )
+    {
+        #ifdef DEBUG
+        do {
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << BadNode;
+            wxLogTrace( MASK_3D_SG, "%s", ostr.str().c_str() );
+        } while( 0 );
+        #endif
+
+        return 0;
+    }
+
+    // the node found first among a set of duplicates is the one
+    // which is retained
+    std::vector< SGNODE* > nodes;
+    gatherNodes( aNode, nodes );
+
+    std::unordered_map< size_t, std::vector< SGNODE* > > unique;
+    size_t saved = 0;
+    NODEDATA nd;
+    NODEDATA cd;
+
+    for( size_t i = 0; i < nodes.size(); ++i )
+    {
+        SGNODE* np = nodes[i];
+        S3D::SGTYPES type = np->GetNodeType();
+
+        if( !getNodeData( np, nd ) )
+            continue;
+
+        std::vector< SGNODE* >& bucket = unique[ hashNodeData( type, nd ) ];
+        SGNODE* match = NULL;
+
+        for( size_t j = 0; j < bucket.size() && NULL == match; ++j )
+        {
+            getNodeData( bucket[j], cd );
+
+            if( bucket[j]->GetNodeType() == type && cd.form == nd.form
+                && cd.bytes == nd.bytes
+                && ( cd.data == nd.data || 0 == memcmp( cd.data, nd.data, nd.bytes ) ) )
+                match = bucket[j];
+        }
+
+        if( NULL == match )
+        {
+            bucket.push_back( np );
+            continue;
+        }
+
+        // the data is freed only if no other node still holds it
+        size_t dataBytes = 0;
+
+        if( S3D::SGTYPE_APPEARANCE != type && !nd.shared && cd.data != nd.data )
+            dataBytes = nd.bytes;
+
+        // a coordinate index list may not be referenced (it is a field
+        // rather than a node in VRML) so only its data can be shared
+        if( S3D::SGTYPE_COORDINDEX == type )
+        {
+            if( cd.data != nd.data )
+                ((SGINDEX*)np)->ShareIndices( (SGINDEX*)match );
+
+            saved += dataBytes;
+            continue;
+        }
+
+        if( SGNODE::ReplaceNode( np, match ) )
+            saved += dataBytes + nodeSize( type );
+    }
+
+    return saved;
+}
+
+
+size_t S3D::RemoveDegenerateFaces( SGNODE* aNode, size_t* aVertices )
+{
+    if( NULL != aVertices )
+        *aVertices = 0;
+
+    if( NULL == aNode )
+    {
+        #ifdef DEBUG
+        do {
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << BadNode;
+            wxLogTrace( MASK_3D_SG, "%s", ostr.str().c_str() );
+        } while( 0 );
+        #endif
+
+        return 0;
+    }
+
+    std::vector< SGNODE* > nodes;
+    gatherNodes( aNode, nodes );
+
+    size_t nFaces = 0;
+    size_t nVertices = 0;
+
+    for( size_t i = 0; i < nodes.size(); ++i )
+    {
+        if( S3D::SGTYPE_FACESET == nodes[i]->GetNodeType() )
+            nFaces += ((SGFACESET*)nodes[i])->RemoveDegenerateFaces( nVertices );
+    }
+
+    if( NULL != aVertices )
+        *aVertices = nVertices;
+
+    return nFaces;
+}
+
+
 bool S3D::WriteCache( const char* aFileName, bool overwrite, SGNODE* aNode,
     const char* aPluginInfo )
 {
@@ -366,6 +980,8 @@ SGNODE* S3D::ReadCache( const char* aFileName, void* aPluginMgr,
         return NULL;
     }
 
+    // a scene read from the cache is always created and destroyed as a whole
+    SG_ARENA_SCOPE arena;
     SGNODE* np = new SCENEGRAPH( NULL );
 
     if( NULL == np )
@@ -478,7 +1094,16 @@ SGNODE* S3D::ReadCache( const char* aFileName, void* aPluginMgr,
 
     } while( 0 );
 
-    bool rval = np->ReadCache( file, NULL );
+    bool rval;
+
+    do
+    {
+        // references within the file are resolved through the nodes
+        // registered while reading rather than by searching the tree
+        S3D::READCTX nodes;
+        rval = np->ReadCache( file, NULL );
+    } while( 0 );
+
     file.close();
 
     if( !rval )
@@ -498,6 +1123,12 @@ SGNODE* S3D::ReadCache( const char* aFileName, void* aPluginMgr,
 
 
 S3DMODEL* S3D::GetModel( SCENEGRAPH* aNode )
+{
+    return GetModel( aNode, 0 );
+}
+
+
+S3DMODEL* S3D::GetModel( SCENEGRAPH* aNode, unsigned int aFlags )
 {
     if( NULL == aNode )
         return NULL;
@@ -506,7 +1137,11 @@ S3DMODEL* S3D::GetModel( SCENEGRAPH* aNode )
         return NULL;
 
     S3D::MATLIST materials;
+    materials.root = aNode;
+    materials.pass = aNode->NextPass();
+    materials.keep = ( aFlags & S3D::GETMODEL_KEEP_PREPARED ) != 0;
     std::vector< SMESH > meshes;
+    std::vector< SLINES > lines;
 
     // the materials list shall have a default color; although the VRML
     // default is an opaque black, the default used here shall be a median
@@ -523,9 +1158,9 @@ S3DMODEL* S3D::GetModel( SCENEGRAPH* aNode )
     materials.matorder.push_back( &app );
     materials.matmap.insert( std::pair< SGAPPEARANCE const*, int >( &app, 0 ) );
 
-    if( aNode->Prepare( NULL, materials, meshes ) )
+    if( aNode->Prepare( NULL, materials, meshes, lines ) )
     {
-        if( meshes.empty() )
+        if( meshes.empty() && lines.empty() )
             return NULL;
 
         S3DMODEL* model = S3D::New3DModel();
@@ -545,11 +1180,75 @@ S3DMODEL* S3D::GetModel( SCENEGRAPH* aNode )
         SMESH* lmesh = new SMESH[j];
 
         for( size_t i = 0; i < j; ++i )
+        {
             lmesh[i] = meshes[i];
 
+            if( !( aFlags & S3D::GETMODEL_INDEX16 ) || lmesh[i].m_VertexSize > 0x10000
+                || NULL == lmesh[i].m_FaceIdx )
+                continue;
+
+            // the 16 bit indices replace the full width array
+            unsigned int ni = lmesh[i].m_FaceIdxSize;
+            lmesh[i].m_FaceIdx16 = new unsigned short[ni];
+
+            for( unsigned int k = 0; k < ni; ++k )
+                lmesh[i].m_FaceIdx16[k] = (unsigned short)lmesh[i].m_FaceIdx[k];
+
+            delete [] lmesh[i].m_FaceIdx;
+            lmesh[i].m_FaceIdx = NULL;
+        }
+
         model->m_Meshes = lmesh;
         model->m_MeshesSize = j;
 
+        // add all the feature edge lines
+        j = lines.size();
+
+        if( j > 0 )
+        {
+            SLINES* llines = new SLINES[j];
+
+            for( size_t i = 0; i < j; ++i )
+                llines[i] = lines[i];
+
+            model->m_Lines = llines;
+            model->m_LinesSize = j;
+        }
+
+        // the model bounds enclose the bounds of all meshes and lines
+        bool hasBounds = false;
+
+        for( size_t i = 0; i < meshes.size(); ++i )
+        {
+            if( !hasBounds )
+            {
+                model->m_BBoxMin = meshes[i].m_BBoxMin;
+                model->m_BBoxMax = meshes[i].m_BBoxMax;
+                hasBounds = true;
+                continue;
+            }
+
+            model->m_BBoxMin = glm::min( model->m_BBoxMin, meshes[i].m_BBoxMin );
+            model->m_BBoxMax = glm::max( model->m_BBoxMax, meshes[i].m_BBoxMax );
+        }
+
+        for( size_t i = 0; i < lines.size(); ++i )
+        {
+            for( unsigned int k = 0; k < lines[i].m_VertexSize; ++k )
+            {
+                if( !hasBounds )
+                {
+                    model->m_BBoxMin = lines[i].m_Positions[k];
+                    model->m_BBoxMax = lines[i].m_Positions[k];
+                    hasBounds = true;
+                    continue;
+                }
+
+                model->m_BBoxMin = glm::min( model->m_BBoxMin, lines[i].m_Positions[k] );
+                model->m_BBoxMax = glm::max( model->m_BBoxMax, lines[i].m_Positions[k] );
+            }
+        }
+
         return model;
     }
 
@@ -558,6 +1257,11 @@ S3DMODEL* S3D::GetModel( SCENEGRAPH* aNode )
     for( size_t i = 0; i < j; ++i )
         S3D::Free3DMesh( meshes[i] );
 
+    j = lines.size();
+
+    for( size_t i = 0; i < j; ++i )
+        S3D::FREE_SLINES( lines[i] );
+
     return NULL;
 }
 
@@ -613,6 +1317,162 @@ void S3D::Init3DMesh( SMESH& aMesh )
 }
 
 
+SGBVH* S3D::BuildBVH( const S3DMODEL* aModel )
+{
+    if( NULL == aModel )
+        return NULL;
+
+    SGBVH* bvh = new SGBVH;
+
+    if( !bvh->Build( *aModel ) )
+    {
+        delete bvh;
+        return NULL;
+    }
+
+    return bvh;
+}
+
+
+SGBVH* S3D::BuildBVH( SCENEGRAPH* aNode )
+{
+    S3DMODEL* model = S3D::GetModel( aNode );
+
+    if( NULL == model )
+        return NULL;
+
+    SGBVH* bvh = S3D::BuildBVH( model );
+    S3D::Destroy3DModel( &model );
+
+    return bvh;
+}
+
+
+bool S3D::IntersectBVH( const SGBVH* aBVH, const SFVEC3F& aOrigin,
+    const SFVEC3F& aDirection, float aMaxDistance, BVHHIT& aHit )
+{
+    if( NULL == aBVH )
+        return false;
+
+    return aBVH->Intersect( aOrigin, aDirection, aMaxDistance, false, aHit );
+}
+
+
+bool S3D::OccludedBVH( const SGBVH* aBVH, const SFVEC3F& aOrigin,
+    const SFVEC3F& aDirection, float aMaxDistance )
+{
+    if( NULL == aBVH )
+        return false;
+
+    BVHHIT hit;
+    return aBVH->Intersect( aOrigin, aDirection, aMaxDistance, true, hit );
+}
+
+
+bool S3D::WriteBVH( const char* aFileName, bool overwrite, const SGBVH* aBVH )
+{
+    if( NULL == aFileName || aFileName[0] == 0 || NULL == aBVH )
+        return false;
+
+    wxString ofile = wxString::FromUTF8Unchecked( aFileName );
+
+    if( wxFileName::Exists( ofile ) && ( !overwrite || !wxFileName::FileExists( ofile ) ) )
+    {
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        wxString errmsg = _( "file exists; not overwriting" );
+        ostr << " * [INFO] " << errmsg.ToUTF8() << " '";
+        ostr << aFileName << "'";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+
+        return false;
+    }
+
+    std::ofstream output;
+    output.open( aFileName, std::ios_base::out | std::ios_base::trunc
+                                | std::ios_base::binary );
+
+    if( !output.is_open() )
+    {
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        wxString errmsg = _( "failed to open file" );
+        ostr << " * [INFO] " << errmsg.ToUTF8() << " '" << aFileName << "'";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        return false;
+    }
+
+    output << "(" << SG_BVH_TAG << ")";
+    bool rval = aBVH->WriteCache( output );
+    output.close();
+
+    // delete the defective file
+    if( !rval )
+        wxRemoveFile( ofile );
+
+    return rval;
+}
+
+
+SGBVH* S3D::ReadBVH( const char* aFileName )
+{
+    if( NULL == aFileName || aFileName[0] == 0 )
+        return NULL;
+
+    if( !wxFileName::FileExists( aFileName ) )
+        return NULL;
+
+    std::ifstream file;
+    file.open( aFileName, std::ios_base::in | std::ios_base::binary );
+
+    if( !file.is_open() )
+    {
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        wxString errmsg = _( "failed to open file" );
+        ostr << " * [INFO] " << errmsg.ToUTF8() << " '";
+        ostr << aFileName << "'";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        return NULL;
+    }
+
+    // a file with a different tag was written by an incompatible version
+    std::string tag = std::string( "(" ) + SG_BVH_TAG + ")";
+    std::string name( tag.size(), 0 );
+    file.read( &name[0], tag.size() );
+
+    if( file.fail() || name != tag )
+    {
+        file.close();
+        return NULL;
+    }
+
+    SGBVH* bvh = new SGBVH;
+
+    if( !bvh->ReadCache( file ) )
+    {
+        delete bvh;
+        bvh = NULL;
+    }
+
+    file.close();
+
+    return bvh;
+}
+
+
+void S3D::DestroyBVH( SGBVH** aBVH )
+{
+    if( NULL == aBVH || NULL == *aBVH )
+        return;
+
+    delete *aBVH;
+    *aBVH = NULL;
+
+    return;
+}
+
+
 void S3D::GetLibVersion( unsigned char* Major, unsigned char* Minor,
     unsigned char* Patch, unsigned char* Revision )
 {
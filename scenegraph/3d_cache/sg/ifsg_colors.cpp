@@ -30,6 +30,7 @@
 
 
 extern char BadObject[];
+extern char BadOperand[];
 extern char BadParent[];
 extern char WrongParent[];
 
@@ -265,3 +266,37 @@ bool IFSG_COLORS::AddColor( const SGCOLOR& aColor )
 
     return true;
 }
+
+
+bool IFSG_COLORS::ShareColorList( IFSG_COLORS& aSource )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    SGNODE* np = aSource.GetRawPtr();
+
+    if( NULL == np )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadOperand;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGCOLORS*)m_node)->ShareColorList( (SGCOLORS*)np );
+
+    return true;
+}
@@ -30,6 +30,7 @@
 
 
 extern char BadObject[];
+extern char BadOperand[];
 extern char BadParent[];
 extern char WrongParent[];
 
@@ -265,3 +266,153 @@ bool IFSG_COORDS::AddCoord( const SGPOINT& aPoint )
 
     return true;
 }
+
+
+bool IFSG_COORDS::SetSinglePrecision( bool aSinglePrecision )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGCOORDS*)m_node)->SetSinglePrecision( aSinglePrecision );
+
+    return true;
+}
+
+
+bool IFSG_COORDS::IsSinglePrecision( void )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGCOORDS*)m_node)->IsSinglePrecision();
+}
+
+
+bool IFSG_COORDS::GetCoordsList( size_t& aListSize, SFVEC3F*& aCoordsList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGCOORDS*)m_node)->GetCoordsList( aListSize, aCoordsList );
+}
+
+
+bool IFSG_COORDS::SetCoordsList( size_t aListSize, const SFVEC3F* aCoordsList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGCOORDS*)m_node)->SetCoordsList( aListSize, aCoordsList );
+
+    return true;
+}
+
+
+bool IFSG_COORDS::TakeCoordsList( std::vector< SGPOINT >& aCoordsList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGCOORDS*)m_node)->TakeCoordsList( aCoordsList );
+
+    return true;
+}
+
+
+bool IFSG_COORDS::TakeCoordsList( std::vector< SFVEC3F >& aCoordsList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGCOORDS*)m_node)->TakeCoordsList( aCoordsList );
+
+    return true;
+}
+
+
+bool IFSG_COORDS::ShareCoordsList( IFSG_COORDS& aSource )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    SGNODE* np = aSource.GetRawPtr();
+
+    if( NULL == np )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadOperand;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGCOORDS*)m_node)->ShareCoordsList( (SGCOORDS*)np );
+
+    return true;
+}
@@ -191,9 +191,15 @@ bool IFSG_FACESET::NewNode( IFSG_NODE& aParent )
 
 
 bool IFSG_FACESET::CalcNormals( SGNODE** aPtr )
+{
+    return CalcNormals( aPtr, S3D::NORMALWEIGHT_AREA );
+}
+
+
+bool IFSG_FACESET::CalcNormals( SGNODE** aPtr, S3D::NORMALWEIGHT aWeight )
 {
     if( m_node )
-        return ((SGFACESET*)m_node)->CalcNormals( aPtr );
+        return ((SGFACESET*)m_node)->CalcNormals( aPtr, aWeight );
 
     return false;
 }
@@ -98,3 +98,77 @@ bool IFSG_INDEX::AddIndex( int aIndex )
 
     return true;
 }
+
+
+bool IFSG_INDEX::AddIndices( size_t nIndices, const int* aIndexList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGINDEX*)m_node)->AddIndices( nIndices, aIndexList );
+
+    return true;
+}
+
+
+bool IFSG_INDEX::TakeIndices( std::vector< int >& aIndexList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGINDEX*)m_node)->TakeIndices( aIndexList );
+
+    return true;
+}
+
+
+bool IFSG_INDEX::ShareIndices( IFSG_INDEX& aSource )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    SGNODE* np = aSource.GetRawPtr();
+
+    if( NULL == np )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadOperand;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGINDEX*)m_node)->ShareIndices( (SGINDEX*)np );
+
+    return true;
+}
@@ -0,0 +1,306 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+
+#include <iostream>
+#include <sstream>
+#include <wx/log.h>
+
+#include "plugins/3dapi/ifsg_lineset.h"
+#include "3d_cache/sg/sg_lineset.h"
+
+
+extern char BadObject[];
+extern char BadParent[];
+extern char WrongParent[];
+
+
+IFSG_LINESET::IFSG_LINESET( bool create )
+{
+    m_node = NULL;
+
+    if( !create )
+        return ;
+
+    m_node = new SGLINESET( NULL );
+
+    if( m_node )
+        m_node->AssociateWrapper( &m_node );
+
+    return;
+}
+
+
+IFSG_LINESET::IFSG_LINESET( SGNODE* aParent )
+{
+    m_node = new SGLINESET( NULL );
+
+    if( m_node )
+    {
+        if( !m_node->SetParent( aParent ) )
+        {
+            delete m_node;
+            m_node = NULL;
+
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << WrongParent;
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return;
+        }
+
+        m_node->AssociateWrapper( &m_node );
+    }
+
+    return;
+}
+
+
+IFSG_LINESET::IFSG_LINESET( IFSG_NODE& aParent )
+{
+    SGNODE* pp = aParent.GetRawPtr();
+
+    #ifdef DEBUG
+    if( ! pp )
+    {
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadParent;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+    }
+    #endif
+
+    m_node = new SGLINESET( NULL );
+
+    if( m_node )
+    {
+        if( !m_node->SetParent( pp ) )
+        {
+            delete m_node;
+            m_node = NULL;
+
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << WrongParent;
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return;
+        }
+
+        m_node->AssociateWrapper( &m_node );
+    }
+
+    return;
+}
+
+
+bool IFSG_LINESET::Attach( SGNODE* aNode )
+{
+    if( m_node )
+        m_node->DisassociateWrapper( &m_node );
+
+    m_node = NULL;
+
+    if( !aNode )
+        return false;
+
+    if( S3D::SGTYPE_LINESET != aNode->GetNodeType() )
+    {
+        return false;
+    }
+
+    m_node = aNode;
+    m_node->AssociateWrapper( &m_node );
+
+    return true;
+}
+
+
+bool IFSG_LINESET::NewNode( SGNODE* aParent )
+{
+    if( m_node )
+        m_node->DisassociateWrapper( &m_node );
+
+    m_node = new SGLINESET( aParent );
+
+    if( aParent != m_node->GetParent() )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [BUG] invalid SGNODE parent (";
+        ostr << aParent->GetNodeTypeName( aParent->GetNodeType() );
+        ostr << ") to SGLINESET";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        delete m_node;
+        m_node = NULL;
+        return false;
+    }
+
+    m_node->AssociateWrapper( &m_node );
+
+    return true;
+}
+
+
+bool IFSG_LINESET::NewNode( IFSG_NODE& aParent )
+{
+    SGNODE* np = aParent.GetRawPtr();
+
+    if( NULL == np )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadParent;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return NewNode( np );
+}
+
+
+bool IFSG_LINESET::GetCoordsList( size_t& aListSize, SGPOINT*& aCoordsList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGLINESET*)m_node)->GetCoordsList( aListSize, aCoordsList );
+}
+
+
+bool IFSG_LINESET::SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGLINESET*)m_node)->SetCoordsList( aListSize, aCoordsList );
+
+    return true;
+}
+
+
+bool IFSG_LINESET::AddCoord( const SGPOINT& aPoint )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGLINESET*)m_node)->AddCoord( aPoint );
+
+    return true;
+}
+
+
+bool IFSG_LINESET::GetIndices( size_t& nIndices, int*& aIndexList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGLINESET*)m_node)->GetIndices( nIndices, aIndexList );
+}
+
+
+bool IFSG_LINESET::SetIndices( size_t nIndices, int* aIndexList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGLINESET*)m_node)->SetIndices( nIndices, aIndexList );
+
+    return true;
+}
+
+
+bool IFSG_LINESET::AddSegment( int aIndex0, int aIndex1 )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGLINESET*)m_node)->AddSegment( aIndex0, aIndex1 );
+
+    return true;
+}
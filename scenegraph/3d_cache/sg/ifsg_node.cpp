@@ -56,7 +56,7 @@ void IFSG_NODE::Destroy( void )
     if( m_node )
         m_node->DisassociateWrapper( &m_node );
 
-    delete m_node;
+    SGNODE::DestroyTree( m_node );
     m_node = NULL;
 
     return;
@@ -264,3 +264,113 @@ bool IFSG_NORMALS::AddNormal( const SGVECTOR& aNormal )
     ((SGNORMALS*)m_node)->AddNormal( aNormal );
     return true;
 }
+
+
+bool IFSG_NORMALS::SetSinglePrecision( bool aSinglePrecision )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGNORMALS*)m_node)->SetSinglePrecision( aSinglePrecision );
+
+    return true;
+}
+
+
+bool IFSG_NORMALS::IsSinglePrecision( void )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGNORMALS*)m_node)->IsSinglePrecision();
+}
+
+
+bool IFSG_NORMALS::GetNormalList( size_t& aListSize, SFVEC3F*& aNormalList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGNORMALS*)m_node)->GetNormalList( aListSize, aNormalList );
+}
+
+
+bool IFSG_NORMALS::SetNormalList( size_t aListSize, const SFVEC3F* aNormalList )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGNORMALS*)m_node)->SetNormalList( aListSize, aNormalList );
+
+    return true;
+}
+
+
+bool IFSG_NORMALS::ShareNormalList( IFSG_NORMALS& aSource )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    SGNODE* np = aSource.GetRawPtr();
+
+    if( NULL == np )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadOperand;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    ((SGNORMALS*)m_node)->ShareNormalList( (SGNORMALS*)np );
+
+    return true;
+}
@@ -189,3 +189,39 @@ bool IFSG_SHAPE::NewNode( IFSG_NODE& aParent )
 
     return NewNode( np );
 }
+
+
+bool IFSG_SHAPE::GetBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGSHAPE*)m_node)->GetBounds( aMin, aMax );
+}
+
+
+bool IFSG_SHAPE::GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SGSHAPE*)m_node)->GetWorldBounds( aMin, aMax );
+}
@@ -150,6 +150,47 @@ bool IFSG_TRANSFORM::NewNode( IFSG_NODE& aParent )
 }
 
 
+bool IFSG_TRANSFORM::SetMatrix( const double* aMatrix )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    if( NULL == aMatrix )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [BUG] NULL pointer passed for aMatrix";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    // note: glm matrices are indexed as [column][row]
+    glm::dmat4 tx( 1.0 );
+
+    for( int row = 0; row < 3; ++row )
+    {
+        for( int col = 0; col < 4; ++col )
+            tx[col][row] = aMatrix[row * 4 + col];
+    }
+
+    ((SCENEGRAPH*)m_node)->SetMatrix( tx );
+
+    return true;
+}
+
+
 bool IFSG_TRANSFORM::SetRotation( const SGVECTOR& aRotationAxis, double aAngle )
 {
     if( NULL == m_node )
@@ -164,8 +205,10 @@ bool IFSG_TRANSFORM::SetRotation( const SGVECTOR& aRotationAxis, double aAngle )
         return false;
     }
 
+    ((SCENEGRAPH*)m_node)->ClearMatrix();
     ((SCENEGRAPH*)m_node)->rotation_axis = aRotationAxis;
     ((SCENEGRAPH*)m_node)->rotation_angle = aAngle;
+    m_node->setDirty();
 
     return true;
 }
@@ -185,7 +228,9 @@ bool IFSG_TRANSFORM::SetScale( const SGPOINT& aScale )
         return false;
     }
 
+    ((SCENEGRAPH*)m_node)->ClearMatrix();
     ((SCENEGRAPH*)m_node)->scale = aScale;
+    m_node->setDirty();
 
     return true;
 }
@@ -217,7 +262,9 @@ bool IFSG_TRANSFORM::SetScale( double aScale )
         return false;
     }
 
+    ((SCENEGRAPH*)m_node)->ClearMatrix();
     ((SCENEGRAPH*)m_node)->scale = SGPOINT( aScale, aScale, aScale );
+    m_node->setDirty();
 
     return true;
 }
@@ -237,7 +284,9 @@ bool IFSG_TRANSFORM::SetTranslation( const SGPOINT& aTranslation )
         return false;
     }
 
+    ((SCENEGRAPH*)m_node)->ClearMatrix();
     ((SCENEGRAPH*)m_node)->translation = aTranslation;
+    m_node->setDirty();
 
     return true;
 }
@@ -257,8 +306,10 @@ bool IFSG_TRANSFORM::SetScaleOrientation( const SGVECTOR& aScaleAxis, double aAn
         return false;
     }
 
+    ((SCENEGRAPH*)m_node)->ClearMatrix();
     ((SCENEGRAPH*)m_node)->scale_axis = aScaleAxis;
     ((SCENEGRAPH*)m_node)->scale_angle = aAngle;
+    m_node->setDirty();
 
     return true;
 }
@@ -278,7 +329,45 @@ bool IFSG_TRANSFORM::SetCenter( const SGPOINT& aCenter )
         return false;
     }
 
+    ((SCENEGRAPH*)m_node)->ClearMatrix();
     ((SCENEGRAPH*)m_node)->center = aCenter;
+    m_node->setDirty();
 
     return true;
 }
+
+
+bool IFSG_TRANSFORM::GetBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SCENEGRAPH*)m_node)->GetBounds( aMin, aMax );
+}
+
+
+bool IFSG_TRANSFORM::GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( NULL == m_node )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << BadObject;
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    return ((SCENEGRAPH*)m_node)->GetWorldBounds( aMin, aMax );
+}
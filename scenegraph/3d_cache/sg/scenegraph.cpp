@@ -23,6 +23,7 @@
 
 #define GLM_FORCE_RADIANS
 
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <glm/glm.hpp>
@@ -33,12 +34,23 @@
 #include "3d_cache/sg/sg_shape.h"
 #include "3d_cache/sg/sg_helpers.h"
 
+// tolerances used to detect identity transforms
+#define IDENT_LIN_TOL (1e-9)
+#define IDENT_ANG_TOL (1e-9)
+// number of child and referenced nodes above which a membership index is kept
+#define MEMBER_INDEX_MIN (16)
+
 
 SCENEGRAPH::SCENEGRAPH( SGNODE* aParent ) : SGNODE( aParent )
 {
     m_SGtype = S3D::SGTYPE_TRANSFORM;
     rotation_angle = 0.0;
     scale_angle = 0.0;
+    m_Identity = true;
+    m_MatrixValid = false;
+    m_HasBounds = false;
+    m_HasAffine = false;
+    m_PassCount = 0;
 
     scale.x = 1.0;
     scale.y = 1.0;
@@ -67,9 +79,13 @@ SCENEGRAPH::SCENEGRAPH( SGNODE* aParent ) : SGNODE( aParent )
 
 SCENEGRAPH::~SCENEGRAPH()
 {
-    // drop references
-    DROP_REFS( SCENEGRAPH, m_RTransforms );
-    DROP_REFS( SGSHAPE, m_RShape );
+    // drop references; a node released by DestroyTree()
+    // no longer needs to unlink itself from its references
+    if( !m_detached )
+    {
+        DROP_REFS( SCENEGRAPH, m_RTransforms );
+        DROP_REFS( SGSHAPE, m_RShape );
+    }
 
     // delete owned objects
     DEL_OBJS( SCENEGRAPH, m_Transforms );
@@ -114,7 +130,7 @@ SGNODE* SCENEGRAPH::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     FIND_NODE( SCENEGRAPH, aNodeName, m_Transforms, aCaller );
@@ -133,6 +149,9 @@ void SCENEGRAPH::unlinkNode( const SGNODE* aNode, bool isChild )
     if( NULL == aNode )
         return;
 
+    // the bounds of this node no longer include the node
+    setDirty();
+
     UNLINK_NODE( S3D::SGTYPE_TRANSFORM, SCENEGRAPH, aNode, m_Transforms, m_RTransforms, isChild );
     UNLINK_NODE( S3D::SGTYPE_SHAPE, SGSHAPE, aNode, m_Shape, m_RShape, isChild );
 
@@ -177,6 +196,8 @@ bool SCENEGRAPH::addNode( SGNODE* aNode, bool isChild )
         return false;
     }
 
+    setDirty();
+
     ADD_NODE( S3D::SGTYPE_TRANSFORM, SCENEGRAPH, aNode, m_Transforms, m_RTransforms, isChild );
     ADD_NODE( S3D::SGTYPE_SHAPE, SGSHAPE, aNode, m_Shape, m_RShape, isChild );
 
@@ -194,6 +215,69 @@ bool SCENEGRAPH::addNode( SGNODE* aNode, bool isChild )
 }
 
 
+void SCENEGRAPH::getLinkedNodes( std::vector< SGNODE* >& aChildren,
+    std::vector< SGNODE* >& aRefs ) const
+{
+    aChildren.insert( aChildren.end(), m_Transforms.begin(), m_Transforms.end() );
+    aChildren.insert( aChildren.end(), m_Shape.begin(), m_Shape.end() );
+    aRefs.insert( aRefs.end(), m_RTransforms.begin(), m_RTransforms.end() );
+    aRefs.insert( aRefs.end(), m_RShape.begin(), m_RShape.end() );
+
+    return;
+}
+
+
+bool SCENEGRAPH::isMember( const SGNODE* aNode )
+{
+    if( m_Members.empty() )
+    {
+        size_t nItems = m_Transforms.size() + m_RTransforms.size()
+            + m_Shape.size() + m_RShape.size();
+
+        if( nItems < MEMBER_INDEX_MIN )
+        {
+            if( S3D::SGTYPE_TRANSFORM == aNode->GetNodeType() )
+            {
+                return std::find( m_Transforms.begin(), m_Transforms.end(), aNode )
+                        != m_Transforms.end()
+                    || std::find( m_RTransforms.begin(), m_RTransforms.end(), aNode )
+                        != m_RTransforms.end();
+            }
+
+            return std::find( m_Shape.begin(), m_Shape.end(), aNode ) != m_Shape.end()
+                || std::find( m_RShape.begin(), m_RShape.end(), aNode ) != m_RShape.end();
+        }
+
+        m_Members.reserve( 2 * nItems );
+        m_Members.insert( m_Transforms.begin(), m_Transforms.end() );
+        m_Members.insert( m_RTransforms.begin(), m_RTransforms.end() );
+        m_Members.insert( m_Shape.begin(), m_Shape.end() );
+        m_Members.insert( m_RShape.begin(), m_RShape.end() );
+    }
+
+    return m_Members.count( aNode ) > 0;
+}
+
+
+void SCENEGRAPH::addMember( const SGNODE* aNode )
+{
+    // an empty index has not been built yet
+    if( !m_Members.empty() )
+        m_Members.insert( aNode );
+
+    return;
+}
+
+
+void SCENEGRAPH::delMember( const SGNODE* aNode )
+{
+    if( !m_Members.empty() )
+        m_Members.erase( aNode );
+
+    return;
+}
+
+
 bool SCENEGRAPH::AddRefNode( SGNODE* aNode )
 {
     return addNode( aNode, false );
@@ -206,13 +290,12 @@ bool SCENEGRAPH::AddChildNode( SGNODE* aNode )
 }
 
 
-void SCENEGRAPH::ReNameNodes( void )
+void SCENEGRAPH::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 
     // rename all shapes
     do
@@ -222,7 +305,7 @@ void SCENEGRAPH::ReNameNodes( void )
 
         while( sL != eL )
         {
-            (*sL)->ReNameNodes();
+            (*sL)->ReNameNodes( aNames );
             ++sL;
         }
 
@@ -236,7 +319,7 @@ void SCENEGRAPH::ReNameNodes( void )
 
         while( sL != eL )
         {
-            (*sL)->ReNameNodes();
+            (*sL)->ReNameNodes( aNames );
             ++sL;
         }
 
@@ -386,8 +469,8 @@ bool SCENEGRAPH::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     if( NULL == m_Parent )
     {
         // ensure unique node names
-        ResetNodeIndex();
-        ReNameNodes();
+        S3D::NAMECTX names;
+        ReNameNodes( names );
     }
 
     if( aFile.fail() )
@@ -402,7 +485,7 @@ bool SCENEGRAPH::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    aFile << "[" << GetName() << "]";
+    S3D::WriteTag( aFile, this );
     S3D::WritePoint( aFile, center );
     S3D::WritePoint( aFile, translation );
     S3D::WriteVector( aFile, rotation_axis );
@@ -410,6 +493,14 @@ bool SCENEGRAPH::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     S3D::WritePoint( aFile, scale );
     S3D::WriteVector( aFile, scale_axis );
     aFile.write( (char*)&scale_angle, sizeof( scale_angle ) );
+    aFile.write( (char*)&m_HasAffine, sizeof( m_HasAffine ) );
+
+    // an assigned matrix is stored as its upper 3x4 part
+    for( int i = 0; m_HasAffine && i < 4; ++i )
+    {
+        for( int j = 0; j < 3; ++j )
+            aFile.write( (char*)&m_Affine[i][j], sizeof( double ) );
+    }
 
     // Transfer ownership of any Transform references which hadn't been written
     size_t asize = m_RTransforms.size();
@@ -467,7 +558,7 @@ bool SCENEGRAPH::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     // write referenced transform names
     asize = m_RTransforms.size();
     for( i = 0; i < asize; ++i )
-        aFile << "[" << m_RTransforms[i]->GetName() << "]";
+        S3D::WriteTag( aFile, m_RTransforms[i] );
 
     // write child shapes
     asize = m_Shape.size();
@@ -489,7 +580,7 @@ bool SCENEGRAPH::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     // write referenced transform names
     asize = m_RShape.size();
     for( i = 0; i < asize; ++i )
-        aFile << "[" << m_RShape[i]->GetName() << "]";
+        S3D::WriteTag( aFile, m_RShape[i] );
 
     if( aFile.fail() )
         return false;
@@ -514,12 +605,12 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    std::string name;   // name of the node
+    unsigned int id = 0;    // ID of the node
 
     if( NULL == parentNode )
     {
         // we need to read the tag and verify its type
-        if( S3D::SGTYPE_TRANSFORM != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_TRANSFORM != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -532,7 +623,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        m_Name = name;
+        SetID( id );
     }
 
     // read fixed member data
@@ -543,6 +634,15 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     S3D::ReadPoint( aFile, scale );
     S3D::ReadVector( aFile, scale_axis );
     aFile.read( (char*)&scale_angle, sizeof( scale_angle ) );
+    aFile.read( (char*)&m_HasAffine, sizeof( m_HasAffine ) );
+    m_Affine = glm::dmat4( 1.0 );
+    m_MatrixValid = false;
+
+    for( int i = 0; m_HasAffine && i < 4; ++i )
+    {
+        for( int j = 0; j < 3; ++j )
+            aFile.read( (char*)&m_Affine[i][j], sizeof( double ) );
+    }
 
     size_t sizeCT = 0;  // child transforms
     size_t sizeRT = 0;  // referenced transforms
@@ -559,7 +659,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     // read child transforms
     for( i = 0; i < sizeCT; ++i )
     {
-        if( S3D::SGTYPE_TRANSFORM != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_TRANSFORM != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -573,7 +673,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         SCENEGRAPH* sp = new SCENEGRAPH( this );
-        sp->SetName( name.c_str() );
+        sp->SetID( id );
 
         if( !sp->ReadCache( aFile, this ) )
         {
@@ -581,7 +681,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading transform '";
-            ostr << name << "' pos " << aFile.tellg();
+            ostr << id << "' pos " << aFile.tellg();
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -592,7 +692,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     // read referenced transforms
     for( i = 0; i < sizeRT; ++i )
     {
-        if( S3D::SGTYPE_TRANSFORM != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_TRANSFORM != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -605,7 +705,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* sp = FindNode( name.c_str(), this );
+        SGNODE* sp = FindNodeID( S3D::SGTYPE_TRANSFORM, id, this );
 
         if( !sp )
         {
@@ -613,7 +713,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref transform '";
-            ostr << name << "' pos " << aFile.tellg();
+            ostr << id << "' pos " << aFile.tellg();
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -626,7 +726,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not TRANSFORM '";
-            ostr << name << "' pos " << aFile.tellg();
+            ostr << id << "' pos " << aFile.tellg();
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -639,7 +739,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     // read child shapes
     for( i = 0; i < sizeCS; ++i )
     {
-        if( S3D::SGTYPE_SHAPE != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_SHAPE != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -653,7 +753,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         SGSHAPE* sp = new SGSHAPE( this );
-        sp->SetName( name.c_str() );
+        sp->SetID( id );
 
         if( !sp->ReadCache( aFile, this ) )
         {
@@ -661,7 +761,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading shape '";
-            ostr << name << "' pos " << aFile.tellg();
+            ostr << id << "' pos " << aFile.tellg();
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -672,7 +772,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     // read referenced shapes
     for( i = 0; i < sizeRS; ++i )
     {
-        if( S3D::SGTYPE_SHAPE != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_SHAPE != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -685,7 +785,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* sp = FindNode( name.c_str(), this );
+        SGNODE* sp = FindNodeID( S3D::SGTYPE_SHAPE, id, this );
 
         if( !sp )
         {
@@ -693,7 +793,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref shape '";
-            ostr << name << "' pos " << aFile.tellg();
+            ostr << id << "' pos " << aFile.tellg();
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -706,7 +806,7 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not SGSHAPE '";
-            ostr << name << "' pos " << aFile.tellg();
+            ostr << id << "' pos " << aFile.tellg();
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -723,36 +823,28 @@ bool SCENEGRAPH::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 }
 
 
-bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform,
-                      S3D::MATLIST& materials, std::vector< SMESH >& meshes )
+bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform, S3D::MATLIST& materials,
+    std::vector< SMESH >& meshes, std::vector< SLINES >& lines )
 {
-    // calculate the accumulated transform
-    double rX, rY, rZ;
-    // rotation
-    rotation_axis.GetVector( rX, rY, rZ );
-    glm::dmat4 rM = glm::rotate( rotation_angle, glm::dvec3( rX, rY, rZ ) );
-    // translation
-    glm::dmat4 tM = glm::translate( glm::dvec3( translation.x, translation.y, translation.z ) );
-    // center
-    glm::dmat4 cM = glm::translate( glm::dvec3( center.x, center.y, center.z ) );
-    glm::dmat4 ncM = glm::translate( glm::dvec3( -center.x, -center.y, -center.z ) );
-    // scale
-    glm::dmat4 sM = glm::scale( glm::dmat4( 1.0 ), glm::dvec3( scale.x, scale.y, scale.z ) );
-    // scaleOrientation
-    scale_axis.GetVector( rX, rY, rZ );
-    glm::dmat4 srM = glm::rotate( scale_angle, glm::dvec3( rX, rY, rZ ) );
-    glm::dmat4 nsrM = glm::rotate( -scale_angle, glm::dvec3( rX, rY, rZ ) );
+    updateMatrix();
+    clearDirty();
 
-    // resultant point:
-    // P' = T x C x R x SR x S x -SR x -C x P
-    // resultant transform:
-    // tx0 = tM * cM * rM * srM * sM * nsrM * ncM
-    glm::dmat4 tx0;
+    // calculate the accumulated transform; identity nodes (which are
+    // common in STEP assemblies) simply pass on the parent transform
+    glm::dmat4 tx0( 1.0 );
 
-    if( NULL != aTransform )
-        tx0  = (*aTransform) * tM * cM * rM * srM * sM * nsrM * ncM;
+    if( m_Identity )
+    {
+        if( NULL != aTransform )
+            tx0 = *aTransform;
+    }
     else
-        tx0  = tM * cM * rM * srM * sM * nsrM * ncM;
+    {
+        if( NULL != aTransform )
+            tx0 = (*aTransform) * m_Matrix;
+        else
+            tx0 = m_Matrix;
+    }
 
     bool ok = true;
 
@@ -764,7 +856,7 @@ bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform,
 
         while( sL != eL && ok )
         {
-            ok = (*sL)->Prepare( &tx0, materials, meshes );
+            ok = (*sL)->Prepare( &tx0, materials, meshes, lines );
             ++sL;
         }
 
@@ -773,7 +865,7 @@ bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform,
 
         while( sL != eL && ok )
         {
-            ok = (*sL)->Prepare( &tx0, materials, meshes );
+            ok = (*sL)->Prepare( &tx0, materials, meshes, lines );
             ++sL;
         }
 
@@ -787,7 +879,7 @@ bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform,
 
         while( sL != eL && ok )
         {
-            ok = (*sL)->Prepare( &tx0, materials, meshes );
+            ok = (*sL)->Prepare( &tx0, materials, meshes, lines );
             ++sL;
         }
 
@@ -796,7 +888,7 @@ bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform,
 
         while( sL != eL && ok )
         {
-            ok = (*sL)->Prepare( &tx0, materials, meshes );
+            ok = (*sL)->Prepare( &tx0, materials, meshes, lines );
             ++sL;
         }
 
@@ -804,3 +896,502 @@ bool SCENEGRAPH::Prepare( const glm::dmat4* aTransform,
 
     return ok;
 }
+
+
+void SCENEGRAPH::updateMatrix( void )
+{
+    // the local transform is only rebuilt after the transform changed; the
+    // dirty flag is left to Prepare() since the bounds use this as well
+    if( !m_MatrixValid )
+    {
+        m_Identity = isIdentity();
+
+        if( !m_Identity )
+            m_Matrix = getTransform();
+
+        m_MatrixValid = true;
+    }
+
+    return;
+}
+
+
+bool SCENEGRAPH::isIdentity( void ) const
+{
+    if( !isRigid() )
+        return false;
+
+    if( fabs( translation.x ) > IDENT_LIN_TOL || fabs( translation.y ) > IDENT_LIN_TOL
+        || fabs( translation.z ) > IDENT_LIN_TOL )
+        return false;
+
+    // the center offset cancels out unless there is a rotation
+    if( fabs( rotation_angle ) > IDENT_ANG_TOL )
+        return false;
+
+    return true;
+}
+
+
+bool SCENEGRAPH::isRigid( void ) const
+{
+    // an assigned matrix is rigid if it is a proper rotation
+    if( m_HasAffine )
+    {
+        glm::dvec3 axes[3];
+
+        for( int i = 0; i < 3; ++i )
+            axes[i] = glm::dvec3( m_Affine[i][0], m_Affine[i][1], m_Affine[i][2] );
+
+        for( int i = 0; i < 3; ++i )
+        {
+            for( int j = i; j < 3; ++j )
+            {
+                if( fabs( glm::dot( axes[i], axes[j] ) - ( i == j ? 1.0 : 0.0 ) ) > IDENT_LIN_TOL )
+                    return false;
+            }
+        }
+
+        return glm::dot( axes[0], glm::cross( axes[1], axes[2] ) ) > 0.0;
+    }
+
+    // the scale orientation has no effect on a unit scale
+    if( fabs( scale.x - 1.0 ) > IDENT_LIN_TOL || fabs( scale.y - 1.0 ) > IDENT_LIN_TOL
+        || fabs( scale.z - 1.0 ) > IDENT_LIN_TOL )
+        return false;
+
+    return true;
+}
+
+
+glm::dmat4 SCENEGRAPH::getTransform( void ) const
+{
+    if( m_HasAffine )
+        return m_Affine;
+
+    double rX, rY, rZ;
+    // rotation
+    rotation_axis.GetVector( rX, rY, rZ );
+    glm::dmat4 rM = glm::rotate( rotation_angle, glm::dvec3( rX, rY, rZ ) );
+    // translation
+    glm::dmat4 tM = glm::translate( glm::dvec3( translation.x, translation.y, translation.z ) );
+    // center
+    glm::dmat4 cM = glm::translate( glm::dvec3( center.x, center.y, center.z ) );
+    glm::dmat4 ncM = glm::translate( glm::dvec3( -center.x, -center.y, -center.z ) );
+
+    // a rigid transform needs no scale terms:
+    // P' = T x C x R x -C x P
+    if( isRigid() )
+        return tM * cM * rM * ncM;
+
+    // scale
+    glm::dmat4 sM = glm::scale( glm::dmat4( 1.0 ), glm::dvec3( scale.x, scale.y, scale.z ) );
+    // scaleOrientation
+    scale_axis.GetVector( rX, rY, rZ );
+    glm::dmat4 srM = glm::rotate( scale_angle, glm::dvec3( rX, rY, rZ ) );
+    glm::dmat4 nsrM = glm::rotate( -scale_angle, glm::dvec3( rX, rY, rZ ) );
+
+    // resultant point:
+    // P' = T x C x R x SR x S x -SR x -C x P
+    return tM * cM * rM * srM * sM * nsrM * ncM;
+}
+
+
+// retrieves the rotation of the rigid transform aTransform as an axis and angle
+static void getAxisAngle( const glm::dmat4& aTransform, SGVECTOR& aAxis, double& aAngle )
+{
+    // note: glm matrices are indexed as [column][row]
+    double trace = aTransform[0][0] + aTransform[1][1] + aTransform[2][2];
+    double cosA = ( trace - 1.0 ) * 0.5;
+
+    if( cosA > 1.0 )
+        cosA = 1.0;
+    else if( cosA < -1.0 )
+        cosA = -1.0;
+
+    double angle = acos( cosA );
+    double rX = aTransform[1][2] - aTransform[2][1];
+    double rY = aTransform[2][0] - aTransform[0][2];
+    double rZ = aTransform[0][1] - aTransform[1][0];
+
+    if( angle < IDENT_ANG_TOL )
+    {
+        angle = 0.0;
+        rX = 0.0;
+        rY = 0.0;
+        rZ = 1.0;
+    }
+    else if( acos( -1.0 ) - angle < 1e-6 )
+    {
+        // the antisymmetric part vanishes at 180 degrees so the
+        // axis is recovered from the diagonal instead
+        rX = sqrt( std::max( 0.0, ( aTransform[0][0] + 1.0 ) * 0.5 ) );
+        rY = sqrt( std::max( 0.0, ( aTransform[1][1] + 1.0 ) * 0.5 ) );
+        rZ = sqrt( std::max( 0.0, ( aTransform[2][2] + 1.0 ) * 0.5 ) );
+
+        if( rX >= rY && rX >= rZ )
+        {
+            if( aTransform[0][1] < 0.0 )
+                rY = -rY;
+
+            if( aTransform[0][2] < 0.0 )
+                rZ = -rZ;
+        }
+        else if( rY >= rZ )
+        {
+            if( aTransform[0][1] < 0.0 )
+                rX = -rX;
+
+            if( aTransform[1][2] < 0.0 )
+                rZ = -rZ;
+        }
+        else
+        {
+            if( aTransform[0][2] < 0.0 )
+                rX = -rX;
+
+            if( aTransform[1][2] < 0.0 )
+                rY = -rY;
+        }
+    }
+
+    aAxis = SGVECTOR( rX, rY, rZ );
+    aAngle = angle;
+
+    return;
+}
+
+
+void SCENEGRAPH::SetMatrix( const glm::dmat4& aMatrix )
+{
+    m_Affine = aMatrix;
+    m_Affine[0][3] = 0.0;
+    m_Affine[1][3] = 0.0;
+    m_Affine[2][3] = 0.0;
+    m_Affine[3][3] = 1.0;
+    m_HasAffine = true;
+    m_MatrixValid = false;
+
+    // set the VRML compatible members to the translation, rotation and
+    // scale closest to the matrix; a shear cannot be represented by them
+    glm::dvec3 axes[3];
+    double sv[3];
+
+    for( int i = 0; i < 3; ++i )
+    {
+        axes[i] = glm::dvec3( m_Affine[i][0], m_Affine[i][1], m_Affine[i][2] );
+        sv[i] = glm::length( axes[i] );
+
+        if( fabs( sv[i] - 1.0 ) <= IDENT_LIN_TOL )
+            sv[i] = 1.0;
+    }
+
+    if( glm::dot( axes[0], glm::cross( axes[1], axes[2] ) ) < 0.0 )
+        sv[0] = -sv[0];
+
+    glm::dmat4 rM( 1.0 );
+
+    if( sv[0] != 0.0 && sv[1] != 0.0 && sv[2] != 0.0 )
+    {
+        for( int i = 0; i < 3; ++i )
+            rM[i] = glm::dvec4( axes[i] / sv[i], 0.0 );
+    }
+
+    getAxisAngle( rM, rotation_axis, rotation_angle );
+    center = SGPOINT( 0.0, 0.0, 0.0 );
+    translation = SGPOINT( m_Affine[3][0], m_Affine[3][1], m_Affine[3][2] );
+    scale = SGPOINT( sv[0], sv[1], sv[2] );
+    scale_axis = SGVECTOR( 0.0, 0.0, 1.0 );
+    scale_angle = 0.0;
+    setDirty();
+
+    return;
+}
+
+
+void SCENEGRAPH::ClearMatrix( void )
+{
+    m_MatrixValid = false;
+
+    if( !m_HasAffine )
+        return;
+
+    m_HasAffine = false;
+    setDirty();
+
+    return;
+}
+
+
+bool SCENEGRAPH::bake( void )
+{
+    // only a leaf transform holding nothing but its own
+    // unshared geometry may be baked
+    if( !isRigid() || !m_Transforms.empty() || !m_RTransforms.empty()
+        || !m_RShape.empty() || m_Shape.empty() )
+        return false;
+
+    std::vector< SGSHAPE* >::iterator sL = m_Shape.begin();
+    std::vector< SGSHAPE* >::iterator eL = m_Shape.end();
+    std::map< const void*, long > shared;
+
+    while( sL != eL )
+    {
+        if( !(*sL)->CanBake( shared ) )
+            return false;
+
+        ++sL;
+    }
+
+    // an array shared with geometry outside of this transform would have
+    // to be copied, so the transform is kept to preserve the sharing
+    std::map< const void*, long >::const_iterator sS = shared.begin();
+    std::map< const void*, long >::const_iterator eS = shared.end();
+
+    while( sS != eS )
+    {
+        if( 0 != sS->second )
+            return false;
+
+        ++sS;
+    }
+
+    glm::dmat4 tx = getTransform();
+    SGBAKED baked;
+
+    for( sL = m_Shape.begin(); sL != eL; ++sL )
+        (*sL)->Bake( tx, baked );
+
+    SetMatrix( glm::dmat4( 1.0 ) );
+
+    return true;
+}
+
+
+void SCENEGRAPH::hoist( SCENEGRAPH* aNode )
+{
+    // transfer owned shapes and transforms; any existing reference
+    // held by this node must be dropped first or the ownership
+    // transfer would be silently ignored
+    std::vector< SGSHAPE* > shapes;
+    shapes.swap( aNode->m_Shape );
+    aNode->m_Members.clear();
+
+    std::vector< SGSHAPE* >::iterator sS = shapes.begin();
+    std::vector< SGSHAPE* >::iterator eS = shapes.end();
+
+    while( sS != eS )
+    {
+        std::vector< SGSHAPE* >::iterator rS =
+            std::find( m_RShape.begin(), m_RShape.end(), *sS );
+
+        if( rS != m_RShape.end() )
+        {
+            delMember( *sS );
+            m_RShape.erase( rS );
+            (*sS)->delNodeRef( this );
+        }
+
+        (*sS)->SetParent( NULL, false );
+        (*sS)->SetParent( this );
+        ++sS;
+    }
+
+    std::vector< SCENEGRAPH* > xforms;
+    xforms.swap( aNode->m_Transforms );
+
+    std::vector< SCENEGRAPH* >::iterator sT = xforms.begin();
+    std::vector< SCENEGRAPH* >::iterator eT = xforms.end();
+
+    while( sT != eT )
+    {
+        std::vector< SCENEGRAPH* >::iterator rT =
+            std::find( m_RTransforms.begin(), m_RTransforms.end(), *sT );
+
+        if( rT != m_RTransforms.end() )
+        {
+            delMember( *sT );
+            m_RTransforms.erase( rT );
+            (*sT)->delNodeRef( this );
+        }
+
+        (*sT)->SetParent( NULL, false );
+        (*sT)->SetParent( this );
+        ++sT;
+    }
+
+    // duplicate the references; the originals are released when aNode is deleted
+    for( sS = aNode->m_RShape.begin(); sS != aNode->m_RShape.end(); ++sS )
+        AddRefNode( *sS );
+
+    for( sT = aNode->m_RTransforms.begin(); sT != aNode->m_RTransforms.end(); ++sT )
+        AddRefNode( *sT );
+
+    delete aNode;
+
+    return;
+}
+
+
+void SCENEGRAPH::Flatten( bool aBakeGeometry )
+{
+    // flatten the subtrees first so that the children are as
+    // shallow as possible before they are merged into this node
+    std::vector< SCENEGRAPH* > xforms = m_Transforms;
+    std::vector< SCENEGRAPH* >::iterator sL = xforms.begin();
+    std::vector< SCENEGRAPH* >::iterator eL = xforms.end();
+
+    while( sL != eL )
+    {
+        (*sL)->Flatten( aBakeGeometry );
+        ++sL;
+    }
+
+    // merge identity children; a referenced node must remain
+    // intact since other nodes depend on its transform
+    for( sL = xforms.begin(); sL != eL; ++sL )
+    {
+        if( (*sL)->isReferenced() )
+            continue;
+
+        if( aBakeGeometry && !(*sL)->isIdentity() )
+            (*sL)->bake();
+
+        if( (*sL)->isIdentity() )
+            hoist( *sL );
+    }
+
+    // collapse a chain of rigid transforms into a single transform
+    while( m_Shape.empty() && m_RShape.empty() && m_RTransforms.empty()
+        && 1 == m_Transforms.size() && isRigid() )
+    {
+        SCENEGRAPH* child = m_Transforms.front();
+
+        if( child->isReferenced() || !child->isRigid() )
+            break;
+
+        SetMatrix( getTransform() * child->getTransform() );
+        hoist( child );
+    }
+
+    return;
+}
+
+
+static void unionBounds( bool& aHasBounds, SGPOINT& aMin, SGPOINT& aMax,
+    const SGPOINT& aChildMin, const SGPOINT& aChildMax )
+{
+    if( !aHasBounds )
+    {
+        aMin = aChildMin;
+        aMax = aChildMax;
+        aHasBounds = true;
+        return;
+    }
+
+    aMin.x = std::min( aMin.x, aChildMin.x );
+    aMin.y = std::min( aMin.y, aChildMin.y );
+    aMin.z = std::min( aMin.z, aChildMin.z );
+    aMax.x = std::max( aMax.x, aChildMax.x );
+    aMax.y = std::max( aMax.y, aChildMax.y );
+    aMax.z = std::max( aMax.z, aChildMax.z );
+
+    return;
+}
+
+
+void SCENEGRAPH::calcBounds( void )
+{
+    m_HasBounds = false;
+    m_BBoxMin = SGPOINT( 0.0, 0.0, 0.0 );
+    m_BBoxMax = SGPOINT( 0.0, 0.0, 0.0 );
+
+    SGPOINT cMin;
+    SGPOINT cMax;
+
+    // the children are bounded first so that a flagged node always
+    // has flagged descendants (see SGNODE::setDirty())
+    std::vector< SGSHAPE* >* shapes[] = { &m_Shape, &m_RShape };
+
+    for( int i = 0; i < 2; ++i )
+    {
+        std::vector< SGSHAPE* >::iterator sL = shapes[i]->begin();
+        std::vector< SGSHAPE* >::iterator eL = shapes[i]->end();
+
+        while( sL != eL )
+        {
+            if( (*sL)->GetBounds( cMin, cMax ) )
+                unionBounds( m_HasBounds, m_BBoxMin, m_BBoxMax, cMin, cMax );
+
+            ++sL;
+        }
+    }
+
+    std::vector< SCENEGRAPH* >* xforms[] = { &m_Transforms, &m_RTransforms };
+
+    for( int i = 0; i < 2; ++i )
+    {
+        std::vector< SCENEGRAPH* >::iterator sL = xforms[i]->begin();
+        std::vector< SCENEGRAPH* >::iterator eL = xforms[i]->end();
+
+        while( sL != eL )
+        {
+            if( (*sL)->GetBounds( cMin, cMax ) )
+            {
+                (*sL)->updateMatrix();
+
+                if( !(*sL)->m_Identity )
+                    S3D::TransformBounds( (*sL)->m_Matrix, cMin, cMax );
+
+                unionBounds( m_HasBounds, m_BBoxMin, m_BBoxMax, cMin, cMax );
+            }
+
+            ++sL;
+        }
+    }
+
+    setBounded();
+
+    return;
+}
+
+
+bool SCENEGRAPH::GetBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( !m_bounded )
+        calcBounds();
+
+    aMin = m_BBoxMin;
+    aMax = m_BBoxMax;
+
+    return m_HasBounds;
+}
+
+
+bool SCENEGRAPH::GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( !GetBounds( aMin, aMax ) )
+        return false;
+
+    glm::dmat4 tx;
+    GetWorldTransform( tx );
+    S3D::TransformBounds( tx, aMin, aMax );
+
+    return true;
+}
+
+
+void SCENEGRAPH::GetWorldTransform( glm::dmat4& aTransform )
+{
+    if( NULL != m_Parent )
+        ( (SCENEGRAPH*)m_Parent )->GetWorldTransform( aTransform );
+    else
+        aTransform = glm::dmat4( 1.0 );
+
+    updateMatrix();
+
+    if( !m_Identity )
+        aTransform = aTransform * m_Matrix;
+
+    return;
+}
@@ -33,6 +33,7 @@
 #ifndef SCENE_GRAPH_H
 #define SCENE_GRAPH_H
 
+#include <unordered_set>
 #include <vector>
 #include "3d_cache/sg/sg_node.h"
 
@@ -53,12 +54,52 @@ private:
     std::vector< SCENEGRAPH* > m_RTransforms;   // referenced Transform nodes
     std::vector< SGSHAPE* > m_RShape;           // referenced Shape nodes
 
+    // index of all nodes in the four lists above; it is only built once
+    // the lists are long enough for a linear search to become costly
+    std::unordered_set< const SGNODE* > m_Members;
+
+    // local transform kept by updateMatrix(); it is rebuilt once any of
+    // the transform members changes
+    glm::dmat4 m_Matrix;
+    bool m_Identity;
+    bool m_MatrixValid;
+
+    // local transform assigned by SetMatrix(); while set it is used
+    // in place of the center/rotation/scale/translation members
+    glm::dmat4 m_Affine;
+    bool m_HasAffine;
+
+    // extent of the contents in the local coordinate system of this node;
+    // it is valid while the node is flagged as bounded
+    SGPOINT m_BBoxMin;
+    SGPOINT m_BBoxMax;
+    bool m_HasBounds;               // false if there is no geometry to bound
+
+    // number of Prepare() runs started from this node by GetModel()
+    unsigned int m_PassCount;
+
     void unlinkNode( const SGNODE* aNode, bool isChild );
     bool addNode( SGNODE* aNode, bool isChild );
 
+    // membership tracking used by ADD_NODE and UNLINK_NODE
+    bool isMember( const SGNODE* aNode );
+    void addMember( const SGNODE* aNode );
+    void delMember( const SGNODE* aNode );
+
+    // transform utilities used by Prepare() and Flatten()
+    bool isIdentity( void ) const;
+    bool isRigid( void ) const;
+    glm::dmat4 getTransform( void ) const;
+    void updateMatrix( void );
+    void calcBounds( void );
+    bool bake( void );
+    void hoist( SCENEGRAPH* aNode );
+
 public:
     void unlinkChildNode( const SGNODE* aNode );
     void unlinkRefNode( const SGNODE* aNode );
+    void getLinkedNodes( std::vector< SGNODE* >& aChildren,
+        std::vector< SGNODE* >& aRefs ) const;
 
 public:
     // note: order of transformation is Translate, Rotate, Offset
@@ -74,18 +115,91 @@ public:
     virtual ~SCENEGRAPH();
 
     virtual bool SetParent( SGNODE* aParent, bool notify = true );
+
+    /**
+     * Function SetMatrix
+     * assigns the local transform as an affine matrix which is then used
+     * exactly as given when the scene is prepared. The center, rotation,
+     * scale and translation members are set to the closest decomposition
+     * of the matrix for the sake of VRML output; any shear is lost there.
+     */
+    void SetMatrix( const glm::dmat4& aMatrix );
+
+    /**
+     * Function ClearMatrix
+     * releases a matrix assigned by SetMatrix(); the transform is then
+     * described by the center, rotation, scale and translation members.
+     * It must be called whenever one of those members is modified.
+     */
+    void ClearMatrix( void );
+
+    bool HasMatrix( void ) const
+    {
+        return m_HasAffine;
+    }
+
     SGNODE* FindNode(const char *aNodeName, const SGNODE *aCaller);
     bool AddRefNode( SGNODE* aNode );
     bool AddChildNode( SGNODE* aNode );
 
-    void ReNameNodes( void );
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
     bool ReadCache( std::ifstream& aFile, SGNODE* parentNode );
 
-    bool Prepare( const glm::dmat4* aTransform,
-        S3D::MATLIST& materials, std::vector< SMESH >& meshes );
+    bool Prepare( const glm::dmat4* aTransform, S3D::MATLIST& materials,
+        std::vector< SMESH >& meshes, std::vector< SLINES >& lines );
+
+    /**
+     * Function NextPass
+     * returns the sequence number for a new Prepare() run started from
+     * this node; shapes use it to discard prepared data which the
+     * previous run from the same node did not use.
+     */
+    unsigned int NextPass( void )
+    {
+        return ++m_PassCount;
+    }
+
+    /**
+     * Function GetBounds
+     * retrieves the axis aligned bounds of all geometry below this node in
+     * the local coordinate system of the node, that is without the transform
+     * of the node itself. The bounds are computed on first use and kept
+     * until any node below this one changes.
+     *
+     * @return false if there is no geometry below this node
+     */
+    bool GetBounds( SGPOINT& aMin, SGPOINT& aMax );
+
+    /**
+     * Function GetWorldBounds
+     * retrieves the bounds of all geometry below this node with the
+     * transform of this node and of all of its ancestors applied.
+     *
+     * @return false if there is no geometry below this node
+     */
+    bool GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax );
+
+    /**
+     * Function GetWorldTransform
+     * retrieves the product of the transforms of this node and of all of
+     * its ancestors, which maps the local coordinates of this node to the
+     * coordinate system of the top level node.
+     */
+    void GetWorldTransform( glm::dmat4& aTransform );
+
+    /**
+     * Function Flatten
+     * removes redundant levels from the transform hierarchy below this node.
+     * Owned transforms which are not referenced elsewhere are merged into
+     * this node when they are identities or when they form a chain of rigid
+     * transforms; if aBakeGeometry is true then rigid transforms whose
+     * geometry is used only once are applied to the vertices so that the
+     * transform itself may be removed.
+     */
+    void Flatten( bool aBakeGeometry );
 };
 
 /*
@@ -220,7 +220,7 @@ SGNODE* SGAPPEARANCE::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     return NULL;
@@ -279,13 +279,12 @@ bool SGAPPEARANCE::AddChildNode( SGNODE* aNode )
 }
 
 
-void SGAPPEARANCE::ReNameNodes( void )
+void SGAPPEARANCE::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 }
 
 
@@ -420,7 +419,7 @@ bool SGAPPEARANCE::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    aFile << "[" << GetName() << "]";
+    S3D::WriteTag( aFile, this );
     S3D::WriteColor( aFile, ambient );
     aFile.write( (char*)&shininess, sizeof(shininess) );
     aFile.write( (char*)&transparency, sizeof(transparency) );
@@ -70,7 +70,7 @@ public:
     bool AddRefNode( SGNODE* aNode );
     bool AddChildNode( SGNODE* aNode );
 
-    void ReNameNodes( void );
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
@@ -0,0 +1,142 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <cstdlib>
+#include <new>
+
+#include "3d_cache/sg/sg_arena.h"
+
+// size of the blocks requested from the system
+#define ARENA_BLOCK_SIZE (64 * 1024)
+// allocations are rounded up to this alignment
+#define ARENA_ALIGN (16)
+
+
+static thread_local SG_ARENA* active_arena = NULL;
+
+
+SG_ARENA::SG_ARENA()
+{
+    m_cursor = NULL;
+    m_avail = 0;
+    m_refs = 1;
+    m_prev = NULL;
+
+    return;
+}
+
+
+SG_ARENA::~SG_ARENA()
+{
+    std::vector< char* >::iterator sB = m_blocks.begin();
+    std::vector< char* >::iterator eB = m_blocks.end();
+
+    while( sB != eB )
+    {
+        free( *sB );
+        ++sB;
+    }
+
+    m_blocks.clear();
+
+    return;
+}
+
+
+void* SG_ARENA::Allocate( size_t aSize )
+{
+    aSize = ( aSize + ARENA_ALIGN - 1 ) & ~( (size_t) ARENA_ALIGN - 1 );
+
+    if( aSize > m_avail )
+    {
+        // oversized requests receive a dedicated block so that
+        // the remainder of the current block is not wasted
+        if( aSize > ARENA_BLOCK_SIZE / 4 )
+        {
+            char* blk = (char*) malloc( aSize );
+
+            if( NULL == blk )
+                throw std::bad_alloc();
+
+            m_blocks.push_back( blk );
+            ++m_refs;
+
+            return blk;
+        }
+
+        char* blk = (char*) malloc( ARENA_BLOCK_SIZE );
+
+        if( NULL == blk )
+            throw std::bad_alloc();
+
+        m_blocks.push_back( blk );
+        m_cursor = blk;
+        m_avail = ARENA_BLOCK_SIZE;
+    }
+
+    void* ptr = m_cursor;
+    m_cursor += aSize;
+    m_avail -= aSize;
+    ++m_refs;
+
+    return ptr;
+}
+
+
+void SG_ARENA::Release( void )
+{
+    if( 1 == m_refs.fetch_sub( 1 ) )
+        delete this;
+
+    return;
+}
+
+
+SG_ARENA* SG_ARENA::GetActive( void )
+{
+    return active_arena;
+}
+
+
+void SG_ARENA::Begin( void )
+{
+    SG_ARENA* arena = new SG_ARENA;
+    arena->m_prev = active_arena;
+    active_arena = arena;
+
+    return;
+}
+
+
+void SG_ARENA::End( void )
+{
+    SG_ARENA* arena = active_arena;
+
+    if( NULL == arena )
+        return;
+
+    active_arena = arena->m_prev;
+    arena->Release();
+
+    return;
+}
@@ -0,0 +1,106 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file sg_arena.h
+ * defines a block allocator which holds the nodes of a scene graph
+ */
+
+#ifndef SG_ARENA_H
+#define SG_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Class SG_ARENA
+ * allocates memory from large blocks which are only returned to the system
+ * once every allocation has been released. An arena is created by
+ * S3D::BeginArena() and while it is active on a thread all SGNODE objects
+ * created on that thread are placed within it. The arena deletes itself
+ * when it is no longer active and the last of its nodes has been deleted,
+ * so the release of the nodes of a scene costs O(blocks) rather than
+ * O(nodes). The geometry arrays held by the nodes in SGBUFFER objects are
+ * not placed in the arena since they may be adopted from or shared with
+ * std::vector objects created elsewhere; they are freed individually.
+ */
+class SG_ARENA
+{
+private:
+    std::vector< char* > m_blocks;
+    char*   m_cursor;               // next free byte in the current block
+    size_t  m_avail;                // bytes remaining in the current block
+    std::atomic< size_t > m_refs;   // live allocations plus one while active
+    SG_ARENA* m_prev;               // arena which was active before this one
+
+    ~SG_ARENA();
+
+public:
+    SG_ARENA();
+
+    /**
+     * Function Allocate
+     * returns a block of memory suitably aligned for any object
+     */
+    void* Allocate( size_t aSize );
+
+    /**
+     * Function Release
+     * drops a reference to the arena; the arena and all of its
+     * blocks are freed when the last reference is dropped
+     */
+    void Release( void );
+
+    /**
+     * Function GetActive
+     * returns the arena which is active on the calling thread, if any
+     */
+    static SG_ARENA* GetActive( void );
+
+    /**
+     * Function Begin
+     * creates a new arena and makes it active on the calling thread
+     */
+    static void Begin( void );
+
+    /**
+     * Function End
+     * deactivates the current arena and restores the previously active one
+     */
+    static void End( void );
+};
+
+
+/**
+ * Class SG_ARENA_SCOPE
+ * keeps a new arena active for the lifetime of the object
+ */
+class SG_ARENA_SCOPE
+{
+public:
+    SG_ARENA_SCOPE() { SG_ARENA::Begin(); }
+    ~SG_ARENA_SCOPE() { SG_ARENA::End(); }
+};
+
+#endif  // SG_ARENA_H
@@ -0,0 +1,144 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file sg_buffer.h
+ * defines a reference counted buffer for the geometry data of scene graph nodes
+ */
+
+#ifndef SG_BUFFER_H
+#define SG_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Class SGBUFFER
+ * holds an immutable, reference counted array of geometry data. Any number
+ * of nodes may hold the same array; the lifetime of the data is independent
+ * of the nodes which created it and the array is freed when its last holder
+ * releases it. Read access is always shared; Edit() gives the caller a
+ * private copy of the data if the array is held by any other node.
+ */
+template< typename T >
+class SGBUFFER
+{
+private:
+    std::shared_ptr< std::vector< T > > m_data;
+
+public:
+    typedef typename std::vector< T >::const_iterator const_iterator;
+
+    bool empty( void ) const
+    {
+        return !m_data || m_data->empty();
+    }
+
+    size_t size( void ) const
+    {
+        return m_data ? m_data->size() : 0;
+    }
+
+    const T& operator[]( size_t aIndex ) const
+    {
+        return (*m_data)[aIndex];
+    }
+
+    const T* data( void ) const
+    {
+        return empty() ? NULL : &(*m_data)[0];
+    }
+
+    const_iterator begin( void ) const
+    {
+        return m_data ? m_data->begin() : const_iterator();
+    }
+
+    const_iterator end( void ) const
+    {
+        return m_data ? m_data->end() : const_iterator();
+    }
+
+    /**
+     * Function IsShared
+     * returns true if the data is held by more than one buffer
+     */
+    bool IsShared( void ) const
+    {
+        return m_data && m_data.use_count() > 1;
+    }
+
+    /**
+     * Function Holders
+     * returns the number of buffers which hold the data
+     */
+    long Holders( void ) const
+    {
+        return m_data ? m_data.use_count() : 0;
+    }
+
+    /**
+     * Function Share
+     * releases the current data and refers to the data held by aSource
+     */
+    void Share( const SGBUFFER& aSource )
+    {
+        m_data = aSource.m_data;
+    }
+
+    /**
+     * Function Take
+     * releases the current data and takes ownership of the contents
+     * of aData without copying it; aData is left empty.
+     */
+    void Take( std::vector< T >& aData )
+    {
+        m_data = std::make_shared< std::vector< T > >();
+        m_data->swap( aData );
+        std::vector< T >().swap( aData );
+    }
+
+    /**
+     * Function Edit
+     * returns the data for modification; if the data is also held by other
+     * buffers then a private copy is made first so the other holders are
+     * not affected.
+     */
+    std::vector< T >& Edit( void )
+    {
+        if( !m_data )
+            m_data = std::make_shared< std::vector< T > >();
+        else if( m_data.use_count() > 1 )
+            m_data = std::make_shared< std::vector< T > >( *m_data );
+
+        return *m_data;
+    }
+
+    void clear( void )
+    {
+        m_data.reset();
+    }
+};
+
+#endif  // SG_BUFFER_H
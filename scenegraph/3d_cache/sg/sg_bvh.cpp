@@ -0,0 +1,616 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <wx/log.h>
+
+#include "3d_cache/sg/sg_bvh.h"
+
+
+// number of bins per axis used to evaluate the surface area heuristic
+#define BVH_BINS 16
+
+// largest leaf which is created without first trying to split it
+#define BVH_MAX_LEAF 4
+
+// subtrees with fewer triangles are always built on the calling thread
+#define BVH_SPAWN_SIZE 4096
+
+// depth limit of the tree; this bounds the traversal stack
+#define BVH_MAX_DEPTH 64
+
+// size of a node and of a triangle in a cache file
+#define BVH_NODE_BYTES ( 8 * 4 )
+#define BVH_TRIANGLE_BYTES ( 11 * 4 )
+
+
+static float halfArea( const SFVEC3F& aMin, const SFVEC3F& aMax )
+{
+    SFVEC3F d = aMax - aMin;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+
+static bool hitBox( const SGBVH::NODE& aNode, const SFVEC3F& aOrigin,
+    const SFVEC3F& aInvDir, float aMaxDistance, float& aEntry )
+{
+    float tmin = 0.0f;
+    float tmax = aMaxDistance;
+
+    for( int i = 0; i < 3; ++i )
+    {
+        // a ray parallel to a slab hits it only if it starts within the
+        // slab; the general case would evaluate 0 * inf there
+        if( std::isinf( aInvDir[i] ) )
+        {
+            if( aOrigin[i] < aNode.bmin[i] || aOrigin[i] > aNode.bmax[i] )
+                return false;
+
+            continue;
+        }
+
+        float t1 = ( aNode.bmin[i] - aOrigin[i] ) * aInvDir[i];
+        float t2 = ( aNode.bmax[i] - aOrigin[i] ) * aInvDir[i];
+
+        tmin = std::max( tmin, std::min( t1, t2 ) );
+        tmax = std::min( tmax, std::max( t1, t2 ) );
+    }
+
+    aEntry = tmin;
+
+    return tmin <= tmax;
+}
+
+
+static void writeVec( std::ofstream& aFile, const SFVEC3F& aVec )
+{
+    aFile.write( (char*)&aVec.x, sizeof( aVec.x ) );
+    aFile.write( (char*)&aVec.y, sizeof( aVec.y ) );
+    aFile.write( (char*)&aVec.z, sizeof( aVec.z ) );
+    return;
+}
+
+
+static void readVec( std::ifstream& aFile, SFVEC3F& aVec )
+{
+    aFile.read( (char*)&aVec.x, sizeof( aVec.x ) );
+    aFile.read( (char*)&aVec.y, sizeof( aVec.y ) );
+    aFile.read( (char*)&aVec.z, sizeof( aVec.z ) );
+    return;
+}
+
+
+bool SGBVH::Build( const S3DMODEL& aModel )
+{
+    m_Nodes.clear();
+    m_Triangles.clear();
+
+    std::vector< TRIANGLE > tris;
+    std::vector< PRIM > prims;
+
+    for( unsigned int i = 0; i < aModel.m_MeshesSize; ++i )
+    {
+        const SMESH& mesh = aModel.m_Meshes[i];
+
+        if( NULL == mesh.m_Positions || ( NULL == mesh.m_FaceIdx && NULL == mesh.m_FaceIdx16 ) )
+            continue;
+
+        unsigned int nf = mesh.m_FaceIdxSize / 3;
+        unsigned int idx[3];
+
+        for( unsigned int j = 0; j < nf; ++j )
+        {
+            // models created with GETMODEL_INDEX16 may hold 16 bit indices
+            for( int k = 0; k < 3; ++k )
+            {
+                if( NULL != mesh.m_FaceIdx )
+                    idx[k] = mesh.m_FaceIdx[j * 3 + k];
+                else
+                    idx[k] = mesh.m_FaceIdx16[j * 3 + k];
+            }
+
+            if( idx[0] >= mesh.m_VertexSize || idx[1] >= mesh.m_VertexSize
+                || idx[2] >= mesh.m_VertexSize )
+                continue;
+
+            const SFVEC3F& p0 = mesh.m_Positions[idx[0]];
+            const SFVEC3F& p1 = mesh.m_Positions[idx[1]];
+            const SFVEC3F& p2 = mesh.m_Positions[idx[2]];
+
+            TRIANGLE tri;
+            tri.v0 = p0;
+            tri.e1 = p1 - p0;
+            tri.e2 = p2 - p0;
+            tri.mesh = i;
+            tri.face = j;
+
+            PRIM prim;
+            prim.bmin = glm::min( glm::min( p0, p1 ), p2 );
+            prim.bmax = glm::max( glm::max( p0, p1 ), p2 );
+            prim.center = ( prim.bmin + prim.bmax ) * 0.5f;
+            prim.tri = (unsigned int)tris.size();
+
+            tris.push_back( tri );
+            prims.push_back( prim );
+        }
+    }
+
+    if( prims.empty() )
+        return false;
+
+    // each level of concurrent subtrees doubles the number of threads
+    int spawnLevels = 0;
+    unsigned int nThreads = std::thread::hardware_concurrency();
+
+    while( nThreads > 1 )
+    {
+        ++spawnLevels;
+        nThreads >>= 1;
+    }
+
+    m_Nodes.reserve( prims.size() * 2 / BVH_MAX_LEAF + 1 );
+    buildNode( prims, 0, prims.size(), m_Nodes, 0, spawnLevels );
+
+    // store the triangles in the order of the leaves
+    m_Triangles.resize( prims.size() );
+
+    for( size_t i = 0; i < prims.size(); ++i )
+        m_Triangles[i] = tris[prims[i].tri];
+
+    return true;
+}
+
+
+void SGBVH::buildNode( std::vector< PRIM >& aPrims, size_t aBegin, size_t aEnd,
+    std::vector< NODE >& aNodes, int aDepth, int aSpawnLevels )
+{
+    NODE node;
+    node.bmin = aPrims[aBegin].bmin;
+    node.bmax = aPrims[aBegin].bmax;
+    SFVEC3F cmin = aPrims[aBegin].center;
+    SFVEC3F cmax = cmin;
+
+    for( size_t i = aBegin + 1; i < aEnd; ++i )
+    {
+        node.bmin = glm::min( node.bmin, aPrims[i].bmin );
+        node.bmax = glm::max( node.bmax, aPrims[i].bmax );
+        cmin = glm::min( cmin, aPrims[i].center );
+        cmax = glm::max( cmax, aPrims[i].center );
+    }
+
+    node.index = (unsigned int)aBegin;
+    node.count = (unsigned int)( aEnd - aBegin );
+
+    size_t self = aNodes.size();
+    aNodes.push_back( node );
+
+    size_t n = aEnd - aBegin;
+
+    if( n <= 2 || aDepth >= BVH_MAX_DEPTH - 1 )
+        return;
+
+    // find the cheapest binned split along any axis
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    int bestBin = 0;
+
+    for( int axis = 0; axis < 3; ++axis )
+    {
+        float extent = cmax[axis] - cmin[axis];
+
+        if( extent <= 0.0f )
+            continue;
+
+        float scale = BVH_BINS / extent;
+        SFVEC3F bmin[BVH_BINS];
+        SFVEC3F bmax[BVH_BINS];
+        size_t count[BVH_BINS] = { 0 };
+
+        for( size_t i = aBegin; i < aEnd; ++i )
+        {
+            int bin = std::min( BVH_BINS - 1,
+                                (int)( ( aPrims[i].center[axis] - cmin[axis] ) * scale ) );
+
+            if( 0 == count[bin] )
+            {
+                bmin[bin] = aPrims[i].bmin;
+                bmax[bin] = aPrims[i].bmax;
+            }
+            else
+            {
+                bmin[bin] = glm::min( bmin[bin], aPrims[i].bmin );
+                bmax[bin] = glm::max( bmax[bin], aPrims[i].bmax );
+            }
+
+            ++count[bin];
+        }
+
+        // sweep from the right to collect the cost of each right side
+        float rightArea[BVH_BINS];
+        size_t rightCount[BVH_BINS];
+        SFVEC3F rmin( FLT_MAX );
+        SFVEC3F rmax( -FLT_MAX );
+        size_t rn = 0;
+
+        for( int i = BVH_BINS - 1; i > 0; --i )
+        {
+            if( count[i] )
+            {
+                rmin = glm::min( rmin, bmin[i] );
+                rmax = glm::max( rmax, bmax[i] );
+                rn += count[i];
+            }
+
+            rightArea[i] = rn ? halfArea( rmin, rmax ) : 0.0f;
+            rightCount[i] = rn;
+        }
+
+        SFVEC3F lmin( FLT_MAX );
+        SFVEC3F lmax( -FLT_MAX );
+        size_t ln = 0;
+
+        for( int i = 0; i < BVH_BINS - 1; ++i )
+        {
+            if( count[i] )
+            {
+                lmin = glm::min( lmin, bmin[i] );
+                lmax = glm::max( lmax, bmax[i] );
+                ln += count[i];
+            }
+
+            if( 0 == ln || 0 == rightCount[i + 1] )
+                continue;
+
+            float cost = halfArea( lmin, lmax ) * ln + rightArea[i + 1] * rightCount[i + 1];
+
+            if( cost < bestCost )
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = i;
+            }
+        }
+    }
+
+    // a leaf is kept if splitting it does not pay for the extra traversal
+    float leafCost = halfArea( node.bmin, node.bmax ) * ( n - 1 );
+
+    if( n <= BVH_MAX_LEAF && ( bestAxis < 0 || bestCost >= leafCost ) )
+        return;
+
+    size_t mid = aBegin;
+
+    if( bestAxis >= 0 )
+    {
+        float scale = BVH_BINS / ( cmax[bestAxis] - cmin[bestAxis] );
+        float base = cmin[bestAxis];
+        int axis = bestAxis;
+        int split = bestBin;
+
+        mid = std::partition( aPrims.begin() + aBegin, aPrims.begin() + aEnd,
+            [axis, split, scale, base]( const PRIM& aPrim )
+            {
+                return std::min( BVH_BINS - 1,
+                                 (int)( ( aPrim.center[axis] - base ) * scale ) ) <= split;
+            } ) - aPrims.begin();
+    }
+
+    // coincident centers cannot be separated by position; split by count
+    if( mid == aBegin || mid == aEnd )
+        mid = aBegin + n / 2;
+
+    aNodes[self].count = 0;
+
+    if( aSpawnLevels > 0 && n >= BVH_SPAWN_SIZE )
+    {
+        std::vector< NODE > right;
+        std::future< void > task;
+        bool async = true;
+
+        try
+        {
+            task = std::async( std::launch::async, &SGBVH::buildNode, this,
+                std::ref( aPrims ), mid, aEnd, std::ref( right ), aDepth + 1,
+                aSpawnLevels - 1 );
+        }
+        catch( std::exception& )
+        {
+            async = false;
+        }
+
+        buildNode( aPrims, aBegin, mid, aNodes, aDepth + 1, aSpawnLevels - 1 );
+
+        if( async )
+            task.get();
+        else
+            buildNode( aPrims, mid, aEnd, right, aDepth + 1, aSpawnLevels - 1 );
+
+        // relocate the right subtree behind the left one
+        unsigned int offset = (unsigned int)aNodes.size();
+        aNodes[self].index = offset;
+
+        for( size_t i = 0; i < right.size(); ++i )
+        {
+            if( 0 == right[i].count )
+                right[i].index += offset;
+
+            aNodes.push_back( right[i] );
+        }
+
+        return;
+    }
+
+    buildNode( aPrims, aBegin, mid, aNodes, aDepth + 1, 0 );
+    aNodes[self].index = (unsigned int)aNodes.size();
+    buildNode( aPrims, mid, aEnd, aNodes, aDepth + 1, 0 );
+
+    return;
+}
+
+
+bool SGBVH::Intersect( const SFVEC3F& aOrigin, const SFVEC3F& aDirection,
+    float aMaxDistance, bool aAnyHit, S3D::BVHHIT& aHit ) const
+{
+    if( m_Nodes.empty() )
+        return false;
+
+    SFVEC3F invDir( 1.0f / aDirection.x, 1.0f / aDirection.y, 1.0f / aDirection.z );
+    float tmax = aMaxDistance;
+    float entry;
+    bool found = false;
+
+    if( !hitBox( m_Nodes[0], aOrigin, invDir, tmax, entry ) )
+        return false;
+
+    unsigned int stack[BVH_MAX_DEPTH];
+    int sp = 0;
+    unsigned int idx = 0;
+
+    while( true )
+    {
+        const NODE& node = m_Nodes[idx];
+
+        if( node.count > 0 )
+        {
+            for( unsigned int i = node.index; i < node.index + node.count; ++i )
+            {
+                // Moller-Trumbore ray/triangle intersection
+                const TRIANGLE& tri = m_Triangles[i];
+                SFVEC3F p = glm::cross( aDirection, tri.e2 );
+                float det = glm::dot( tri.e1, p );
+
+                if( det == 0.0f )
+                    continue;
+
+                float invDet = 1.0f / det;
+                SFVEC3F s = aOrigin - tri.v0;
+                float u = glm::dot( s, p ) * invDet;
+
+                if( u < 0.0f || u > 1.0f )
+                    continue;
+
+                SFVEC3F q = glm::cross( s, tri.e1 );
+                float v = glm::dot( aDirection, q ) * invDet;
+
+                if( v < 0.0f || u + v > 1.0f )
+                    continue;
+
+                float t = glm::dot( tri.e2, q ) * invDet;
+
+                if( t < 0.0f || t > tmax )
+                    continue;
+
+                tmax = t;
+                found = true;
+                aHit.m_Distance = t;
+                aHit.m_MeshIdx = tri.mesh;
+                aHit.m_TriangleIdx = tri.face;
+                aHit.m_U = u;
+                aHit.m_V = v;
+
+                if( aAnyHit )
+                    return true;
+            }
+        }
+        else
+        {
+            // visit the nearer child first and defer the other one
+            unsigned int left = idx + 1;
+            unsigned int right = node.index;
+            float tl, tr;
+            bool hl = hitBox( m_Nodes[left], aOrigin, invDir, tmax, tl );
+            bool hr = hitBox( m_Nodes[right], aOrigin, invDir, tmax, tr );
+
+            if( hl && hr )
+            {
+                if( tr < tl )
+                    std::swap( left, right );
+
+                stack[sp++] = right;
+                idx = left;
+                continue;
+            }
+
+            if( hl )
+            {
+                idx = left;
+                continue;
+            }
+
+            if( hr )
+            {
+                idx = right;
+                continue;
+            }
+        }
+
+        if( 0 == sp )
+            break;
+
+        idx = stack[--sp];
+    }
+
+    return found;
+}
+
+
+bool SGBVH::WriteCache( std::ofstream& aFile ) const
+{
+    unsigned int nn = (unsigned int)m_Nodes.size();
+    unsigned int nt = (unsigned int)m_Triangles.size();
+
+    aFile.write( (char*)&nn, sizeof( nn ) );
+    aFile.write( (char*)&nt, sizeof( nt ) );
+
+    // the members are written one by one so that the format does not
+    // depend on the layout of the structures
+    for( unsigned int i = 0; i < nn; ++i )
+    {
+        const NODE& node = m_Nodes[i];
+        writeVec( aFile, node.bmin );
+        aFile.write( (char*)&node.index, sizeof( node.index ) );
+        writeVec( aFile, node.bmax );
+        aFile.write( (char*)&node.count, sizeof( node.count ) );
+    }
+
+    for( unsigned int i = 0; i < nt; ++i )
+    {
+        const TRIANGLE& tri = m_Triangles[i];
+        writeVec( aFile, tri.v0 );
+        writeVec( aFile, tri.e1 );
+        writeVec( aFile, tri.e2 );
+        aFile.write( (char*)&tri.mesh, sizeof( tri.mesh ) );
+        aFile.write( (char*)&tri.face, sizeof( tri.face ) );
+    }
+
+    if( aFile.fail() )
+        return false;
+
+    return true;
+}
+
+
+bool SGBVH::ReadCache( std::ifstream& aFile )
+{
+    unsigned int nn = 0;
+    unsigned int nt = 0;
+
+    m_Nodes.clear();
+    m_Triangles.clear();
+
+    aFile.read( (char*)&nn, sizeof( nn ) );
+    aFile.read( (char*)&nt, sizeof( nt ) );
+
+    if( aFile.fail() || 0 == nn || 0 == nt )
+        return false;
+
+    // make sure the file is large enough before allocating the arrays
+    std::streampos pos = aFile.tellg();
+    aFile.seekg( 0, std::ios_base::end );
+    std::streamoff remaining = aFile.tellg() - pos;
+    aFile.seekg( pos );
+
+    if( remaining < (std::streamoff)( BVH_NODE_BYTES * (size_t)nn
+                                      + BVH_TRIANGLE_BYTES * (size_t)nt ) )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [INFO] corrupt data; truncated BVH";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    m_Nodes.resize( nn );
+    m_Triangles.resize( nt );
+
+    for( unsigned int i = 0; i < nn; ++i )
+    {
+        NODE& node = m_Nodes[i];
+        readVec( aFile, node.bmin );
+        aFile.read( (char*)&node.index, sizeof( node.index ) );
+        readVec( aFile, node.bmax );
+        aFile.read( (char*)&node.count, sizeof( node.count ) );
+    }
+
+    for( unsigned int i = 0; i < nt; ++i )
+    {
+        TRIANGLE& tri = m_Triangles[i];
+        readVec( aFile, tri.v0 );
+        readVec( aFile, tri.e1 );
+        readVec( aFile, tri.e2 );
+        aFile.read( (char*)&tri.mesh, sizeof( tri.mesh ) );
+        aFile.read( (char*)&tri.face, sizeof( tri.face ) );
+    }
+
+    bool ok = !aFile.fail();
+
+    // every link must stay within the arrays and an inner node must
+    // precede its children so that a traversal cannot loop; the depth
+    // is limited by the size of the traversal stack
+    std::vector< unsigned char > depth( ok ? nn : 0, 0 );
+
+    for( unsigned int i = 0; i < nn && ok; ++i )
+    {
+        const NODE& node = m_Nodes[i];
+
+        if( node.count > 0 )
+        {
+            ok = node.index < nt && node.count <= nt - node.index;
+            continue;
+        }
+
+        ok = i + 1 < nn && node.index > i + 1 && node.index < nn
+             && depth[i] < BVH_MAX_DEPTH - 1;
+
+        if( ok )
+        {
+            depth[i + 1] = std::max( depth[i + 1], (unsigned char)( depth[i] + 1 ) );
+            depth[node.index] = std::max( depth[node.index], (unsigned char)( depth[i] + 1 ) );
+        }
+    }
+
+    if( !ok )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [INFO] corrupt data; invalid BVH";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        m_Nodes.clear();
+        m_Triangles.clear();
+        return false;
+    }
+
+    return true;
+}
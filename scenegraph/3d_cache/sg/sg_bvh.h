@@ -0,0 +1,121 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file sg_bvh.h
+ * defines a bounding volume hierarchy over the triangles of an S3DMODEL
+ */
+
+#ifndef SG_BVH_H
+#define SG_BVH_H
+
+#include <fstream>
+#include <vector>
+#include "plugins/3dapi/c3dmodel.h"
+#include "plugins/3dapi/ifsg_api.h"
+
+/**
+ * Class SGBVH
+ * holds a bounding volume hierarchy over the triangles of all meshes of a
+ * model. The hierarchy keeps its own copy of the triangles so that it may
+ * be queried, written and read independently of the model it was built
+ * from; hits are reported by mesh index and triangle index within the mesh.
+ */
+class SGBVH
+{
+public:
+    // a node occupies 32 bytes; the left child of an inner node always
+    // immediately follows the node itself
+    struct NODE
+    {
+        SFVEC3F bmin;
+        unsigned int index;     // leaf: first triangle; inner node: right child
+        SFVEC3F bmax;
+        unsigned int count;     // number of triangles; 0 for an inner node
+    };
+
+    // the triangle is stored as a vertex and two edges as required by
+    // the intersection test
+    struct TRIANGLE
+    {
+        SFVEC3F v0;
+        SFVEC3F e1;
+        SFVEC3F e2;
+        unsigned int mesh;      // index of the mesh within the model
+        unsigned int face;      // index of the triangle within the mesh
+    };
+
+private:
+    // working data for a triangle during the build
+    struct PRIM
+    {
+        SFVEC3F bmin;
+        SFVEC3F bmax;
+        SFVEC3F center;
+        unsigned int tri;
+    };
+
+    std::vector< NODE > m_Nodes;
+    std::vector< TRIANGLE > m_Triangles;
+
+    // appends the subtree over aPrims[aBegin, aEnd) to aNodes; subtrees
+    // are built on new threads while aSpawnLevels is greater than zero
+    void buildNode( std::vector< PRIM >& aPrims, size_t aBegin, size_t aEnd,
+        std::vector< NODE >& aNodes, int aDepth, int aSpawnLevels );
+
+public:
+    /**
+     * Function Build
+     * creates the hierarchy from the triangles of the given model;
+     * triangles with invalid indices are skipped. Large subtrees
+     * are built concurrently.
+     *
+     * @return false if the model holds no triangles
+     */
+    bool Build( const S3DMODEL& aModel );
+
+    /**
+     * Function Intersect
+     * finds the nearest triangle hit by the ray from aOrigin along
+     * aDirection within aMaxDistance (in units of aDirection). If
+     * aAnyHit is true the search ends at the first triangle found.
+     *
+     * @return true if a triangle was hit; aHit then describes the hit
+     */
+    bool Intersect( const SFVEC3F& aOrigin, const SFVEC3F& aDirection,
+        float aMaxDistance, bool aAnyHit, S3D::BVHHIT& aHit ) const;
+
+    size_t GetNodeCount( void ) const
+    {
+        return m_Nodes.size();
+    }
+
+    size_t GetTriangleCount( void ) const
+    {
+        return m_Triangles.size();
+    }
+
+    bool WriteCache( std::ofstream& aFile ) const;
+    bool ReadCache( std::ifstream& aFile );
+};
+
+#endif  // SG_BVH_H
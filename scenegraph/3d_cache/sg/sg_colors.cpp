@@ -95,7 +95,7 @@ SGNODE* SGCOLORS::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     return NULL;
@@ -163,21 +163,24 @@ bool SGCOLORS::GetColorList( size_t& aListSize, SGCOLOR*& aColorList )
         return false;
     }
 
+    setDirty();
+
+    // the caller may modify the data so it must not be shared
     aListSize = colors.size();
-    aColorList = &colors[0];
+    aColorList = &colors.Edit()[0];
     return true;
 }
 
 
 void SGCOLORS::SetColorList( size_t aListSize, const SGCOLOR* aColorList )
 {
+    setDirty();
     colors.clear();
 
     if( 0 == aListSize || NULL == aColorList )
         return;
 
-    for( size_t i = 0; i < aListSize; ++i )
-        colors.push_back( aColorList[i] );
+    colors.Edit().assign( aColorList, aColorList + aListSize );
 
     return;
 }
@@ -185,25 +188,37 @@ void SGCOLORS::SetColorList( size_t aListSize, const SGCOLOR* aColorList )
 
 void SGCOLORS::AddColor( double aRedValue, double aGreenValue, double aBlueValue )
 {
-    colors.push_back( SGCOLOR( aRedValue, aGreenValue, aBlueValue ) );
+    setDirty();
+    colors.Edit().push_back( SGCOLOR( aRedValue, aGreenValue, aBlueValue ) );
     return;
 }
 
 
 void SGCOLORS::AddColor( const SGCOLOR& aColor )
 {
-    colors.push_back( aColor );
+    setDirty();
+    colors.Edit().push_back( aColor );
     return;
 }
 
 
-void SGCOLORS::ReNameNodes( void )
+void SGCOLORS::ShareColorList( const SGCOLORS* aSource )
+{
+    if( NULL == aSource || this == aSource )
+        return;
+
+    setDirty();
+    colors.Share( aSource->colors );
+    return;
+}
+
+
+void SGCOLORS::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 }
 
 
@@ -319,7 +334,7 @@ bool SGCOLORS::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    aFile << "[" << GetName() << "]";
+    S3D::WriteTag( aFile, this );
     size_t ncolors = colors.size();
     aFile.write( (char*)&ncolors, sizeof(size_t) );
 
@@ -355,12 +370,14 @@ bool SGCOLORS::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     if( aFile.fail() )
         return false;
 
+    std::vector< SGCOLOR >& data = colors.Edit();
+
     for( size_t i = 0; i < ncolors; ++i )
     {
         if( !S3D::ReadColor( aFile, tmp ) || aFile.fail() )
             return false;
 
-        colors.push_back( tmp );
+        data.push_back( tmp );
     }
 
     return true;
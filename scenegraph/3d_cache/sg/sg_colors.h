@@ -31,11 +31,12 @@
 
 #include <vector>
 #include "3d_cache/sg/sg_node.h"
+#include "3d_cache/sg/sg_buffer.h"
 
 class SGCOLORS : public SGNODE
 {
 public:
-    std::vector< SGCOLOR > colors;
+    SGBUFFER< SGCOLOR > colors;
 
     void unlinkChildNode( const SGNODE* aNode );
     void unlinkRefNode( const SGNODE* aNode );
@@ -55,7 +56,14 @@ public:
     void AddColor( double aRedValue, double aGreenValue, double aBlueValue );
     void AddColor( const SGCOLOR& aColor );
 
-    void ReNameNodes( void );
+    /**
+     * Function ShareColorList
+     * makes this node refer to the color data held by aSource; no data
+     * is copied and both nodes remain free to modify their data later.
+     */
+    void ShareColorList( const SGCOLORS* aSource );
+
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
@@ -45,10 +45,10 @@ SGCOORDINDEX::~SGCOORDINDEX()
 
 void SGCOORDINDEX::GatherCoordIndices( std::vector< int >& aIndexList )
 {
-    if( index.empty() )
-        return;
-
-    aIndexList.insert( aIndexList.end(), index.begin(), index.end() );
+    if( IsCompact() )
+        aIndexList.insert( aIndexList.end(), index16.begin(), index16.end() );
+    else
+        aIndexList.insert( aIndexList.end(), index.begin(), index.end() );
 
     return;
 }
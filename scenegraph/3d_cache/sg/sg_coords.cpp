@@ -29,11 +29,13 @@
 #include "3d_cache/sg/sg_helpers.h"
 #include "3d_cache/sg/sg_normals.h"
 #include "3d_cache/sg/sg_faceset.h"
+#include "3d_cache/sg/sg_coordindex.h"
 
 
 SGCOORDS::SGCOORDS( SGNODE* aParent ) : SGNODE( aParent )
 {
     m_SGtype = S3D::SGTYPE_COORDS;
+    singlePrecision = false;
 
     if( NULL != aParent && S3D::SGTYPE_FACESET != aParent->GetNodeType() )
     {
@@ -59,6 +61,7 @@ SGCOORDS::SGCOORDS( SGNODE* aParent ) : SGNODE( aParent )
 SGCOORDS::~SGCOORDS()
 {
     coords.clear();
+    fcoords.clear();
     return;
 }
 
@@ -98,7 +101,7 @@ SGNODE* SGCOORDS::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     return NULL;
@@ -166,21 +169,26 @@ bool SGCOORDS::GetCoordsList( size_t& aListSize, SGPOINT*& aCoordsList )
         return false;
     }
 
+    setDirty();
+
+    // the caller may modify the data so it must not be shared
     aListSize = coords.size();
-    aCoordsList = &coords[0];
+    aCoordsList = &coords.Edit()[0];
     return true;
 }
 
 
 void SGCOORDS::SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList )
 {
+    setDirty();
     coords.clear();
+    fcoords.clear();
+    singlePrecision = false;
 
     if( 0 == aListSize || NULL == aCoordsList )
         return;
 
-    for( size_t i = 0; i < aListSize; ++i )
-        coords.push_back( aCoordsList[i] );
+    coords.Edit().assign( aCoordsList, aCoordsList + aListSize );
 
     return;
 }
@@ -188,31 +196,139 @@ void SGCOORDS::SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList )
 
 void SGCOORDS::AddCoord( double aXValue, double aYValue, double aZValue )
 {
-    coords.push_back( SGPOINT( aXValue, aYValue, aZValue ) );
+    setDirty();
+
+    if( singlePrecision )
+        fcoords.Edit().push_back( SFVEC3F( aXValue, aYValue, aZValue ) );
+    else
+        coords.Edit().push_back( SGPOINT( aXValue, aYValue, aZValue ) );
+
     return;
 }
 
 
 void SGCOORDS::AddCoord( const SGPOINT& aPoint )
 {
-    coords.push_back( aPoint );
+    AddCoord( aPoint.x, aPoint.y, aPoint.z );
     return;
 }
 
 
-void SGCOORDS::ReNameNodes( void )
+bool SGCOORDS::GetCoordsList( size_t& aListSize, SFVEC3F*& aCoordsList )
+{
+    if( fcoords.empty() )
+    {
+        aListSize = 0;
+        aCoordsList = NULL;
+        return false;
+    }
+
+    setDirty();
+
+    // the caller may modify the data so it must not be shared
+    aListSize = fcoords.size();
+    aCoordsList = &fcoords.Edit()[0];
+    return true;
+}
+
+
+void SGCOORDS::SetCoordsList( size_t aListSize, const SFVEC3F* aCoordsList )
+{
+    setDirty();
+    coords.clear();
+    fcoords.clear();
+    singlePrecision = true;
+
+    if( 0 == aListSize || NULL == aCoordsList )
+        return;
+
+    fcoords.Edit().assign( aCoordsList, aCoordsList + aListSize );
+
+    return;
+}
+
+
+void SGCOORDS::TakeCoordsList( std::vector< SGPOINT >& aCoordsList )
+{
+    setDirty();
+    fcoords.clear();
+    singlePrecision = false;
+    coords.Take( aCoordsList );
+
+    return;
+}
+
+
+void SGCOORDS::TakeCoordsList( std::vector< SFVEC3F >& aCoordsList )
+{
+    setDirty();
+    coords.clear();
+    singlePrecision = true;
+    fcoords.Take( aCoordsList );
+
+    return;
+}
+
+
+void SGCOORDS::ShareCoordsList( const SGCOORDS* aSource )
+{
+    if( NULL == aSource || this == aSource )
+        return;
+
+    setDirty();
+    singlePrecision = aSource->singlePrecision;
+    coords.Share( aSource->coords );
+    fcoords.Share( aSource->fcoords );
+
+    return;
+}
+
+
+void SGCOORDS::SetSinglePrecision( bool aSinglePrecision )
+{
+    if( aSinglePrecision == singlePrecision )
+        return;
+
+    setDirty();
+    singlePrecision = aSinglePrecision;
+
+    if( singlePrecision )
+    {
+        std::vector< SFVEC3F > tmp( coords.size() );
+
+        for( size_t i = 0; i < coords.size(); ++i )
+            tmp[i] = SFVEC3F( coords[i].x, coords[i].y, coords[i].z );
+
+        fcoords.Take( tmp );
+        coords.clear();
+    }
+    else
+    {
+        std::vector< SGPOINT > tmp( fcoords.size() );
+
+        for( size_t i = 0; i < fcoords.size(); ++i )
+            tmp[i] = SGPOINT( fcoords[i].x, fcoords[i].y, fcoords[i].z );
+
+        coords.Take( tmp );
+        fcoords.clear();
+    }
+
+    return;
+}
+
+
+void SGCOORDS::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 }
 
 
 bool SGCOORDS::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
 {
-    if( coords.empty() )
+    if( 0 == GetSize() )
         return false;
 
     if( aReuseFlag )
@@ -234,14 +350,18 @@ bool SGCOORDS::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
     }
 
     std::string tmp;
-    size_t n = coords.size();
+    size_t n = GetSize();
     bool nline = false;
     SGPOINT pt;
 
     for( size_t i = 0; i < n; )
     {
         // ensure VRML output has 1U = 0.1 inch as per legacy kicad expectations
-        pt = coords[i];
+        if( singlePrecision )
+            pt = SGPOINT( fcoords[i].x, fcoords[i].y, fcoords[i].z );
+        else
+            pt = coords[i];
+
         pt.x /= 2.54;
         pt.y /= 2.54;
         pt.z /= 2.54;
@@ -326,12 +446,17 @@ bool SGCOORDS::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    aFile << "[" << GetName() << "]";
-    size_t npts = coords.size();
+    S3D::WriteTag( aFile, this );
+    size_t npts = GetSize();
     aFile.write( (char*)&npts, sizeof(size_t) );
 
     for( size_t i = 0; i < npts; ++i )
-        S3D::WritePoint( aFile, coords[i] );
+    {
+        if( singlePrecision )
+            S3D::WritePoint( aFile, SGPOINT( fcoords[i].x, fcoords[i].y, fcoords[i].z ) );
+        else
+            S3D::WritePoint( aFile, coords[i] );
+    }
 
     if( aFile.fail() )
         return false;
@@ -343,7 +468,7 @@ bool SGCOORDS::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
 
 bool SGCOORDS::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 {
-    if( !coords.empty() )
+    if( 0 != GetSize() )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
@@ -362,19 +487,22 @@ bool SGCOORDS::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     if( aFile.fail() )
         return false;
 
+    std::vector< SGPOINT >& data = coords.Edit();
+
     for( size_t i = 0; i < npts; ++i )
     {
         if( !S3D::ReadPoint( aFile, tmp ) || aFile.fail() )
             return false;
 
-        coords.push_back( tmp );
+        data.push_back( tmp );
     }
 
     return true;
 }
 
 
-bool SGCOORDS::CalcNormals( SGFACESET* callingNode, SGNODE** aPtr )
+bool SGCOORDS::CalcNormals( SGFACESET* callingNode, SGNODE** aPtr,
+    S3D::NORMALWEIGHT aWeight )
 {
     if( aPtr )
         *aPtr = NULL;
@@ -382,50 +510,78 @@ bool SGCOORDS::CalcNormals( SGFACESET* callingNode, SGNODE** aPtr )
     if( NULL == m_Parent || NULL == callingNode )
         return false;
 
-    // the parent and all references must have indices; collect all
-    // indices into one std::vector<>
-    std::vector< int > ilist;
+    // the normals of the parent must account for the triangles
+    // of every faceset which references these coordinates
+    std::vector< SGFACESET* > facesets( 1, callingNode );
     SGNORMALS* np = NULL;
 
     if( callingNode == m_Parent )
     {
-        ((SGFACESET*)m_Parent)->GatherCoordIndices( ilist );
-
-        std::list< SGNODE* >::iterator sB = m_BackPointers.begin();
-        std::list< SGNODE* >::iterator eB = m_BackPointers.end();
+        std::vector< SGNODE* >::iterator sB = m_BackPointers.begin();
+        std::vector< SGNODE* >::iterator eB = m_BackPointers.end();
 
         while( sB != eB )
         {
-            SGFACESET* fp = (SGFACESET*)(*sB);
-            fp->GatherCoordIndices( ilist );
+            facesets.push_back( (SGFACESET*)(*sB) );
             ++sB;
         }
+    }
 
-        np = ((SGFACESET*)m_Parent)->m_Normals;
-
-        if( !np )
-            np = new SGNORMALS( m_Parent );
+    size_t nCoords = GetSize();
+    size_t nIndices = 0;
+    bool ok = nCoords >= 3;
+    std::vector< glm::dvec3 > sums( nCoords, glm::dvec3( 0.0 ) );
 
-    }
-    else
+    for( size_t i = 0; i < facesets.size() && ok; ++i )
     {
-        callingNode->GatherCoordIndices( ilist );
-        np = callingNode->m_Normals;
+        const SGCOORDINDEX* ci = facesets[i]->m_CoordIndices;
+
+        if( NULL == ci || 0 == ci->GetSize() )
+            continue;
+
+        nIndices += ci->GetSize();
+
+        if( singlePrecision && ci->IsCompact() )
+            ok = S3D::AccumulateNormals( fcoords.data(), nCoords, ci->index16.data(),
+                                         ci->index16.size(), &sums[0], aWeight );
+        else if( singlePrecision )
+            ok = S3D::AccumulateNormals( fcoords.data(), nCoords, ci->index.data(),
+                                         ci->index.size(), &sums[0], aWeight );
+        else if( ci->IsCompact() )
+            ok = S3D::AccumulateNormals( coords.data(), nCoords, ci->index16.data(),
+                                         ci->index16.size(), &sums[0], aWeight );
+        else
+            ok = S3D::AccumulateNormals( coords.data(), nCoords, ci->index.data(),
+                                         ci->index.size(), &sums[0], aWeight );
+    }
 
-        if( !np )
-            np = new SGNORMALS( callingNode );
+    if( !ok || 0 == nIndices )
+        return false;
 
-    }
+    // vertices without any triangle are given the default normal (0,0,1)
+    std::vector< SGVECTOR > norms( nCoords );
 
-    if( S3D::CalcTriangleNormals( coords, ilist, np->norms )  )
+    for( size_t i = 0; i < nCoords; ++i )
     {
-        if( aPtr )
-            *aPtr = np;
+        double len = glm::length( sums[i] );
 
-        return true;
+        if( len > 0.0 )
+            norms[i] = SGVECTOR( sums[i].x / len, sums[i].y / len, sums[i].z / len );
     }
 
-    delete np;
+    np = callingNode->m_Normals;
 
-    return false;
+    if( !np )
+        np = new SGNORMALS( callingNode );
+
+    np->TakeNormalList( norms );
+
+    // keep the normals in the same precision as the vertices
+    if( singlePrecision )
+        np->SetSinglePrecision( true );
+
+    if( aPtr )
+        *aPtr = np;
+
+    return true;
 }
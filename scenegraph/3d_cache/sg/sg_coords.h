@@ -31,13 +31,18 @@
 
 #include <vector>
 #include "3d_cache/sg/sg_node.h"
+#include "3d_cache/sg/sg_buffer.h"
 
 class SGFACESET;
 
 class SGCOORDS : public SGNODE
 {
+private:
+    bool singlePrecision;   // true if the vertices are held in 'fcoords'
+
 public:
-    std::vector< SGPOINT > coords;
+    SGBUFFER< SGPOINT > coords;     // double precision vertices
+    SGBUFFER< SFVEC3F > fcoords;    // single precision vertices
 
     void unlinkChildNode( const SGNODE* aNode );
     void unlinkRefNode( const SGNODE* aNode );
@@ -57,14 +62,53 @@ public:
     void AddCoord( double aXValue, double aYValue, double aZValue );
     void AddCoord( const SGPOINT& aPoint );
 
+    bool GetCoordsList( size_t& aListSize, SFVEC3F*& aCoordsList );
+    void SetCoordsList( size_t aListSize, const SFVEC3F* aCoordsList );
+
+    /**
+     * Function TakeCoordsList
+     * takes ownership of the data in the given list without copying it;
+     * the storage precision is set to match the list and aCoordsList is
+     * left empty.
+     */
+    void TakeCoordsList( std::vector< SGPOINT >& aCoordsList );
+    void TakeCoordsList( std::vector< SFVEC3F >& aCoordsList );
+
+    /**
+     * Function ShareCoordsList
+     * makes this node refer to the vertex data held by aSource; no data is
+     * copied and both nodes remain free to modify their data later.
+     */
+    void ShareCoordsList( const SGCOORDS* aSource );
+
+    /**
+     * Function SetSinglePrecision
+     * selects single or double precision storage for the vertices; any
+     * existing vertices are converted. Only the accessors which match
+     * the current storage return data.
+     */
+    void SetSinglePrecision( bool aSinglePrecision );
+
+    bool IsSinglePrecision( void ) const
+    {
+        return singlePrecision;
+    }
+
+    // returns the number of vertices regardless of the storage precision
+    size_t GetSize( void ) const
+    {
+        return singlePrecision ? fcoords.size() : coords.size();
+    }
+
     /**
      * Function CalcNormals
      * calculates normals for this coordinate list and sets the
      * normals list in the parent SGFACESET
      */
-    bool CalcNormals( SGFACESET* callingNode, SGNODE** aPtr = NULL );
+    bool CalcNormals( SGFACESET* callingNode, SGNODE** aPtr = NULL,
+        S3D::NORMALWEIGHT aWeight = S3D::NORMALWEIGHT_AREA );
 
-    void ReNameNodes( void );
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
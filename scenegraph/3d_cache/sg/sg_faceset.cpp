@@ -24,6 +24,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <unordered_set>
 #include <wx/log.h>
 
 #include "3d_cache/sg/sg_faceset.h"
@@ -33,6 +34,80 @@
 #include "3d_cache/sg/sg_coordindex.h"
 #include "3d_cache/sg/sg_helpers.h"
 
+
+// a triangle rotated so that its lowest vertex index comes first; the
+// winding is preserved so a triangle and its reverse remain distinct
+struct TRIKEY
+{
+    int v[3];
+
+    TRIKEY( int a, int b, int c )
+    {
+        if( a < b && a < c )
+        {
+            v[0] = a; v[1] = b; v[2] = c;
+        }
+        else if( b < c )
+        {
+            v[0] = b; v[1] = c; v[2] = a;
+        }
+        else
+        {
+            v[0] = c; v[1] = a; v[2] = b;
+        }
+    }
+
+    bool operator==( const TRIKEY& aKey ) const
+    {
+        return v[0] == aKey.v[0] && v[1] == aKey.v[1] && v[2] == aKey.v[2];
+    }
+};
+
+
+struct TRIKEYHASH
+{
+    size_t operator()( const TRIKEY& aKey ) const
+    {
+        size_t hash = (size_t)aKey.v[0];
+        hash = hash * 1000003 ^ (size_t)aKey.v[1];
+        hash = hash * 1000003 ^ (size_t)aKey.v[2];
+        return hash;
+    }
+};
+
+
+// returns true if the triangle has no area; short edges are rejected by
+// S3D::degenerate() and collinear vertices by the sine of the angle at
+// the first vertex, which is scale independent
+static bool zeroArea( glm::dvec3* pts )
+{
+    if( S3D::degenerate( pts ) )
+        return true;
+
+    glm::dvec3 e1 = pts[1] - pts[0];
+    glm::dvec3 e2 = pts[2] - pts[0];
+    glm::dvec3 cp = glm::cross( e1, e2 );
+
+    return glm::dot( cp, cp ) <= 1e-12 * glm::dot( e1, e1 ) * glm::dot( e2, e2 );
+}
+
+
+// moves the entries which are still in use to the front of the list
+template< typename T >
+static void compactList( std::vector< T >& aList, const std::vector< int >& aMap,
+    size_t aCount )
+{
+    for( size_t i = 0; i < aMap.size() && i < aList.size(); ++i )
+    {
+        if( aMap[i] >= 0 )
+            aList[ aMap[i] ] = aList[i];
+    }
+
+    aList.resize( aCount );
+    return;
+}
+
+
 SGFACESET::SGFACESET( SGNODE* aParent ) : SGNODE( aParent )
 {
     m_SGtype = S3D::SGTYPE_FACESET;
@@ -69,22 +144,29 @@ SGFACESET::SGFACESET( SGNODE* aParent ) : SGNODE( aParent )
 
 SGFACESET::~SGFACESET()
 {
-    // drop references
+    // drop references; a node released by DestroyTree()
+    // no longer needs to unlink itself from its references
     if( m_RColors )
     {
-        m_RColors->delNodeRef( this );
+        if( !m_detached )
+            m_RColors->delNodeRef( this );
+
         m_RColors = NULL;
     }
 
     if( m_RCoords )
     {
-        m_RCoords->delNodeRef( this );
+        if( !m_detached )
+            m_RCoords->delNodeRef( this );
+
         m_RCoords = NULL;
     }
 
     if( m_RNormals )
     {
-        m_RNormals->delNodeRef( this );
+        if( !m_detached )
+            m_RNormals->delNodeRef( this );
+
         m_RNormals = NULL;
     }
 
@@ -156,7 +238,7 @@ SGNODE* SGFACESET::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     SGNODE* np = NULL;
@@ -208,6 +290,7 @@ void SGFACESET::unlinkNode( const SGNODE* aNode, bool isChild )
 
     valid = false;
     validated = false;
+    setDirty();
 
     if( isChild )
     {
@@ -239,21 +322,18 @@ void SGFACESET::unlinkNode( const SGNODE* aNode, bool isChild )
     {
         if( aNode == m_RColors )
         {
-            delNodeRef( this );
             m_RColors = NULL;
             return;
         }
 
         if( aNode == m_RCoords )
         {
-            delNodeRef( this );
             m_RCoords = NULL;
             return;
         }
 
         if( aNode == m_RNormals )
         {
-            delNodeRef( this );
             m_RNormals = NULL;
             return;
         }
@@ -286,6 +366,34 @@ void SGFACESET::unlinkRefNode( const SGNODE* aNode )
 }
 
 
+void SGFACESET::getLinkedNodes( std::vector< SGNODE* >& aChildren,
+    std::vector< SGNODE* >& aRefs ) const
+{
+    if( m_Colors )
+        aChildren.push_back( m_Colors );
+
+    if( m_Coords )
+        aChildren.push_back( m_Coords );
+
+    if( m_Normals )
+        aChildren.push_back( m_Normals );
+
+    if( m_CoordIndices )
+        aChildren.push_back( m_CoordIndices );
+
+    if( m_RColors )
+        aRefs.push_back( m_RColors );
+
+    if( m_RCoords )
+        aRefs.push_back( m_RCoords );
+
+    if( m_RNormals )
+        aRefs.push_back( m_RNormals );
+
+    return;
+}
+
+
 
 bool SGFACESET::addNode( SGNODE* aNode, bool isChild )
 {
@@ -303,6 +411,7 @@ bool SGFACESET::addNode( SGNODE* aNode, bool isChild )
 
     valid = false;
     validated = false;
+    setDirty();
 
     if( S3D::SGTYPE_COLORS == aNode->GetNodeType() )
     {
@@ -455,28 +564,27 @@ bool SGFACESET::AddChildNode( SGNODE* aNode )
 }
 
 
-void SGFACESET::ReNameNodes( void )
+void SGFACESET::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 
     // rename all Colors and Indices
     if( m_Colors )
-        m_Colors->ReNameNodes();
+        m_Colors->ReNameNodes( aNames );
 
     // rename all Coordinates and Indices
     if( m_Coords )
-        m_Coords->ReNameNodes();
+        m_Coords->ReNameNodes( aNames );
 
     if( m_CoordIndices )
-        m_CoordIndices->ReNameNodes();
+        m_CoordIndices->ReNameNodes( aNames );
 
     // rename all Normals and Indices
     if( m_Normals )
-        m_Normals->ReNameNodes();
+        m_Normals->ReNameNodes( aNames );
 
     return;
 }
@@ -602,7 +710,7 @@ bool SGFACESET::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     if( NULL != m_RColors && !m_RColors->isWritten() )
         m_RColors->SwapParent( this );
 
-    aFile << "[" << GetName() << "]";
+    S3D::WriteTag( aFile, this );
     #define NITEMS 7
     bool items[NITEMS];
     int i;
@@ -645,7 +753,7 @@ bool SGFACESET::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         m_Coords->WriteCache( aFile, this );
 
     if( items[1] )
-        aFile << "[" << m_RCoords->GetName() << "]";
+        S3D::WriteTag( aFile, m_RCoords );
 
     if( items[2] )
         m_CoordIndices->WriteCache( aFile, this );
@@ -654,13 +762,13 @@ bool SGFACESET::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         m_Normals->WriteCache( aFile, this );
 
     if( items[4] )
-        aFile << "[" << m_RNormals->GetName() << "]";
+        S3D::WriteTag( aFile, m_RNormals );
 
     if( items[5] )
         m_Colors->WriteCache( aFile, this );
 
     if( items[6] )
-        aFile << "[" << m_RColors->GetName() << "]";
+        S3D::WriteTag( aFile, m_RColors );
 
     if( aFile.fail() )
         return false;
@@ -706,11 +814,11 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    std::string name;
+    unsigned int id = 0;
 
     if( items[0] )
     {
-        if( S3D::SGTYPE_COORDS != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_COORDS != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -724,7 +832,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         m_Coords = new SGCOORDS( this );
-        m_Coords->SetName( name.c_str() );
+        m_Coords->SetID( id );
 
         if( !m_Coords->ReadCache( aFile, this ) )
         {
@@ -732,7 +840,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading coords '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -742,7 +850,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[1] )
     {
-        if( S3D::SGTYPE_COORDS != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_COORDS != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -755,7 +863,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* np = FindNode( name.c_str(), this );
+        SGNODE* np = FindNodeID( S3D::SGTYPE_COORDS, id, this );
 
         if( !np )
         {
@@ -763,7 +871,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref coords '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -776,7 +884,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not SGCOORDS '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -789,7 +897,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[2] )
     {
-        if( S3D::SGTYPE_COORDINDEX != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_COORDINDEX != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -803,7 +911,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         m_CoordIndices = new SGCOORDINDEX( this );
-        m_CoordIndices->SetName( name.c_str() );
+        m_CoordIndices->SetID( id );
 
         if( !m_CoordIndices->ReadCache( aFile, this ) )
         {
@@ -811,7 +919,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading coord index '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -821,7 +929,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[3] )
     {
-        if( S3D::SGTYPE_NORMALS != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_NORMALS != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -835,7 +943,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         m_Normals = new SGNORMALS( this );
-        m_Normals->SetName( name.c_str() );
+        m_Normals->SetID( id );
 
         if( !m_Normals->ReadCache( aFile, this ) )
         {
@@ -843,7 +951,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading normals '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -853,7 +961,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[4] )
     {
-        if( S3D::SGTYPE_NORMALS != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_NORMALS != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -866,7 +974,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* np = FindNode( name.c_str(), this );
+        SGNODE* np = FindNodeID( S3D::SGTYPE_NORMALS, id, this );
 
         if( !np )
         {
@@ -874,7 +982,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref normals '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -887,7 +995,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not SGNORMALS '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -900,7 +1008,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[5] )
     {
-        if( S3D::SGTYPE_COLORS != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_COLORS != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -914,7 +1022,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         m_Colors = new SGCOLORS( this );
-        m_Colors->SetName( name.c_str() );
+        m_Colors->SetID( id );
 
         if( !m_Colors->ReadCache( aFile, this ) )
         {
@@ -922,7 +1030,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading colors '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -932,7 +1040,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[6] )
     {
-        if( S3D::SGTYPE_COLORS != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_COLORS != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -945,7 +1053,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* np = FindNode( name.c_str(), this );
+        SGNODE* np = FindNodeID( S3D::SGTYPE_COLORS, id, this );
 
         if( !np )
         {
@@ -953,7 +1061,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref colors '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -966,7 +1074,7 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not SGCOLORS '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -986,19 +1094,20 @@ bool SGFACESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
 bool SGFACESET::validate( void )
 {
-    // verify the integrity of this object's data
-    if( validated )
+    // verify the integrity of this object's data; a change to any of
+    // the data nodes flags the face set as dirty
+    if( validated && !m_dirty )
         return valid;
 
-    // ensure we have at least coordinates and their normals
+    // ensure we have at least coordinates and their indices; normals
+    // are optional and are otherwise calculated when the model is prepared
     if( (NULL == m_Coords && NULL == m_RCoords)
-        || (NULL == m_Normals && NULL == m_RNormals)
         || (NULL == m_CoordIndices) )
     {
 #ifdef DEBUG
         std::ostringstream ostr;
         ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] bad model; no vertices, vertex indices, or normals";
+        ostr << " * [INFO] bad model; no vertices or vertex indices";
         wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
 #endif
         validated = true;
@@ -1012,9 +1121,7 @@ bool SGFACESET::validate( void )
     if( NULL == coords )
         coords = m_RCoords;
 
-    size_t nCoords = 0;
-    SGPOINT* lCoords = NULL;
-    coords->GetCoordsList( nCoords, lCoords );
+    size_t nCoords = coords->GetSize();
 
     if( nCoords < 3 )
     {
@@ -1030,9 +1137,7 @@ bool SGFACESET::validate( void )
     }
 
     // check that nVertices is divisible by 3 (facets are triangles)
-    size_t nCIdx = 0;
-    int* lCIdx = NULL;
-    m_CoordIndices->GetIndices( nCIdx, lCIdx );
+    size_t nCIdx = m_CoordIndices->GetSize();
 
     if( nCIdx < 3 || ( nCIdx % 3 > 0 ) )
     {
@@ -1050,7 +1155,9 @@ bool SGFACESET::validate( void )
     // check that vertex[n] >= 0 and < nVertices
     for( size_t i = 0; i < nCIdx; ++i )
     {
-        if( lCIdx[i] < 0 || lCIdx[i] >= (int)nCoords )
+        int ti = m_CoordIndices->GetIndex( i );
+
+        if( ti < 0 || ti >= (int)nCoords )
         {
 #ifdef DEBUG
             std::ostringstream ostr;
@@ -1064,22 +1171,18 @@ bool SGFACESET::validate( void )
         }
     }
 
-    // check that there are as many normals as vertices
-    size_t nNorms = 0;
-    SGVECTOR* lNorms = NULL;
+    // if there are normals then ensure there are as many normals as vertices
     SGNORMALS* pNorms = m_Normals;
 
     if( NULL == pNorms )
         pNorms = m_RNormals;
 
-    pNorms->GetNormalList( nNorms, lNorms );
-
-    if( nNorms != nCoords )
+    if( NULL != pNorms && pNorms->GetSize() != nCoords )
     {
 #ifdef DEBUG
         std::ostringstream ostr;
         ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] bad model; number of normals (" << nNorms;
+        ostr << " * [INFO] bad model; number of normals (" << pNorms->GetSize();
         ostr << ") does not match number of vertices (" << nCoords << ")";
         wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
 #endif
@@ -1097,9 +1200,21 @@ bool SGFACESET::validate( void )
     if( NULL != pColors )
     {
         // we must have at least as many colors as vertices
-        size_t nColor = 0;
-        SGCOLOR* pColor = NULL;
-        pColors->GetColorList( nColor, pColor );
+        size_t nColor = pColors->colors.size();
+
+        if( nColor < nCoords )
+        {
+#ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [INFO] bad model; not enough colors per vertex (";
+            ostr << nColor << " vs " << nCoords << ")";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+#endif
+            validated = true;
+            valid = false;
+            return false;
+        }
     }
 
     validated = true;
@@ -1117,21 +1232,160 @@ void SGFACESET::GatherCoordIndices( std::vector< int >& aIndexList )
 }
 
 
-bool SGFACESET::CalcNormals( SGNODE** aPtr )
+bool SGFACESET::CalcNormals( SGNODE** aPtr, S3D::NORMALWEIGHT aWeight )
 {
     SGCOORDS* coords = m_Coords;
 
     if( m_RCoords )
         coords = m_RCoords;
 
-    if( NULL == coords || coords->coords.empty() )
+    if( NULL == coords || 0 == coords->GetSize() )
         return false;
 
-    if( m_Normals && !m_Normals->norms.empty( ) )
+    if( m_Normals && 0 != m_Normals->GetSize() )
         return true;
 
-    if( m_RNormals && !m_RNormals->norms.empty( ) )
+    if( m_RNormals && 0 != m_RNormals->GetSize() )
         return true;
 
-    return coords->CalcNormals( this, aPtr );
+    return coords->CalcNormals( this, aPtr, aWeight );
+}
+
+
+size_t SGFACESET::RemoveDegenerateFaces( size_t& aVertices )
+{
+    SGCOORDS* coords = m_Coords;
+
+    if( NULL == coords )
+        coords = m_RCoords;
+
+    if( NULL == coords || NULL == m_CoordIndices )
+        return 0;
+
+    size_t nCoords = coords->GetSize();
+    size_t nCIdx = m_CoordIndices->GetSize();
+
+    if( nCIdx % 3 > 0 )
+        return 0;
+
+    const SGPOINT* pCoords = NULL;
+    const SFVEC3F* fCoords = NULL;
+
+    if( coords->IsSinglePrecision() )
+        fCoords = coords->fcoords.data();
+    else
+        pCoords = coords->coords.data();
+
+    // the first of a set of repeated triangles is retained
+    std::vector< int > index;
+    std::unordered_set< TRIKEY, TRIKEYHASH > faces;
+    glm::dvec3 pts[3];
+    int tri[3];
+
+    index.reserve( nCIdx );
+    faces.reserve( nCIdx / 3 );
+
+    for( size_t i = 0; i < nCIdx; i += 3 )
+    {
+        for( int j = 0; j < 3; ++j )
+        {
+            tri[j] = m_CoordIndices->GetIndex( i + j );
+
+            if( tri[j] < 0 || tri[j] >= (int)nCoords )
+            {
+                #ifdef DEBUG
+                std::ostringstream ostr;
+                ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+                ostr << " * [INFO] bad model; vertex index out of bounds";
+                wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+                #endif
+                return 0;
+            }
+
+            if( fCoords )
+                pts[j] = glm::dvec3( fCoords[tri[j]].x, fCoords[tri[j]].y, fCoords[tri[j]].z );
+            else
+                pts[j] = glm::dvec3( pCoords[tri[j]].x, pCoords[tri[j]].y, pCoords[tri[j]].z );
+        }
+
+        if( tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0] || zeroArea( pts ) )
+            continue;
+
+        if( !faces.insert( TRIKEY( tri[0], tri[1], tri[2] ) ).second )
+            continue;
+
+        index.insert( index.end(), tri, tri + 3 );
+    }
+
+    size_t nRemoved = ( nCIdx - index.size() ) / 3;
+
+    // the vertices may only be compacted if no other node sees them
+    SGNORMALS* normals = m_Normals;
+    SGCOLORS* colors = m_Colors;
+    bool compact = NULL != m_Coords && !m_Coords->isReferenced()
+        && !m_Coords->coords.IsShared() && !m_Coords->fcoords.IsShared()
+        && NULL == m_RNormals && NULL == m_RColors;
+
+    if( compact && NULL != normals )
+        compact = !normals->isReferenced() && !normals->norms.IsShared()
+            && !normals->fnorms.IsShared() && normals->GetSize() == nCoords;
+
+    if( compact && NULL != colors )
+        compact = !colors->isReferenced() && !colors->colors.IsShared()
+            && colors->colors.size() >= nCoords;
+
+    std::vector< int > vmap;
+    size_t nUsed = nCoords;
+
+    if( compact )
+    {
+        vmap.resize( nCoords, -1 );
+
+        for( size_t i = 0; i < index.size(); ++i )
+            vmap[ index[i] ] = 0;
+
+        nUsed = 0;
+
+        for( size_t i = 0; i < nCoords; ++i )
+        {
+            if( vmap[i] >= 0 )
+                vmap[i] = (int)nUsed++;
+        }
+    }
+
+    if( nUsed < nCoords )
+    {
+        for( size_t i = 0; i < index.size(); ++i )
+            index[i] = vmap[ index[i] ];
+
+        if( coords->IsSinglePrecision() )
+            compactList( coords->fcoords.Edit(), vmap, nUsed );
+        else
+            compactList( coords->coords.Edit(), vmap, nUsed );
+
+        coords->setDirty();
+
+        if( NULL != normals )
+        {
+            if( normals->IsSinglePrecision() )
+                compactList( normals->fnorms.Edit(), vmap, nUsed );
+            else
+                compactList( normals->norms.Edit(), vmap, nUsed );
+
+            normals->setDirty();
+        }
+
+        if( NULL != colors )
+        {
+            compactList( colors->colors.Edit(), vmap, nUsed );
+            colors->setDirty();
+        }
+
+        aVertices += nCoords - nUsed;
+    }
+
+    if( nRemoved > 0 || nUsed < nCoords )
+        m_CoordIndices->SetIndices( index.size(), index.empty() ? NULL : &index[0] );
+
+    return nRemoved;
 }
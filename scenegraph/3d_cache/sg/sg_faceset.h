@@ -62,6 +62,8 @@ public:
 
     void unlinkChildNode( const SGNODE* aNode );
     void unlinkRefNode( const SGNODE* aNode );
+    void getLinkedNodes( std::vector< SGNODE* >& aChildren,
+        std::vector< SGNODE* >& aRefs ) const;
     // validate the data held by this face set
     bool validate( void );
 
@@ -75,9 +77,10 @@ public:
     bool AddRefNode( SGNODE* aNode );
     bool AddChildNode( SGNODE* aNode );
 
-    bool CalcNormals( SGNODE** aPtr );
+    bool CalcNormals( SGNODE** aPtr,
+        S3D::NORMALWEIGHT aWeight = S3D::NORMALWEIGHT_AREA );
 
-    void ReNameNodes( void );
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
@@ -89,6 +92,17 @@ public:
      * in preparation for a normals calculation
      */
     void GatherCoordIndices( std::vector< int >& aIndexList );
+
+    /**
+     * Function RemoveDegenerateFaces
+     * removes triangles with repeated vertices or zero area and all but
+     * the first of any repeated triangles. Vertices which are no longer
+     * used are removed as well if no other node sees the vertex data.
+     *
+     * @param aVertices is incremented by the number of vertices removed
+     * @return the number of triangles removed
+     */
+    size_t RemoveDegenerateFaces( size_t& aVertices );
 };
 
 /*
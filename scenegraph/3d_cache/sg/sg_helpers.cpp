@@ -22,16 +22,23 @@
  */
 
 
+#include <cmath>
+#include <future>
 #include <iomanip>
 #include <iostream>
-#include <map>
 #include <sstream>
+#include <thread>
 #include <utility>
 #include <wx/log.h>
 
+#include "plugins/3dapi/c3dmodel.h"
 #include "3d_cache/sg/sg_helpers.h"
 #include "3d_cache/sg/sg_node.h"
 
+// number of triangles per task below which normals
+// are accumulated on the calling thread only
+#define NORMALS_SPLIT_SIZE (65536)
+
 
 // formats a floating point number for text output to a VRML file
 void S3D::FormatFloat( std::string& result, double value )
@@ -205,7 +212,24 @@ bool S3D::WriteColor( std::ofstream& aFile, const SGCOLOR& aColor )
 }
 
 
-S3D::SGTYPES S3D::ReadTag( std::ifstream& aFile, std::string& aName )
+bool S3D::WriteTag( std::ofstream& aFile, SGNODE* aNode )
+{
+    int type = aNode->GetNodeType();
+    unsigned int id = aNode->GetID();
+
+    aFile.put( '[' );
+    aFile.write( (char*)&type, sizeof( type ) );
+    aFile.write( (char*)&id, sizeof( id ) );
+    aFile.put( ']' );
+
+    if( aFile.fail() )
+        return false;
+
+    return true;
+}
+
+
+S3D::SGTYPES S3D::ReadTag( std::ifstream& aFile, unsigned int& aID )
 {
     char schar;
     aFile.get( schar );
@@ -223,16 +247,12 @@ S3D::SGTYPES S3D::ReadTag( std::ifstream& aFile, std::string& aName )
         return S3D::SGTYPE_END;
     }
 
-    std::string name;
+    int type = S3D::SGTYPE_END;
+    aFile.read( (char*)&type, sizeof( type ) );
+    aFile.read( (char*)&aID, sizeof( aID ) );
     aFile.get( schar );
 
-    while( ']' != schar && aFile.good() )
-    {
-        name.push_back( schar );
-        aFile.get( schar );
-    }
-
-    if( schar != ']' )
+    if( aFile.fail() || ']' != schar )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
@@ -244,52 +264,19 @@ S3D::SGTYPES S3D::ReadTag( std::ifstream& aFile, std::string& aName )
         return S3D::SGTYPE_END;
     }
 
-    aName = name;
-    size_t upos = name.find( '_' );
-
-    if( std::string::npos == upos )
+    if( type < 0 || type >= S3D::SGTYPE_END )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
         ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] corrupt data; no underscore in name '";
-        ostr << name << "'";
+        ostr << " * [INFO] corrupt data; invalid node type " << type;
         wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
         #endif
 
         return S3D::SGTYPE_END;
     }
 
-    name = name.substr( 0, upos );
-    S3D::SGTYPES types[S3D::SGTYPE_END] = {
-        SGTYPE_TRANSFORM,
-        SGTYPE_APPEARANCE,
-        SGTYPE_COLORS,
-        SGTYPE_COLORINDEX,
-        SGTYPE_FACESET,
-        SGTYPE_COORDS,
-        SGTYPE_COORDINDEX,
-        SGTYPE_NORMALS,
-        SGTYPE_SHAPE
-    };
-
-    for( int i = 0; i < S3D::SGTYPE_END; ++i )
-    {
-        if( !name.compare( S3D::GetNodeTypeName( types[i] ) ) )
-            return types[i];
-    }
-
-    #ifdef DEBUG
-    do {
-        std::ostringstream ostr;
-        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] corrupt data; no node type matching '";
-        ostr << name << "'";
-        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
-    } while( 0 );
-    #endif
-
-    return S3D::SGTYPE_END;
+    return (S3D::SGTYPES) type;
 }
 
 
@@ -365,78 +352,109 @@ bool S3D::degenerate( glm::dvec3* pts )
 };
 
 
-static void calcTriad( glm::dvec3* pts, glm::dvec3& tri )
+void S3D::TransformBounds( const glm::dmat4& aTransform, SGPOINT& aMin, SGPOINT& aMax )
 {
-    if( S3D::degenerate( pts ) )
+    // transform the center and accumulate the extent along each
+    // axis from the absolute values of the matrix elements
+    glm::dvec4 center( ( aMin.x + aMax.x ) * 0.5, ( aMin.y + aMax.y ) * 0.5,
+                       ( aMin.z + aMax.z ) * 0.5, 1.0 );
+    glm::dvec3 extent( ( aMax.x - aMin.x ) * 0.5, ( aMax.y - aMin.y ) * 0.5,
+                       ( aMax.z - aMin.z ) * 0.5 );
+
+    center = aTransform * center;
+    glm::dvec3 ne( 0.0, 0.0, 0.0 );
+
+    for( int i = 0; i < 3; ++i )
     {
-        // degenerate points should contribute nothing to the result
-        tri = glm::dvec3( 0.0, 0.0, 0.0 );
-        return;
+        for( int j = 0; j < 3; ++j )
+            ne[i] += fabs( aTransform[j][i] ) * extent[j];
     }
 
-    // normal * 2 * area
-    tri = glm::cross( pts[1] - pts[0], pts[2] - pts[0] );
+    aMin = SGPOINT( center.x - ne.x, center.y - ne.y, center.z - ne.z );
+    aMax = SGPOINT( center.x + ne.x, center.y + ne.y, center.z + ne.z );
 
     return;
 }
 
 
-bool S3D::CalcTriangleNormals( std::vector< SGPOINT > coords,
-    std::vector< int >& index, std::vector< SGVECTOR >& norms )
+// adds the weighted normals of triangles [aFirst, aLast) to aNorms
+template< typename P, typename I >
+static void accumulateNormals( const P* aCoords, const I* aIndex, size_t aFirst,
+    size_t aLast, glm::dvec3* aNorms, S3D::NORMALWEIGHT aWeight )
 {
-    size_t vsize = coords.size();
+    glm::dvec3 pts[3];
+    glm::dvec3 norm;
 
-    if( vsize < 3 )
+    for( size_t t = aFirst; t < aLast; ++t )
     {
-        #ifdef DEBUG
-        std::ostringstream ostr;
-        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] invalid vertex set (fewer than 3 vertices)";
-        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
-        #endif
+        const I* tri = aIndex + t * 3;
 
-        return false;
-    }
+        for( int k = 0; k < 3; ++k )
+            pts[k] = glm::dvec3( aCoords[tri[k]].x, aCoords[tri[k]].y, aCoords[tri[k]].z );
 
-    size_t isize = index.size();
+        if( S3D::degenerate( pts ) )
+            continue;
 
-    if( 0 != isize % 3 || index.empty() )
-    {
-        #ifdef DEBUG
-        std::ostringstream ostr;
-        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] invalid index set (not multiple of 3)";
-        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
-        #endif
+        // normal * 2 * area
+        norm = glm::cross( pts[1] - pts[0], pts[2] - pts[0] );
 
-        return false;
+        if( S3D::NORMALWEIGHT_AREA == aWeight )
+        {
+            aNorms[tri[0]] += norm;
+            aNorms[tri[1]] += norm;
+            aNorms[tri[2]] += norm;
+            continue;
+        }
+
+        double len = glm::length( norm );
+
+        if( len <= 0.0 )
+            continue;
+
+        norm /= len;
+
+        for( int k = 0; k < 3; ++k )
+        {
+            glm::dvec3 e0 = pts[( k + 1 ) % 3] - pts[k];
+            glm::dvec3 e1 = pts[( k + 2 ) % 3] - pts[k];
+            double cosA = glm::dot( e0, e1 ) / sqrt( glm::dot( e0, e0 ) * glm::dot( e1, e1 ) );
+
+            if( cosA > 1.0 )
+                cosA = 1.0;
+            else if( cosA < -1.0 )
+                cosA = -1.0;
+
+            aNorms[tri[k]] += norm * acos( cosA );
+        }
     }
 
-    if( !norms.empty() )
+    return;
+}
+
+
+template< typename P, typename I >
+bool S3D::AccumulateNormals( const P* aCoords, size_t aNumCoords, const I* aIndex,
+    size_t aNumIndex, glm::dvec3* aNorms, NORMALWEIGHT aWeight )
+{
+    if( 0 != aNumIndex % 3 || ( aNumIndex && ( NULL == aCoords || NULL == aIndex ) ) )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
         ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [INFO] normals set is not empty";
+        ostr << " * [INFO] invalid index set (not multiple of 3)";
         wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
         #endif
 
         return false;
     }
 
-    std::map< int, std::list< glm::dvec3 > >vmap;
-
-    int p1, p2, p3;
-
-    // create the map of indices to facet sets
-    for( size_t i = 0; i < isize; )
+    // the indices are checked first so that nothing is
+    // accumulated from an invalid set
+    for( size_t i = 0; i < aNumIndex; ++i )
     {
-        p1 = index[i++];
-        p2 = index[i++];
-        p3 = index[i++];
+        int idx = aIndex[i];
 
-        if( p1 < 0 || p1 >= (int)vsize || p2 < 0 || p2 >= (int)vsize ||
-            p3 < 0 || p3 >= (int)vsize )
+        if( idx < 0 || (size_t)idx >= aNumCoords )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -447,93 +465,68 @@ bool S3D::CalcTriangleNormals( std::vector< SGPOINT > coords,
 
             return false;
         }
+    }
 
-        glm::dvec3 tri;
-        glm::dvec3 trip[3];
-        trip[0] = glm::dvec3( coords[p1].x, coords[p1].y, coords[p1].z );
-        trip[1] = glm::dvec3( coords[p2].x, coords[p2].y, coords[p2].z );
-        trip[2] = glm::dvec3( coords[p3].x, coords[p3].y, coords[p3].z );
-        calcTriad( trip, tri );
-
-        std::map< int, std::list< glm::dvec3 > >::iterator ip = vmap.find( p1 );
-
-        if( ip != vmap.end() )
-        {
-            ip->second.push_back( tri );
-        }
-        else
-        {
-            vmap.insert( std::pair < int, std::list < glm::dvec3 > >
-                ( p1, std::list < glm::dvec3 >( 1, tri ) ) );
-        }
-
-        ip = vmap.find( p2 );
-
-        if( ip != vmap.end() )
-        {
-            ip->second.push_back( tri );
-        }
-        else
-        {
-            vmap.insert( std::pair < int, std::list < glm::dvec3 > >
-                ( p2, std::list < glm::dvec3 >( 1, tri ) ) );
-        }
-
-        ip = vmap.find( p3 );
+    size_t nTris = aNumIndex / 3;
+    size_t nTasks = std::min( (size_t)std::thread::hardware_concurrency(),
+                              nTris / NORMALS_SPLIT_SIZE );
 
-        if( ip != vmap.end() )
-        {
-            ip->second.push_back( tri );
-        }
-        else
-        {
-            vmap.insert( std::pair < int, std::list < glm::dvec3 > >
-                ( p3, std::list < glm::dvec3 >( 1, tri ) ) );
-        }
+    if( nTasks < 2 )
+    {
+        accumulateNormals( aCoords, aIndex, 0, nTris, aNorms, aWeight );
+        return true;
     }
 
-    std::map< int, std::list< glm::dvec3 > >::iterator sM = vmap.begin();
-    std::map< int, std::list< glm::dvec3 > >::iterator eM = vmap.end();
-    size_t idx = 0;
+    // each additional task sums into its own array; the
+    // calling thread handles the first range itself
+    std::vector< std::vector< glm::dvec3 > > partial( nTasks - 1 );
+    std::vector< std::future< void > > tasks;
+    size_t step = nTris / nTasks;
 
-    while( sM != eM )
+    for( size_t i = 1; i < nTasks; ++i )
     {
-        size_t item = sM->first;
+        size_t first = i * step;
+        size_t last = ( i + 1 == nTasks ) ? nTris : first + step;
+        glm::dvec3* sum;
 
-        // assign any skipped coordinates a normal of (0,0,1)
-        while( item > idx )
+        partial[i - 1].resize( aNumCoords, glm::dvec3( 0.0 ) );
+        sum = &partial[i - 1][0];
+
+        try
         {
-            norms.push_back( SGVECTOR( 0, 0, 1 ) );
-            ++idx;
+            tasks.push_back( std::async( std::launch::async, accumulateNormals< P, I >,
+                aCoords, aIndex, first, last, sum, aWeight ) );
         }
-
-        std::list< glm::dvec3 >::iterator sT = sM->second.begin();
-        std::list< glm::dvec3 >::iterator eT = sM->second.end();
-        glm::dvec3 norm( 0.0, 0.0, 0.0 );
-
-        while( sT != eT )
+        catch( std::exception& )
         {
-            norm += *sT;
-            ++sT;
+            accumulateNormals( aCoords, aIndex, first, last, sum, aWeight );
         }
+    }
 
-        norms.push_back( SGVECTOR( norm.x, norm.y, norm.z ) );
+    accumulateNormals( aCoords, aIndex, 0, step, aNorms, aWeight );
 
-        ++idx;
-        ++sM;
-    }
+    for( size_t i = 0; i < tasks.size(); ++i )
+        tasks[i].get();
 
-    if( norms.size() != coords.size() )
+    for( size_t i = 0; i < partial.size(); ++i )
     {
-        #ifdef DEBUG
-        std::ostringstream ostr;
-        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
-        ostr << " * [BUG] number of normals does not equal number of vertices";
-        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
-        #endif
+        const glm::dvec3* sum = &partial[i][0];
 
-        return false;
+        for( size_t j = 0; j < aNumCoords; ++j )
+            aNorms[j] += sum[j];
     }
 
     return true;
 }
+
+
+template bool S3D::AccumulateNormals< SGPOINT, int >( const SGPOINT*, size_t,
+    const int*, size_t, glm::dvec3*, NORMALWEIGHT );
+template bool S3D::AccumulateNormals< SGPOINT, unsigned short >( const SGPOINT*, size_t,
+    const unsigned short*, size_t, glm::dvec3*, NORMALWEIGHT );
+template bool S3D::AccumulateNormals< SFVEC3F, int >( const SFVEC3F*, size_t,
+    const int*, size_t, glm::dvec3*, NORMALWEIGHT );
+template bool S3D::AccumulateNormals< SFVEC3F, unsigned short >( const SFVEC3F*, size_t,
+    const unsigned short*, size_t, glm::dvec3*, NORMALWEIGHT );
+template bool S3D::AccumulateNormals< SFVEC3F, unsigned int >( const SFVEC3F*, size_t,
+    const unsigned int*, size_t, glm::dvec3*, NORMALWEIGHT );
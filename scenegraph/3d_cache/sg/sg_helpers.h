@@ -40,6 +40,7 @@
 #include "plugins/3dapi/sg_types.h"
 #include <glm/glm.hpp>
 
+class SGNODE;
 class SGNORMALS;
 class SGCOORDS;
 class SGCOORDINDEX;
@@ -74,7 +75,8 @@ class SGCOORDINDEX;
 
 
 // Function to unlink a child or reference node when that child or
-// reference node is being destroyed.
+// reference node is being destroyed. The calling class must provide
+// delMember() (see ADD_NODE).
 #define UNLINK_NODE( aNodeID, aType, aNode, aOwnedList, aRefList, isChild ) do { \
         if( aNodeID == aNode->GetNodeType() ) { \
             std::vector< aType* >* oSL; \
@@ -86,6 +88,7 @@ class SGCOORDINDEX;
                 eL =  aOwnedList.end(); \
                 while( sL != eL ) { \
                     if( (SGNODE*)*sL == aNode ) { \
+                        delMember( aNode ); \
                         oSL->erase( sL ); \
                         return; \
                     } \
@@ -97,7 +100,7 @@ class SGCOORDINDEX;
                 eL =  aRefList.end(); \
                 while( sL != eL ) { \
                     if( (SGNODE*)*sL == aNode ) { \
-                        delNodeRef( this ); \
+                        delMember( aNode ); \
                         oSL->erase( sL ); \
                         return; \
                     } \
@@ -109,14 +112,12 @@ class SGCOORDINDEX;
 
 
 // Function to check a node type, check for an existing reference,
-// and add the node type to the reference list if applicable
+// and add the node type to the reference list if applicable.
+// The calling class must provide isMember() and addMember() which
+// track the contents of all of its owned and referenced node lists.
 #define ADD_NODE( aNodeID, aType, aNode, aOwnedList, aRefList, isChild ) do { \
     if( aNodeID == aNode->GetNodeType() ) { \
-        std::vector< aType* >::iterator sL; \
-        sL = std::find( aOwnedList.begin(), aOwnedList.end(), aNode ); \
-        if( sL != aOwnedList.end() ) return true; \
-        sL = std::find( aRefList.begin(), aRefList.end(), aNode ); \
-        if( sL != aRefList.end() ) return true; \
+        if( isMember( aNode ) ) return true; \
         if( isChild ) { \
             SGNODE* ppn = (SGNODE*)aNode->GetParent(); \
             if( NULL != ppn ) { \
@@ -129,6 +130,7 @@ class SGCOORDINDEX;
                 } \
             } \
             aOwnedList.push_back( (aType*)aNode ); \
+            addMember( aNode ); \
             aNode->SetParent( this, false ); \
         } else { \
             if( NULL == aNode->GetParent() ) { \
@@ -139,6 +141,7 @@ class SGCOORDINDEX;
                 return false; \
             } \
             aRefList.push_back( (aType*)aNode ); \
+            addMember( aNode ); \
             aNode->addNodeRef( this ); \
         } \
         return true; \
@@ -163,28 +166,38 @@ namespace S3D
 {
     bool degenerate( glm::dvec3* pts );
 
+    /*
+     * Function TransformBounds
+     * replaces the axis aligned box aMin, aMax with the smallest axis
+     * aligned box which encloses the original box after transformation
+     * by aTransform; only the box is visited, not the underlying vertices.
+     */
+    void TransformBounds( const glm::dmat4& aTransform, SGPOINT& aMin, SGPOINT& aMax );
+
     //
     // Normals calculations from triangles
     //
 
     /*
-     * Function CalcTriangleNormals
-     * takes an array of 3D coordinates and its corresponding index set and calculates
-     * the normals assuming that indices are given in CCW order. Care must be taken in
-     * using this function to ensure that:
-     * (a) all coordinates are indexed; unindexed coordinates are assigned normal(0,0,1);
-     * when dealing with VRML models which may list and reuse one large coordinate set it
-     * is necessary to gather all index sets and perform this operation only once.
-     * (b) index sets must represent triangles (multiple of 3 indices) and must not be
-     * degenerate - that is all indices and coordinates in a triad must be unique.
+     * Function AccumulateNormals
+     * adds the normal of each triangle of aIndex (given in CCW order) to the
+     * entries of aNorms for its three vertices in a single pass; aNorms must
+     * hold one entry per coordinate. The normals are weighted by the area
+     * of the triangle or by its angle at the vertex; degenerate triangles
+     * contribute nothing. Large index sets are split over several threads.
+     * The function is provided for SGPOINT and SFVEC3F coordinates with
+     * int and unsigned short indices and for SFVEC3F coordinates with the
+     * unsigned int indices of a prepared mesh.
      *
-     * @param coords is the array of 3D vertices
-     * @param index is the array of 3x vertex indices (triads)
-     * @param norms is an empty array which holds the normals corresponding to each vector
-     * @return true on success; otherwise false.
+     * @param aCoords is the array of aNumCoords vertices
+     * @param aIndex is the array of aNumIndex vertex indices (triads)
+     * @param aNorms receives the sums of the weighted triangle normals
+     * @param aWeight selects the weighting of the triangle normals
+     * @return false if the indices are not triads or are out of bounds
      */
-    bool CalcTriangleNormals( std::vector< SGPOINT > coords, std::vector< int >& index,
-        std::vector< SGVECTOR >& norms );
+    template< typename P, typename I >
+    bool AccumulateNormals( const P* aCoords, size_t aNumCoords, const I* aIndex,
+        size_t aNumIndex, glm::dvec3* aNorms, NORMALWEIGHT aWeight );
 
     //
     // VRML related functions
@@ -218,21 +231,24 @@ namespace S3D
     // write out an RGB color
     bool WriteColor( std::ofstream& aFile, const SGCOLOR& aColor );
 
+    // write out the tag (node type and ID) which identifies a node
+    bool WriteTag( std::ofstream& aFile, SGNODE* aNode );
+
     //
     // Cache related READ functions
     //
 
     /**
      * Function ReadTag
-     * reads the text tag of a binary cache file which is the
-     * NodeTag and unique ID number combined
+     * reads the tag of a binary cache file which is the
+     * node type and unique ID number combined
      *
      * @param aFile is a binary file open for reading
-     * @param aName will hold the tag name on successful return
+     * @param aID will hold the node ID on successful return
      * @return will be the NodeType which the tag represents or
      * S3D::SGTYPES::SGTYPE_END on failure
      */
-    S3D::SGTYPES ReadTag( std::ifstream& aFile, std::string& aName );
+    S3D::SGTYPES ReadTag( std::ifstream& aFile, unsigned int& aID );
 
     // read an XYZ vertex
     bool ReadPoint( std::ifstream& aFile, SGPOINT& aPoint );
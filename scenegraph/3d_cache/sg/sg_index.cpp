@@ -27,10 +27,45 @@
 #include <wx/log.h>
 
 #include "3d_cache/sg/sg_index.h"
+#include "3d_cache/sg/sg_helpers.h"
+
+
+// returns true if every index in the list fits an unsigned short
+static bool fitsCompact( const int* aIndexList, size_t nIndices )
+{
+    for( size_t i = 0; i < nIndices; ++i )
+    {
+        if( aIndexList[i] < 0 || aIndexList[i] > 0xffff )
+            return false;
+    }
+
+    return true;
+}
+
+
+// converts the list to 16 bits in a single pass; returns false if an index
+// does not fit, in which case the content of aData is undefined
+static bool narrowIndices( const int* aIndexList, size_t nIndices,
+    std::vector< unsigned short >& aData )
+{
+    aData.resize( nIndices );
+
+    for( size_t i = 0; i < nIndices; ++i )
+    {
+        if( aIndexList[i] < 0 || aIndexList[i] > 0xffff )
+            return false;
+
+        aData[i] = (unsigned short)aIndexList[i];
+    }
+
+    return true;
+}
 
 
 SGINDEX::SGINDEX( SGNODE* aParent ) : SGNODE( aParent )
 {
+    compact = true;
+
     if( NULL != aParent && S3D::SGTYPE_FACESET != aParent->GetNodeType() )
     {
         m_Parent = NULL;
@@ -51,6 +86,7 @@ SGINDEX::SGINDEX( SGNODE* aParent ) : SGNODE( aParent )
 SGINDEX::~SGINDEX()
 {
     index.clear();
+    index16.clear();
     return;
 }
 
@@ -90,7 +126,7 @@ SGNODE* SGINDEX::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     return NULL;
@@ -149,30 +185,74 @@ bool SGINDEX::AddChildNode( SGNODE* aNode )
 }
 
 
+void SGINDEX::compactIndices( void )
+{
+    std::vector< unsigned short > data;
+
+    if( compact || !narrowIndices( index.data(), index.size(), data ) )
+        return;
+
+    index16.Take( data );
+    index.clear();
+    compact = true;
+
+    return;
+}
+
+
+void SGINDEX::widenIndices( void )
+{
+    if( !compact )
+        return;
+
+    std::vector< int > data( index16.begin(), index16.end() );
+    index.Take( data );
+    index16.clear();
+    compact = false;
+
+    return;
+}
+
+
 bool SGINDEX::GetIndices( size_t& nIndices, int*& aIndexList )
 {
-    if( index.empty() )
+    if( 0 == GetSize() )
     {
         nIndices = 0;
         aIndexList = NULL;
         return false;
     }
 
+    setDirty();
+
+    // the caller may modify the data so it must be held at
+    // full width and must not be shared
+    widenIndices();
     nIndices = index.size();
-    aIndexList = & index[0];
+    aIndexList = &index.Edit()[0];
     return true;
 }
 
 
 void SGINDEX::SetIndices( size_t nIndices, int* aIndexList )
 {
+    setDirty();
     index.clear();
+    index16.clear();
+    compact = true;
 
     if( 0 == nIndices || NULL == aIndexList )
         return;
 
-    for( size_t i = 0; i < nIndices; ++i )
-        index.push_back( aIndexList[i] );
+    if( fitsCompact( aIndexList, nIndices ) )
+    {
+        index16.Edit().assign( aIndexList, aIndexList + nIndices );
+    }
+    else
+    {
+        index.Edit().assign( aIndexList, aIndexList + nIndices );
+        compact = false;
+    }
 
     return;
 }
@@ -180,24 +260,93 @@ void SGINDEX::SetIndices( size_t nIndices, int* aIndexList )
 
 void SGINDEX::AddIndex( int aIndex )
 {
-    index.push_back( aIndex );
+    setDirty();
+
+    if( compact && aIndex >= 0 && aIndex <= 0xffff )
+    {
+        index16.Edit().push_back( (unsigned short)aIndex );
+        return;
+    }
+
+    widenIndices();
+    index.Edit().push_back( aIndex );
+    return;
+}
+
+
+void SGINDEX::AddIndices( size_t nIndices, const int* aIndexList )
+{
+    if( 0 == nIndices || NULL == aIndexList )
+        return;
+
+    setDirty();
+
+    if( compact && fitsCompact( aIndexList, nIndices ) )
+    {
+        std::vector< unsigned short >& data = index16.Edit();
+        data.insert( data.end(), aIndexList, aIndexList + nIndices );
+        return;
+    }
+
+    widenIndices();
+    std::vector< int >& data = index.Edit();
+    data.insert( data.end(), aIndexList, aIndexList + nIndices );
+
+    return;
+}
+
+
+void SGINDEX::TakeIndices( std::vector< int >& aIndexList )
+{
+    setDirty();
+    index.clear();
+    index16.clear();
+
+    // lists which address at most 65536 vertices are held at half the
+    // size; the adopted list is released once it has been narrowed
+    std::vector< unsigned short > data;
+
+    if( !aIndexList.empty() && narrowIndices( &aIndexList[0], aIndexList.size(), data ) )
+    {
+        index16.Take( data );
+        std::vector< int >().swap( aIndexList );
+        compact = true;
+        return;
+    }
+
+    index.Take( aIndexList );
+    compact = false;
+
     return;
 }
 
 
-void SGINDEX::ReNameNodes( void )
+void SGINDEX::ShareIndices( const SGINDEX* aSource )
+{
+    if( NULL == aSource || this == aSource )
+        return;
+
+    setDirty();
+    index.Share( aSource->index );
+    index16.Share( aSource->index16 );
+    compact = aSource->compact;
+
+    return;
+}
+
+
+void SGINDEX::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 }
 
 
 bool SGINDEX::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
 {
-    if( index.empty() )
+    if( 0 == GetSize() )
         return false;
 
     if( S3D::SGTYPE_COORDINDEX == m_SGtype )
@@ -209,7 +358,7 @@ bool SGINDEX::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
 
 bool SGINDEX::writeCoordIndex( std::ofstream& aFile )
 {
-    size_t n = index.size();
+    size_t n = GetSize();
 
     if( n % 3 )
     {
@@ -231,7 +380,7 @@ bool SGINDEX::writeCoordIndex( std::ofstream& aFile )
 
     for( size_t i = 0; i < n; )
     {
-        aFile << index[i];
+        aFile << GetIndex( i );
         ++i;
 
         if( ++nv0 == 3 )
@@ -270,11 +419,11 @@ bool SGINDEX::writeIndexList( std::ofstream& aFile )
 {
     // index to control formatting
     int nv = 0;
-    size_t n = index.size();
+    size_t n = GetSize();
 
     for( size_t i = 0; i < n; )
     {
-        aFile << index[i];
+        aFile << GetIndex( i );
         ++i;
 
         if( i < n )
@@ -349,12 +498,16 @@ bool SGINDEX::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    aFile << "[" << GetName() << "]";
-    size_t npts = index.size();
+    S3D::WriteTag( aFile, this );
+    size_t npts = GetSize();
     aFile.write( (char*)&npts, sizeof(size_t) );
+    int tmp;
 
     for( size_t i = 0; i < npts; ++i )
-        aFile.write( (char*)&index[i], sizeof(int) );
+    {
+        tmp = GetIndex( i );
+        aFile.write( (char*)&tmp, sizeof(int) );
+    }
 
     if( aFile.fail() )
         return false;
@@ -366,7 +519,7 @@ bool SGINDEX::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
 
 bool SGINDEX::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 {
-    if( !index.empty() )
+    if( 0 != GetSize() )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
@@ -385,6 +538,8 @@ bool SGINDEX::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     if( aFile.fail() )
         return false;
 
+    std::vector< int > data;
+
     for( size_t i = 0; i < npts; ++i )
     {
         aFile.read( (char*)&tmp, sizeof(int) );
@@ -392,8 +547,12 @@ bool SGINDEX::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         if( aFile.fail() )
             return false;
 
-        index.push_back( tmp );
+        data.push_back( tmp );
     }
 
+    compact = false;
+    index.Take( data );
+    compactIndices();
+
     return true;
 }
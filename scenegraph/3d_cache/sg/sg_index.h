@@ -31,17 +31,31 @@
 
 #include <vector>
 #include "3d_cache/sg/sg_node.h"
+#include "3d_cache/sg/sg_buffer.h"
 
 class SGINDEX : public SGNODE
 {
+private:
+    // true if the indices are held in index16 rather than index
+    bool compact;
+
+    // moves the indices into index16 if every value fits 16 bits
+    void compactIndices( void );
+
+    // moves the indices into index
+    void widenIndices( void );
+
 protected:
     bool writeCoordIndex( std::ofstream& aFile );
     bool writeColorIndex( std::ofstream& aFile );
     bool writeIndexList( std::ofstream& aFile );
 
 public:
-    // for internal SG consumption only
-    std::vector< int > index;
+    // for internal SG consumption only; the indices are held in index16
+    // whenever every index is in the range [0, 65535] and in index
+    // otherwise. Use GetSize() and GetIndex() to read either form.
+    SGBUFFER< int > index;
+    SGBUFFER< unsigned short > index16;
     void unlinkChildNode( const SGNODE* aCaller );
     void unlinkRefNode( const SGNODE* aCaller );
 
@@ -55,10 +69,30 @@ public:
     bool AddRefNode( SGNODE* aNode );
     bool AddChildNode( SGNODE* aNode );
 
+    /**
+     * Function IsCompact
+     * returns true if the indices are stored in 16 bits (index16)
+     */
+    bool IsCompact( void ) const
+    {
+        return compact;
+    }
+
+    size_t GetSize( void ) const
+    {
+        return compact ? index16.size() : index.size();
+    }
+
+    int GetIndex( size_t aIndex ) const
+    {
+        return compact ? (int)index16[aIndex] : index[aIndex];
+    }
+
     /**
      * Function GetIndices
      * retrieves the number of indices and a pointer to
-     * the list. Note: the returned pointer may be invalidated
+     * the list; compact indices are widened to int since the
+     * caller may modify them. Note: the returned pointer may be invalidated
      * by future operations on the SGNODE; the caller must make
      * immediate use of the data and must not rely on the pointer's
      * validity in the future.
@@ -88,7 +122,31 @@ public:
      */
     void AddIndex( int aIndex );
 
-    void ReNameNodes( void );
+    /**
+     * Function AddIndices
+     * appends a block of indices to the list
+     *
+     * @param nIndices [in] the number of indices to be appended
+     * @param aIndexList [in] the index data
+     */
+    void AddIndices( size_t nIndices, const int* aIndexList );
+
+    /**
+     * Function TakeIndices
+     * takes ownership of the data in the given list; if every index fits
+     * 16 bits the list is narrowed in a single pass and released, otherwise
+     * it is adopted without copying. aIndexList is left empty.
+     */
+    void TakeIndices( std::vector< int >& aIndexList );
+
+    /**
+     * Function ShareIndices
+     * makes this node refer to the index data held by aSource; no data
+     * is copied and both nodes remain free to modify their data later.
+     */
+    void ShareIndices( const SGINDEX* aSource );
+
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
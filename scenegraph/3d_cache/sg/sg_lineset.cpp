@@ -0,0 +1,547 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <wx/log.h>
+
+#include "3d_cache/sg/sg_lineset.h"
+#include "3d_cache/sg/sg_helpers.h"
+
+
+SGLINESET::SGLINESET( SGNODE* aParent ) : SGNODE( aParent )
+{
+    m_SGtype = S3D::SGTYPE_LINESET;
+    valid = false;
+    validated = false;
+
+    if( NULL != aParent && S3D::SGTYPE_SHAPE != aParent->GetNodeType() )
+    {
+        m_Parent = NULL;
+
+#ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [BUG] inappropriate parent to SGLINESET (type ";
+        ostr << aParent->GetNodeType() << ")";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+#endif
+    }
+    else if( NULL != aParent && S3D::SGTYPE_SHAPE == aParent->GetNodeType() )
+    {
+        m_Parent->AddChildNode( this );
+    }
+
+    return;
+}
+
+
+SGLINESET::~SGLINESET()
+{
+    coords.clear();
+    index.clear();
+    return;
+}
+
+
+bool SGLINESET::SetParent( SGNODE* aParent, bool notify )
+{
+    if( NULL != m_Parent )
+    {
+        if( aParent == m_Parent )
+            return true;
+
+        // handle the change in parents
+        if( notify )
+            m_Parent->unlinkChildNode( this );
+
+        m_Parent = NULL;
+
+        if( NULL == aParent )
+            return true;
+    }
+
+    // only a SGSHAPE may be parent to a SGLINESET
+    if( NULL != aParent && S3D::SGTYPE_SHAPE != aParent->GetNodeType() )
+        return false;
+
+    m_Parent = aParent;
+
+    if( m_Parent )
+        m_Parent->AddChildNode( this );
+
+    return true;
+}
+
+
+SGNODE* SGLINESET::FindNode(const char *aNodeName, const SGNODE *aCaller)
+{
+    if( NULL == aNodeName || 0 == aNodeName[0] )
+        return NULL;
+
+    if( IsNamed( aNodeName ) )
+        return this;
+
+    return NULL;
+}
+
+
+void SGLINESET::unlinkChildNode( const SGNODE* aCaller )
+{
+    #ifdef DEBUG
+    std::ostringstream ostr;
+    ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+    ostr << " * [BUG] unexpected code branch; node should have no children or refs";
+    wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+    #endif
+
+    return;
+}
+
+
+void SGLINESET::unlinkRefNode( const SGNODE* aCaller )
+{
+    #ifdef DEBUG
+    std::ostringstream ostr;
+    ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+    ostr << " * [BUG] unexpected code branch; node should have no children or refs";
+    wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+    #endif
+
+    return;
+}
+
+
+bool SGLINESET::AddRefNode( SGNODE* aNode )
+{
+    #ifdef DEBUG
+    std::ostringstream ostr;
+    ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+    ostr << " * [BUG] this node does not accept children or refs";
+    wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+    #endif
+
+    return false;
+}
+
+
+bool SGLINESET::AddChildNode( SGNODE* aNode )
+{
+    #ifdef DEBUG
+    std::ostringstream ostr;
+    ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+    ostr << " * [BUG] this node does not accept children or refs";
+    wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+    #endif
+
+    return false;
+}
+
+
+bool SGLINESET::GetCoordsList( size_t& aListSize, SGPOINT*& aCoordsList )
+{
+    if( coords.empty() )
+    {
+        aListSize = 0;
+        aCoordsList = NULL;
+        return false;
+    }
+
+    // the caller may modify the data
+    setDirty();
+    aListSize = coords.size();
+    aCoordsList = &coords[0];
+    return true;
+}
+
+
+void SGLINESET::SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList )
+{
+    coords.clear();
+    validated = false;
+    setDirty();
+
+    if( 0 == aListSize || NULL == aCoordsList )
+        return;
+
+    coords.assign( aCoordsList, aCoordsList + aListSize );
+
+    return;
+}
+
+
+void SGLINESET::AddCoord( const SGPOINT& aPoint )
+{
+    validated = false;
+    setDirty();
+    coords.push_back( aPoint );
+    return;
+}
+
+
+bool SGLINESET::GetIndices( size_t& nIndices, int*& aIndexList )
+{
+    if( index.empty() )
+    {
+        nIndices = 0;
+        aIndexList = NULL;
+        return false;
+    }
+
+    // the caller may modify the data
+    setDirty();
+    nIndices = index.size();
+    aIndexList = &index[0];
+    return true;
+}
+
+
+void SGLINESET::SetIndices( size_t nIndices, int* aIndexList )
+{
+    index.clear();
+    validated = false;
+    setDirty();
+
+    if( 0 == nIndices || NULL == aIndexList )
+        return;
+
+    index.assign( aIndexList, aIndexList + nIndices );
+
+    return;
+}
+
+
+void SGLINESET::AddSegment( int aIndex0, int aIndex1 )
+{
+    validated = false;
+    setDirty();
+    index.push_back( aIndex0 );
+    index.push_back( aIndex1 );
+    return;
+}
+
+
+void SGLINESET::ReNameNodes( S3D::NAMECTX& aNames )
+{
+    m_written = false;
+
+    // rename this node
+    SetName( aNames );
+}
+
+
+bool SGLINESET::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
+{
+    if( coords.empty() || index.empty() )
+        return false;
+
+    if( aReuseFlag )
+    {
+        if( !m_written )
+        {
+            aFile << " geometry DEF " << GetName() << " IndexedLineSet {\n";
+            m_written = true;
+        }
+        else
+        {
+            aFile << "USE " << GetName() << "\n";
+            return true;
+        }
+    }
+    else
+    {
+        aFile << " geometry IndexedLineSet {\n";
+    }
+
+    aFile << "  coord Coordinate { point [\n  ";
+
+    std::string tmp;
+    size_t n = coords.size();
+    bool nline = false;
+    SGPOINT pt;
+
+    for( size_t i = 0; i < n; )
+    {
+        // ensure VRML output has 1U = 0.1 inch as per legacy kicad expectations
+        pt = coords[i];
+        pt.x /= 2.54;
+        pt.y /= 2.54;
+        pt.z /= 2.54;
+        S3D::FormatPoint( tmp, pt );
+        aFile << tmp ;
+        ++i;
+
+        if( i < n )
+        {
+            aFile << ",";
+
+            if( nline )
+            {
+                aFile << "\n  ";
+                nline = false;
+            }
+            else
+            {
+                nline = true;
+            }
+        }
+    }
+
+    aFile << "] }\n";
+    aFile << " coordIndex [\n  ";
+
+    // indices to control formatting
+    int nv = 0;
+    n = index.size() & ~( (size_t) 1 );
+
+    for( size_t i = 0; i < n; i += 2 )
+    {
+        aFile << index[i] << "," << index[i + 1] << ",-1";
+
+        if( i + 2 < n )
+        {
+            aFile << ",";
+
+            if( ++nv == 8 )
+            {
+                nv = 0;
+                aFile << "\n  ";
+            }
+        }
+    }
+
+    aFile << "]\n}\n";
+
+    return true;
+}
+
+
+bool SGLINESET::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
+{
+    if( NULL == parentNode )
+    {
+        if( NULL == m_Parent )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [BUG] corrupt data; m_aParent is NULL";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+
+        SGNODE* np = m_Parent;
+
+        while( NULL != np->GetParent() )
+            np = np->GetParent();
+
+        if( np->WriteCache( aFile, NULL ) )
+        {
+            m_written = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    if( parentNode != m_Parent )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [BUG] corrupt data; parentNode != m_aParent";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    if( !aFile.good() )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [INFO] bad stream";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    S3D::WriteTag( aFile, this );
+    size_t npts = coords.size();
+    aFile.write( (char*)&npts, sizeof(size_t) );
+
+    for( size_t i = 0; i < npts; ++i )
+        S3D::WritePoint( aFile, coords[i] );
+
+    npts = index.size();
+    aFile.write( (char*)&npts, sizeof(size_t) );
+
+    if( npts > 0 )
+        aFile.write( (char*)&index[0], sizeof(int) * npts );
+
+    if( aFile.fail() )
+        return false;
+
+    m_written = true;
+    return true;
+}
+
+
+bool SGLINESET::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
+{
+    if( !coords.empty() || !index.empty() )
+    {
+        #ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [BUG] non-empty node";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+        #endif
+
+        return false;
+    }
+
+    size_t npts;
+    aFile.read( (char*)&npts, sizeof(size_t) );
+    SGPOINT tmp;
+
+    if( aFile.fail() )
+        return false;
+
+    for( size_t i = 0; i < npts; ++i )
+    {
+        if( !S3D::ReadPoint( aFile, tmp ) || aFile.fail() )
+            return false;
+
+        coords.push_back( tmp );
+    }
+
+    aFile.read( (char*)&npts, sizeof(size_t) );
+
+    if( aFile.fail() )
+        return false;
+
+    // a corrupt count must not force a huge allocation
+    std::streampos pos = aFile.tellg();
+    aFile.seekg( 0, std::ios_base::end );
+    std::streamoff remaining = aFile.tellg() - pos;
+    aFile.seekg( pos );
+
+    if( aFile.fail() || npts > (size_t)remaining / sizeof(int) )
+        return false;
+
+    if( npts > 0 )
+    {
+        index.resize( npts );
+        aFile.read( (char*)&index[0], sizeof(int) * npts );
+    }
+
+    if( aFile.fail() )
+        return false;
+
+    return true;
+}
+
+
+bool SGLINESET::validate( void )
+{
+    if( validated )
+        return valid;
+
+    validated = true;
+    valid = false;
+
+    if( coords.size() < 2 || index.size() < 2 || ( index.size() & 1 ) )
+    {
+#ifdef DEBUG
+        std::ostringstream ostr;
+        ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+        ostr << " * [INFO] bad model; no vertices or indices not in pairs";
+        wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+#endif
+        return false;
+    }
+
+    int nCoords = (int)coords.size();
+
+    for( size_t i = 0; i < index.size(); ++i )
+    {
+        if( index[i] < 0 || index[i] >= nCoords )
+        {
+#ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [INFO] bad model; vertex index out of bounds";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+#endif
+            return false;
+        }
+    }
+
+    valid = true;
+    return true;
+}
+
+
+bool SGLINESET::Prepare( const glm::dmat4* aTransform, int aMaterial,
+    std::vector< SLINES >& lines )
+{
+    // an empty or broken line set is not rendered; this is not an error
+    if( !validate() )
+        return true;
+
+    SLINES l;
+    S3D::INIT_SLINES( l );
+
+    size_t nv = coords.size();
+    size_t ni = index.size();
+    SFVEC3F* lCoords = new SFVEC3F[nv];
+
+    for( size_t i = 0; i < nv; ++i )
+    {
+        glm::dvec4 pt( coords[i].x, coords[i].y, coords[i].z, 1.0 );
+
+        if( aTransform )
+            pt = (*aTransform) * pt;
+
+        lCoords[i] = SFVEC3F( pt.x, pt.y, pt.z );
+    }
+
+    unsigned int* lidx = new unsigned int[ni];
+
+    for( size_t i = 0; i < ni; ++i )
+        lidx[i] = (unsigned int)index[i];
+
+    l.m_VertexSize = (unsigned int)nv;
+    l.m_Positions = lCoords;
+    l.m_LineIdxSize = (unsigned int)ni;
+    l.m_LineIdx = lidx;
+    l.m_MaterialIdx = aMaterial;
+    lines.push_back( l );
+
+    return true;
+}
@@ -0,0 +1,97 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2016 KiCad Developers, see change_log.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file sg_lineset.h
+ * defines an indexed line set (feature edges) for a scenegraph object
+ */
+
+#ifndef SG_LINESET_H
+#define SG_LINESET_H
+
+#include <vector>
+#include "3d_cache/sg/sg_node.h"
+
+/**
+ * Class SGLINESET
+ * holds a set of line segments such as the feature edges of a solid model.
+ * The vertices are held by the line set itself and the indices are given
+ * as pairs, each pair describing a single segment. A line set occupies
+ * the geometry slot of an SGSHAPE in place of an SGFACESET.
+ */
+class SGLINESET : public SGNODE
+{
+private:
+    bool valid;
+    bool validated;
+
+public:
+    std::vector< SGPOINT > coords;
+    std::vector< int > index;
+
+    void unlinkChildNode( const SGNODE* aNode );
+    void unlinkRefNode( const SGNODE* aNode );
+
+    // validate the data held by this line set
+    bool validate( void );
+
+public:
+    SGLINESET( SGNODE* aParent );
+    virtual ~SGLINESET();
+
+    virtual bool SetParent( SGNODE* aParent, bool notify = true );
+
+    SGNODE* FindNode(const char *aNodeName, const SGNODE *aCaller);
+    bool AddRefNode( SGNODE* aNode );
+    bool AddChildNode( SGNODE* aNode );
+
+    bool GetCoordsList( size_t& aListSize, SGPOINT*& aCoordsList );
+    void SetCoordsList( size_t aListSize, const SGPOINT* aCoordsList );
+    void AddCoord( const SGPOINT& aPoint );
+
+    bool GetIndices( size_t& nIndices, int*& aIndexList );
+    void SetIndices( size_t nIndices, int* aIndexList );
+    void AddSegment( int aIndex0, int aIndex1 );
+
+    void ReNameNodes( S3D::NAMECTX& aNames );
+    bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
+
+    bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
+    bool ReadCache( std::ifstream& aFile, SGNODE* parentNode );
+
+    bool Prepare( const glm::dmat4* aTransform, int aMaterial,
+        std::vector< SLINES >& lines );
+};
+
+/*
+    p.96
+    IndexedLineSet {
+        color               NULL
+        coord               NULL
+        colorIndex          []
+        colorPerVertex      TRUE
+        coordIndex          []
+    }
+*/
+
+#endif  // SG_LINESET_H
@@ -23,12 +23,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 #include <wx/log.h>
 
 #include "3d_cache/sg/sg_node.h"
+#include "3d_cache/sg/sg_arena.h"
 #include "plugins/3dapi/c3dmodel.h"
 
 static const std::string node_names[S3D::SGTYPE_END + 1] = {
@@ -41,11 +43,32 @@ static const std::string node_names[S3D::SGTYPE_END + 1] = {
     "COORDIDX",
     "NORM",
     "SHAPE",
+    "LINES",
     "INVALID"
 };
 
 
-static unsigned int node_counts[S3D::SGTYPE_END] = { 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+// each node is preceded by a pointer to the arena which holds it (NULL if the
+// node is on the heap); the header is padded to preserve the alignment of the node
+#define NODE_HEADER_SIZE (16)
+
+// the number of back pointers which are located by a plain scan; longer
+// lists are indexed by the holder so that removal remains O(1) when a
+// node is shared by many holders
+#define BACKREF_SCAN_MAX (8)
+
+// names assigned on demand and by S3D::RenameNodes() are drawn from
+// a per-thread context so that threads never share naming state
+static thread_local S3D::NAMECTX thread_names;
+
+// the innermost S3D::READCTX of the calling thread; NULL if no cache is being read
+static thread_local S3D::READCTX* read_ctx = NULL;
+
+
+static unsigned long long nodeKey( S3D::SGTYPES aType, unsigned int aID )
+{
+    return ( (unsigned long long) aType << 32 ) | aID;
+}
 
 
 char const* S3D::GetNodeTypeName( S3D::SGTYPES aType )
@@ -54,30 +77,60 @@ char const* S3D::GetNodeTypeName( S3D::SGTYPES aType )
 }
 
 
-static void getNodeName( S3D::SGTYPES nodeType, std::string& aName )
+S3D::NAMECTX::NAMECTX()
 {
-    if( nodeType < 0 || nodeType >= S3D::SGTYPE_END )
-    {
-        aName = node_names[S3D::SGTYPE_END];
-        return;
-    }
+    ResetNames( *this );
+    return;
+}
 
-    unsigned int seqNum = node_counts[nodeType];
-    ++node_counts[nodeType];
 
-    std::ostringstream ostr;
-    ostr << node_names[nodeType] << "_" << seqNum;
-    aName = ostr.str();
+void S3D::ResetNames( NAMECTX& aNames )
+{
+    for( int i = 0; i < (int)S3D::SGTYPE_END; ++i )
+        aNames.counts[i] = 1;
 
     return;
 }
 
 
+S3D::NAMECTX& S3D::GetThreadNames( void )
+{
+    return thread_names;
+}
+
+
+S3D::READCTX::READCTX()
+{
+    m_Prev = read_ctx;
+    read_ctx = this;
+}
+
+
+S3D::READCTX::~READCTX()
+{
+    read_ctx = m_Prev;
+}
+
+
+static unsigned int getNodeID( S3D::SGTYPES nodeType, S3D::NAMECTX& aNames )
+{
+    if( nodeType < 0 || nodeType >= S3D::SGTYPE_END )
+        return 0;
+
+    return aNames.counts[nodeType]++;
+}
+
+
 SGNODE::SGNODE( SGNODE* aParent )
 {
     m_Parent = aParent;
     m_Association = NULL;
+    m_ID = 0;
+    m_Name = NULL;
     m_written = false;
+    m_detached = false;
+    m_dirty = true;
+    m_bounded = false;
     m_SGtype = S3D::SGTYPE_END;
 
     return;
@@ -86,14 +139,21 @@ SGNODE::SGNODE( SGNODE* aParent )
 
 SGNODE::~SGNODE()
 {
-    if( m_Parent )
-        m_Parent->unlinkChildNode( this );
-
     if( m_Association )
         *m_Association = NULL;
 
-    std::list< SGNODE* >::iterator sBP = m_BackPointers.begin();
-    std::list< SGNODE* >::iterator eBP = m_BackPointers.end();
+    delete [] m_Name;
+
+    // a node released by DestroyTree() has already been unlinked
+    // from every node which is not destroyed along with it
+    if( m_detached )
+        return;
+
+    if( m_Parent )
+        m_Parent->unlinkChildNode( this );
+
+    std::vector< SGNODE* >::iterator sBP = m_BackPointers.begin();
+    std::vector< SGNODE* >::iterator eBP = m_BackPointers.end();
 
     while( sBP != eBP )
     {
@@ -105,6 +165,126 @@ SGNODE::~SGNODE()
 }
 
 
+void SGNODE::DestroyTree( SGNODE* aNode )
+{
+    if( NULL == aNode )
+        return;
+
+    // collect and flag every node of the tree
+    std::vector< SGNODE* > nodes( 1, aNode );
+    std::vector< SGNODE* > refs;
+    size_t i;
+
+    for( i = 0; i < nodes.size(); ++i )
+    {
+        nodes[i]->m_detached = true;
+        nodes[i]->getLinkedNodes( nodes, refs );
+        refs.clear();
+    }
+
+    // release the links to nodes outside of the tree; links within
+    // the tree vanish with the nodes themselves
+    std::vector< SGNODE* > children;
+    std::vector< SGNODE* >::iterator sL;
+    std::vector< SGNODE* >::iterator eL;
+
+    for( i = 0; i < nodes.size(); ++i )
+    {
+        SGNODE* np = nodes[i];
+
+        children.clear();
+        refs.clear();
+        np->getLinkedNodes( children, refs );
+
+        for( sL = refs.begin(), eL = refs.end(); sL != eL; ++sL )
+        {
+            if( !(*sL)->m_detached )
+                (*sL)->delNodeRef( np );
+        }
+
+        for( sL = np->m_BackPointers.begin(), eL = np->m_BackPointers.end(); sL != eL; ++sL )
+        {
+            if( !(*sL)->m_detached )
+                (*sL)->unlinkRefNode( np );
+        }
+    }
+
+    if( NULL != aNode->m_Parent )
+        aNode->m_Parent->unlinkChildNode( aNode );
+
+    delete aNode;
+
+    return;
+}
+
+
+bool SGNODE::ReplaceNode( SGNODE* aNode, SGNODE* aReplacement )
+{
+    if( NULL == aNode || NULL == aReplacement || aNode == aReplacement
+        || aNode->m_SGtype != aReplacement->m_SGtype )
+        return false;
+
+    // the destructor unlinks the node from all of its holders
+    std::vector< SGNODE* > holders( aNode->m_BackPointers );
+
+    if( NULL != aNode->m_Parent )
+        holders.push_back( aNode->m_Parent );
+
+    delete aNode;
+
+    std::vector< SGNODE* >::iterator sL = holders.begin();
+    std::vector< SGNODE* >::iterator eL = holders.end();
+
+    while( sL != eL )
+    {
+        (*sL)->AddRefNode( aReplacement );
+        ++sL;
+    }
+
+    return true;
+}
+
+
+void SGNODE::getLinkedNodes( std::vector< SGNODE* >& aChildren,
+    std::vector< SGNODE* >& aRefs ) const
+{
+    return;
+}
+
+
+void* SGNODE::operator new( size_t aSize )
+{
+    SG_ARENA* arena = SG_ARENA::GetActive();
+    char* mem;
+
+    if( NULL != arena )
+        mem = (char*) arena->Allocate( aSize + NODE_HEADER_SIZE );
+    else
+        mem = (char*) ::operator new( aSize + NODE_HEADER_SIZE );
+
+    *(SG_ARENA**) mem = arena;
+
+    return mem + NODE_HEADER_SIZE;
+}
+
+
+void SGNODE::operator delete( void* aPtr )
+{
+    if( NULL == aPtr )
+        return;
+
+    char* mem = (char*) aPtr - NODE_HEADER_SIZE;
+    SG_ARENA* arena = *(SG_ARENA**) mem;
+
+    if( NULL != arena )
+        arena->Release();
+    else
+        ::operator delete( mem );
+
+    return;
+}
+
+
 S3D::SGTYPES SGNODE::GetNodeType( void ) const
 {
     return m_SGtype;
@@ -140,6 +320,7 @@ bool SGNODE::SwapParent( SGNODE* aNewParent )
     m_Parent->unlinkChildNode( this );
     m_Parent = NULL;
     aNewParent->unlinkRefNode( this );
+    delNodeRef( aNewParent );
     aNewParent->AddChildNode( this );
     oldParent->AddRefNode( this );
 
@@ -149,24 +330,144 @@ bool SGNODE::SwapParent( SGNODE* aNewParent )
 
 const char* SGNODE::GetName( void )
 {
-    if( m_Name.empty() )
-        getNodeName( m_SGtype, m_Name );
+    if( NULL != m_Name )
+        return m_Name;
+
+    std::string name;
 
-    return m_Name.c_str();
+    if( m_SGtype < 0 || m_SGtype >= S3D::SGTYPE_END )
+    {
+        name = node_names[S3D::SGTYPE_END];
+    }
+    else
+    {
+        std::ostringstream ostr;
+        ostr << node_names[m_SGtype] << "_" << GetID();
+        name = ostr.str();
+    }
+
+    m_Name = new char[name.size() + 1];
+    strcpy( m_Name, name.c_str() );
+
+    return m_Name;
 }
 
 
 void SGNODE::SetName( const char *aName )
 {
+    delete [] m_Name;
+    m_Name = NULL;
+
     if( NULL == aName || 0 == aName[0] )
-        getNodeName( m_SGtype, m_Name );
-    else
-        m_Name = aName;
+    {
+        m_ID = getNodeID( m_SGtype, thread_names );
+        return;
+    }
+
+    m_Name = new char[strlen( aName ) + 1];
+    strcpy( m_Name, aName );
+
+    return;
+}
+
 
+void SGNODE::SetName( S3D::NAMECTX& aNames )
+{
+    SetID( getNodeID( m_SGtype, aNames ) );
     return;
 }
 
 
+unsigned int SGNODE::GetID( void )
+{
+    if( 0 == m_ID )
+        m_ID = getNodeID( m_SGtype, thread_names );
+
+    return m_ID;
+}
+
+
+void SGNODE::SetID( unsigned int aID )
+{
+    delete [] m_Name;
+    m_Name = NULL;
+    m_ID = aID;
+
+    // the first node read with a given ID is the one referenced by the file
+    if( NULL != read_ctx )
+        read_ctx->nodes.insert( std::make_pair( nodeKey( m_SGtype, aID ), this ) );
+
+    return;
+}
+
+
+bool SGNODE::IsNamed( const char* aName ) const
+{
+    if( NULL == aName )
+        return false;
+
+    if( NULL != m_Name )
+        return !strcmp( m_Name, aName );
+
+    if( 0 == m_ID || m_SGtype < 0 || m_SGtype >= S3D::SGTYPE_END )
+        return false;
+
+    const std::string& prefix = node_names[m_SGtype];
+
+    if( strncmp( aName, prefix.c_str(), prefix.size() ) || '_' != aName[prefix.size()] )
+        return false;
+
+    char* ep = NULL;
+    unsigned long id = strtoul( aName + prefix.size() + 1, &ep, 10 );
+
+    return 0 == *ep && id == m_ID;
+}
+
+
+SGNODE* SGNODE::FindNodeID( S3D::SGTYPES aType, unsigned int aID, const SGNODE* aCaller )
+{
+    if( NULL != read_ctx )
+    {
+        std::unordered_map< unsigned long long, SGNODE* >::const_iterator it =
+            read_ctx->nodes.find( nodeKey( aType, aID ) );
+
+        if( it == read_ctx->nodes.end() )
+            return NULL;
+
+        return it->second;
+    }
+
+    if( aType == m_SGtype && aID == m_ID )
+        return this;
+
+    std::vector< SGNODE* > children;
+    std::vector< SGNODE* > refs;
+    getLinkedNodes( children, refs );
+
+    std::vector< SGNODE* >::iterator sL = children.begin();
+    std::vector< SGNODE* >::iterator eL = children.end();
+
+    while( sL != eL )
+    {
+        if( *sL != aCaller )
+        {
+            SGNODE* np = (*sL)->FindNodeID( aType, aID, this );
+
+            if( NULL != np )
+                return np;
+        }
+
+        ++sL;
+    }
+
+    // query the parent if appropriate
+    if( aCaller == m_Parent || NULL == m_Parent )
+        return NULL;
+
+    return m_Parent->FindNodeID( aType, aID, this );
+}
+
+
 const char * SGNODE::GetNodeTypeName( S3D::SGTYPES aNodeType ) const
 {
     return node_names[aNodeType].c_str();
@@ -178,13 +479,44 @@ void SGNODE::addNodeRef( SGNODE* aNode )
     if( NULL == aNode )
         return;
 
-    std::list< SGNODE* >::iterator np =
-        std::find( m_BackPointers.begin(), m_BackPointers.end(), aNode );
+    // the referring node guarantees that it holds at most one reference
+    // to this node (see ADD_NODE) so no search for duplicates is needed
+    m_BackPointers.push_back( aNode );
+
+    if( !m_BackIndex.empty() )
+    {
+        m_BackIndex[aNode] = m_BackPointers.size() - 1;
+    }
+    else if( m_BackPointers.size() > BACKREF_SCAN_MAX )
+    {
+        m_BackIndex.reserve( m_BackPointers.size() * 2 );
+
+        for( size_t i = 0; i < m_BackPointers.size(); ++i )
+            m_BackIndex[m_BackPointers[i]] = i;
+    }
 
-    if( np != m_BackPointers.end() )
+    return;
+}
+
+
+void SGNODE::setDirty( void )
+{
+    // a flagged node implies flagged holders since Prepare() clears
+    // the flags from the top down; likewise a node without bounds
+    // implies holders without bounds since bounds are computed from
+    // the bottom up
+    if( m_dirty && !m_bounded )
         return;
 
-    m_BackPointers.push_back( aNode );
+    m_dirty = true;
+    m_bounded = false;
+
+    if( NULL != m_Parent )
+        m_Parent->setDirty();
+
+    for( size_t i = 0; i < m_BackPointers.size(); ++i )
+        m_BackPointers[i]->setDirty();
+
     return;
 }
 
@@ -194,12 +526,42 @@ void SGNODE::delNodeRef( const SGNODE* aNode )
     if( NULL == aNode )
         return;
 
-    std::list< SGNODE* >::iterator np =
-        std::find( m_BackPointers.begin(), m_BackPointers.end(), aNode );
+    // the order of the list is not significant so the entry is
+    // replaced by the last one rather than erased
+    size_t idx = m_BackPointers.size();
+
+    if( !m_BackIndex.empty() )
+    {
+        std::unordered_map< const SGNODE*, size_t >::iterator it = m_BackIndex.find( aNode );
+
+        if( it != m_BackIndex.end() )
+        {
+            idx = it->second;
+            m_BackIndex.erase( it );
+        }
+    }
+    else
+    {
+        for( size_t i = 0; i < m_BackPointers.size(); ++i )
+        {
+            if( m_BackPointers[i] == aNode )
+            {
+                idx = i;
+                break;
+            }
+        }
+    }
 
-    if( np != m_BackPointers.end() )
+    if( idx < m_BackPointers.size() )
     {
-        m_BackPointers.erase( np );
+        m_BackPointers[idx] = m_BackPointers.back();
+        m_BackPointers.pop_back();
+
+        if( m_BackPointers.size() <= BACKREF_SCAN_MAX )
+            m_BackIndex.clear();
+        else if( idx < m_BackPointers.size() )
+            m_BackIndex[m_BackPointers[idx]] = idx;
+
         return;
     }
 
@@ -303,13 +665,19 @@ void SGNODE::DisassociateWrapper( SGNODE** aWrapperRef )
 
 void SGNODE::ResetNodeIndex( void )
 {
-    for( int i = 0; i < (int)S3D::SGTYPE_END; ++i )
-        node_counts[i] = 1;
-
+    S3D::ResetNames( thread_names );
     return;
 }
 
 
+S3D::MATLIST::MATLIST()
+{
+    root = NULL;
+    pass = 0;
+    keep = false;
+}
+
+
 bool S3D::GetMatIndex( MATLIST& aList, SGNODE* aNode, int& aIndex )
 {
     aIndex = 0;
@@ -370,6 +738,13 @@ void S3D::INIT_SMESH( SMESH& aMesh )
 }
 
 
+void S3D::INIT_SLINES( SLINES& aLines )
+{
+    memset( &aLines, 0, sizeof( aLines ) );
+    return;
+}
+
+
 void S3D::INIT_S3DMODEL( S3DMODEL& aModel )
 {
     memset( &aModel, 0, sizeof( aModel ) );
@@ -409,9 +784,117 @@ void S3D::FREE_SMESH( SMESH& aMesh)
         aMesh.m_FaceIdx = NULL;
     }
 
+    if( NULL != aMesh.m_FaceIdx16 )
+    {
+        delete [] aMesh.m_FaceIdx16;
+        aMesh.m_FaceIdx16 = NULL;
+    }
+
     aMesh.m_VertexSize = 0;
     aMesh.m_FaceIdxSize = 0;
     aMesh.m_MaterialIdx = 0;
+    aMesh.m_BBoxMin = SFVEC3F( 0.0f );
+    aMesh.m_BBoxMax = SFVEC3F( 0.0f );
+
+    return;
+}
+
+
+void S3D::FREE_SLINES( SLINES& aLines )
+{
+    if( NULL != aLines.m_Positions )
+    {
+        delete [] aLines.m_Positions;
+        aLines.m_Positions = NULL;
+    }
+
+    if( NULL != aLines.m_LineIdx )
+    {
+        delete [] aLines.m_LineIdx;
+        aLines.m_LineIdx = NULL;
+    }
+
+    aLines.m_VertexSize = 0;
+    aLines.m_LineIdxSize = 0;
+    aLines.m_MaterialIdx = 0;
+
+    return;
+}
+
+
+void S3D::COPY_SMESH( SMESH& aDest, const SMESH& aSource )
+{
+    aDest = aSource;
+    aDest.m_Positions = NULL;
+    aDest.m_Normals = NULL;
+    aDest.m_Texcoords = NULL;
+    aDest.m_Color = NULL;
+    aDest.m_FaceIdx = NULL;
+    aDest.m_FaceIdx16 = NULL;
+
+    size_t nv = aSource.m_VertexSize;
+
+    if( NULL != aSource.m_Positions )
+    {
+        aDest.m_Positions = new SFVEC3F[nv];
+        std::copy( aSource.m_Positions, aSource.m_Positions + nv, aDest.m_Positions );
+    }
+
+    if( NULL != aSource.m_Normals )
+    {
+        aDest.m_Normals = new SFVEC3F[nv];
+        std::copy( aSource.m_Normals, aSource.m_Normals + nv, aDest.m_Normals );
+    }
+
+    if( NULL != aSource.m_Texcoords )
+    {
+        aDest.m_Texcoords = new SFVEC2F[nv];
+        std::copy( aSource.m_Texcoords, aSource.m_Texcoords + nv, aDest.m_Texcoords );
+    }
+
+    if( NULL != aSource.m_Color )
+    {
+        aDest.m_Color = new SFVEC3F[nv];
+        std::copy( aSource.m_Color, aSource.m_Color + nv, aDest.m_Color );
+    }
+
+    if( NULL != aSource.m_FaceIdx )
+    {
+        aDest.m_FaceIdx = new unsigned int[aSource.m_FaceIdxSize];
+        std::copy( aSource.m_FaceIdx, aSource.m_FaceIdx + aSource.m_FaceIdxSize,
+                   aDest.m_FaceIdx );
+    }
+
+    if( NULL != aSource.m_FaceIdx16 )
+    {
+        aDest.m_FaceIdx16 = new unsigned short[aSource.m_FaceIdxSize];
+        std::copy( aSource.m_FaceIdx16, aSource.m_FaceIdx16 + aSource.m_FaceIdxSize,
+                   aDest.m_FaceIdx16 );
+    }
+
+    return;
+}
+
+
+void S3D::COPY_SLINES( SLINES& aDest, const SLINES& aSource )
+{
+    aDest = aSource;
+    aDest.m_Positions = NULL;
+    aDest.m_LineIdx = NULL;
+
+    if( NULL != aSource.m_Positions )
+    {
+        aDest.m_Positions = new SFVEC3F[aSource.m_VertexSize];
+        std::copy( aSource.m_Positions, aSource.m_Positions + aSource.m_VertexSize,
+                   aDest.m_Positions );
+    }
+
+    if( NULL != aSource.m_LineIdx )
+    {
+        aDest.m_LineIdx = new unsigned int[aSource.m_LineIdxSize];
+        std::copy( aSource.m_LineIdx, aSource.m_LineIdx + aSource.m_LineIdxSize,
+                   aDest.m_LineIdx );
+    }
 
     return;
 }
@@ -438,5 +921,18 @@ void S3D::FREE_S3DMODEL( S3DMODEL& aModel )
 
     aModel.m_MeshesSize = 0;
 
+    if( NULL != aModel.m_Lines )
+    {
+        for( unsigned int i = 0; i < aModel.m_LinesSize; ++i )
+            FREE_SLINES( aModel.m_Lines[i] );
+
+        delete [] aModel.m_Lines;
+        aModel.m_Lines = NULL;
+    }
+
+    aModel.m_LinesSize = 0;
+    aModel.m_BBoxMin = SFVEC3F( 0.0f );
+    aModel.m_BBoxMax = SFVEC3F( 0.0f );
+
     return;
 }
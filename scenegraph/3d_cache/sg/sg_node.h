@@ -32,9 +32,9 @@
 
 #include <fstream>
 #include <string>
-#include <list>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
 #include "plugins/3dapi/c3dmodel.h"
@@ -56,15 +56,61 @@ namespace S3D
     {
         std::vector< SGAPPEARANCE const* > matorder;    // materials in order of addition
         std::map< SGAPPEARANCE const*, int > matmap;    // mapping from material to index
+        SGNODE const* root; // the node which started the Prepare() run
+        unsigned int pass;  // sequence number of the run among those started from root
+        bool keep;          // true if shapes retain their prepared data
+
+        MATLIST();
     };
 
     bool GetMatIndex( MATLIST& aList, SGNODE* aNode, int& aIndex );
 
+    // sequence numbers used to assign unique names to the nodes of a
+    // scene; each export owns its own instance so that several scenes
+    // may be named and written concurrently
+    struct NAMECTX
+    {
+        unsigned int counts[SGTYPE_END];    // next sequence number per node type
+
+        NAMECTX();
+    };
+
+    void ResetNames( NAMECTX& aNames );
+
+    // nodes of the cache file which the calling thread is reading, keyed
+    // by type and ID; while an instance exists ReadCache() registers each
+    // node as its ID is assigned and FindNodeID() resolves references to
+    // earlier nodes by a single lookup instead of searching the tree
+    class READCTX
+    {
+    private:
+        READCTX( const READCTX& );
+        READCTX& operator=( const READCTX& );
+
+        READCTX* m_Prev;    // context which was active when this one was created
+
+    public:
+        std::unordered_map< unsigned long long, SGNODE* > nodes;
+
+        READCTX();
+        ~READCTX();
+    };
+
+    // naming context used by the calling thread when a node without a name
+    // is queried or when renaming is requested without an explicit context
+    NAMECTX& GetThreadNames( void );
+
     void INIT_SMATERIAL( SMATERIAL& aMaterial );
     void INIT_SMESH( SMESH& aMesh );
+    void INIT_SLINES( SLINES& aLines );
     void INIT_S3DMODEL( S3DMODEL& aModel );
 
     void FREE_SMESH( SMESH& aMesh);
+    void FREE_SLINES( SLINES& aLines );
+
+    // deep copies; any data previously held by the destination is not freed
+    void COPY_SMESH( SMESH& aDest, const SMESH& aSource );
+    void COPY_SLINES( SLINES& aDest, const SLINES& aSource );
     void FREE_S3DMODEL( S3DMODEL& aModel );
 };
 
@@ -79,11 +125,18 @@ private:
     SGNODE** m_Association;                 // handle to the instance held by a wrapper
 
 protected:
-    std::list< SGNODE* > m_BackPointers;    // nodes which hold a reference to this
+    std::vector< SGNODE* > m_BackPointers;  // nodes which hold a reference to this (unordered)
+    // slot of each holder within m_BackPointers; only maintained while the
+    // list is too long to be scanned (see BACKREF_SCAN_MAX in sg_node.cpp)
+    std::unordered_map< const SGNODE*, size_t > m_BackIndex;
     SGNODE* m_Parent;       // pointer to parent node; may be NULL for top level transform
     S3D::SGTYPES m_SGtype;  // type of SG node
-    std::string m_Name;     // name to use for referencing the entity by name
+    unsigned int m_ID;      // sequence number of the node within its type; 0 if not yet assigned
+    char* m_Name;           // user assigned name or the name built by GetName(); may be NULL
     bool m_written;         // set true when the object has been written after a ReNameNodes()
+    bool m_detached;        // set by DestroyTree() once all external links have been released
+    bool m_dirty;           // set when the node or its data changed since the last Prepare()
+    bool m_bounded;         // set while a holder keeps bounds derived from this node
 
 public:
     /**
@@ -116,12 +169,25 @@ public:
 
     /**
      * Function delNodeRef
-     * removes a pointer to a node which references, but does not own, this node.
+     * removes a pointer to a node which references, but does not own, this node;
+     * the entry is located in constant time and replaced by the last entry.
      *
      * @param aNode is the node holding a reference to this object
      */
     void delNodeRef( const SGNODE* aNode );
 
+    /**
+     * Function getLinkedNodes
+     * appends the owned child nodes and the referenced nodes of this
+     * node to the given lists; nodes which cannot hold children or
+     * references add nothing.
+     *
+     * @param aChildren receives the owned child nodes
+     * @param aRefs receives the referenced nodes
+     */
+    virtual void getLinkedNodes( std::vector< SGNODE* >& aChildren,
+        std::vector< SGNODE* >& aRefs ) const;
+
     /**
      * Function IsWritten
      * returns true if the object had already been written to a
@@ -132,10 +198,85 @@ public:
         return m_written;
     }
 
+    /**
+     * Function isReferenced
+     * returns true if any other node holds a reference to this object;
+     * for internal use only.
+     */
+    bool isReferenced( void ) const
+    {
+        return !m_BackPointers.empty();
+    }
+
+    /**
+     * Function setDirty
+     * flags the node as modified since the last Prepare() and passes the
+     * flag on to the parent and to every node which references this node
+     * so that the prepared data and the bounds of all affected nodes are
+     * rebuilt. The propagation stops at nodes which are already flagged
+     * and hold no bounds; for internal use only.
+     */
+    void setDirty( void );
+
+    bool isDirty( void ) const
+    {
+        return m_dirty;
+    }
+
+    void clearDirty( void )
+    {
+        m_dirty = false;
+    }
+
+    /**
+     * Function setBounded
+     * records that bounds computed from the data of this node are held by
+     * this node or by one of its holders; the next setDirty() releases them.
+     */
+    void setBounded( void )
+    {
+        m_bounded = true;
+    }
+
+    bool isBounded( void ) const
+    {
+        return m_bounded;
+    }
+
 public:
     SGNODE( SGNODE* aParent );
     virtual ~SGNODE();
 
+    /**
+     * Function DestroyTree
+     * deletes the given node and all of its descendants. Links to nodes
+     * outside the tree are released first so that the destructors do not
+     * need to unlink the nodes of the tree from each other one by one;
+     * the cost of the teardown is thus linear in the size of the tree.
+     *
+     * @param aNode is the node to be destroyed
+     */
+    static void DestroyTree( SGNODE* aNode );
+
+    /**
+     * Function ReplaceNode
+     * deletes aNode after linking its parent and every node which
+     * references it to aReplacement instead; aReplacement is added to
+     * those nodes as a reference so its own ownership is unchanged.
+     * Both nodes must be of the same type and aNode must have no children.
+     *
+     * @return false if the nodes are not of the same type
+     */
+    static bool ReplaceNode( SGNODE* aNode, SGNODE* aReplacement );
+
+    /**
+     * Functions operator new, operator delete
+     * place the node within the arena which is active on the calling
+     * thread (see S3D::BeginArena()) or on the heap if there is none.
+     */
+    static void* operator new( size_t aSize );
+    static void operator delete( void* aPtr );
+
     /**
      * Function GetNodeType
      * returns the type of this node instance
@@ -171,9 +312,43 @@ public:
      */
     bool SwapParent( SGNODE* aNewParent );
 
+    /**
+     * Function GetName
+     * returns the name of the node; unless a name had been assigned via
+     * SetName() the name is built from the node type and ID on first use
+     */
     const char* GetName( void );
     void SetName(const char *aName);
 
+    /**
+     * Function SetName
+     * assigns the next unique ID of the given naming context to the node
+     * and discards any previous name
+     */
+    void SetName( S3D::NAMECTX& aNames );
+
+    /**
+     * Function GetID
+     * returns the ID of the node which, together with the node type,
+     * identifies the node within a cache file; an ID is assigned from
+     * the naming context of the calling thread if necessary
+     */
+    unsigned int GetID( void );
+
+    /**
+     * Function SetID
+     * assigns an ID (for example one read from a cache file) to the
+     * node and discards any previous name
+     */
+    void SetID( unsigned int aID );
+
+    /**
+     * Function IsNamed
+     * returns true if the given name is the name of the node; the
+     * name is not built in order to perform the comparison
+     */
+    bool IsNamed( const char* aName ) const;
+
     const char * GetNodeTypeName( S3D::SGTYPES aNodeType ) const;
 
     /**
@@ -187,6 +362,19 @@ public:
      */
     virtual SGNODE* FindNode( const char *aNodeName, const SGNODE *aCaller ) = 0;
 
+    /**
+     * Function FindNodeID
+     * searches the tree of linked nodes in the same manner as FindNode()
+     * and returns the first node of the given type and ID; while the
+     * calling thread holds an S3D::READCTX only that context is queried
+     *
+     * @param aType is the type of the node to search for
+     * @param aID is the ID of the node to search for
+     * @param aCaller is a pointer to the node invoking this function
+     * @return is a valid node pointer on success, otherwise NULL
+     */
+    SGNODE* FindNodeID( S3D::SGTYPES aType, unsigned int aID, const SGNODE* aCaller );
+
     virtual bool AddRefNode( SGNODE* aNode ) = 0;
 
     virtual bool AddChildNode( SGNODE* aNode ) = 0;
@@ -210,8 +398,8 @@ public:
 
     /**
      * Function ResetNodeIndex
-     * resets the global SG* node indices in preparation for
-     * Write() operations
+     * resets the SG* node indices of the calling thread in
+     * preparation for Write() operations
      */
     void ResetNodeIndex( void );
 
@@ -219,8 +407,10 @@ public:
      * Function ReNameNodes
      * renames a node and all its child nodes in preparation for
      * Write() operations
+     *
+     * @param aNames supplies the sequence numbers for the new names
      */
-    virtual void ReNameNodes( void ) = 0;
+    virtual void ReNameNodes( S3D::NAMECTX& aNames ) = 0;
 
     /**
      * Function WriteVRML
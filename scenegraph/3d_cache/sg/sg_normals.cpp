@@ -32,6 +32,7 @@
 SGNORMALS::SGNORMALS( SGNODE* aParent ) : SGNODE( aParent )
 {
     m_SGtype = S3D::SGTYPE_NORMALS;
+    singlePrecision = false;
 
     if( NULL != aParent && S3D::SGTYPE_FACESET != aParent->GetNodeType() )
     {
@@ -57,6 +58,7 @@ SGNORMALS::SGNORMALS( SGNODE* aParent ) : SGNODE( aParent )
 SGNORMALS::~SGNORMALS()
 {
     norms.clear();
+    fnorms.clear();
     return;
 }
 
@@ -96,7 +98,7 @@ SGNODE* SGNORMALS::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     return NULL;
@@ -164,21 +166,26 @@ bool SGNORMALS::GetNormalList( size_t& aListSize, SGVECTOR*& aNormalList )
         return false;
     }
 
+    setDirty();
+
+    // the caller may modify the data so it must not be shared
     aListSize = norms.size();
-    aNormalList = &norms[0];
+    aNormalList = &norms.Edit()[0];
     return true;
 }
 
 
 void SGNORMALS::SetNormalList( size_t aListSize, const SGVECTOR* aNormalList )
 {
+    setDirty();
     norms.clear();
+    fnorms.clear();
+    singlePrecision = false;
 
     if( 0 == aListSize || NULL == aNormalList )
         return;
 
-    for( int i = 0; i < (int)aListSize; ++i )
-        norms.push_back( aNormalList[i] );
+    norms.Edit().assign( aNormalList, aNormalList + aListSize );
 
     return;
 }
@@ -186,31 +193,138 @@ void SGNORMALS::SetNormalList( size_t aListSize, const SGVECTOR* aNormalList )
 
 void SGNORMALS::AddNormal( double aXValue, double aYValue, double aZValue )
 {
-    norms.push_back( SGVECTOR( aXValue, aYValue, aZValue ) );
+    AddNormal( SGVECTOR( aXValue, aYValue, aZValue ) );
     return;
 }
 
 
 void SGNORMALS::AddNormal( const SGVECTOR& aNormal )
 {
-    norms.push_back( aNormal );
+    setDirty();
+
+    if( singlePrecision )
+    {
+        double x, y, z;
+        aNormal.GetVector( x, y, z );
+        fnorms.Edit().push_back( SFVEC3F( x, y, z ) );
+    }
+    else
+    {
+        norms.Edit().push_back( aNormal );
+    }
+
+    return;
+}
+
+
+bool SGNORMALS::GetNormalList( size_t& aListSize, SFVEC3F*& aNormalList )
+{
+    if( fnorms.empty() )
+    {
+        aListSize = 0;
+        aNormalList = NULL;
+        return false;
+    }
+
+    setDirty();
+
+    // the caller may modify the data so it must not be shared
+    aListSize = fnorms.size();
+    aNormalList = &fnorms.Edit()[0];
+    return true;
+}
+
+
+void SGNORMALS::SetNormalList( size_t aListSize, const SFVEC3F* aNormalList )
+{
+    setDirty();
+    norms.clear();
+    fnorms.clear();
+    singlePrecision = true;
+
+    if( 0 == aListSize || NULL == aNormalList )
+        return;
+
+    fnorms.Edit().assign( aNormalList, aNormalList + aListSize );
+
+    return;
+}
+
+
+void SGNORMALS::TakeNormalList( std::vector< SGVECTOR >& aNormalList )
+{
+    setDirty();
+    fnorms.clear();
+    singlePrecision = false;
+    norms.Take( aNormalList );
+
+    return;
+}
+
+
+void SGNORMALS::ShareNormalList( const SGNORMALS* aSource )
+{
+    if( NULL == aSource || this == aSource )
+        return;
+
+    setDirty();
+    singlePrecision = aSource->singlePrecision;
+    norms.Share( aSource->norms );
+    fnorms.Share( aSource->fnorms );
+
+    return;
+}
+
+
+void SGNORMALS::SetSinglePrecision( bool aSinglePrecision )
+{
+    if( aSinglePrecision == singlePrecision )
+        return;
+
+    setDirty();
+    singlePrecision = aSinglePrecision;
+    double x, y, z;
+
+    if( singlePrecision )
+    {
+        std::vector< SFVEC3F > tmp( norms.size() );
+
+        for( size_t i = 0; i < norms.size(); ++i )
+        {
+            norms[i].GetVector( x, y, z );
+            tmp[i] = SFVEC3F( x, y, z );
+        }
+
+        fnorms.Take( tmp );
+        norms.clear();
+    }
+    else
+    {
+        std::vector< SGVECTOR > tmp( fnorms.size() );
+
+        for( size_t i = 0; i < fnorms.size(); ++i )
+            tmp[i] = SGVECTOR( fnorms[i].x, fnorms[i].y, fnorms[i].z );
+
+        norms.Take( tmp );
+        fnorms.clear();
+    }
+
     return;
 }
 
 
-void SGNORMALS::ReNameNodes( void )
+void SGNORMALS::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 }
 
 
 bool SGNORMALS::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
 {
-    if( norms.empty() )
+    if( 0 == GetSize() )
         return false;
 
     if( aReuseFlag )
@@ -232,12 +346,16 @@ bool SGNORMALS::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
     }
 
     std::string tmp;
-    size_t n = norms.size();
+    size_t n = GetSize();
     bool nline = false;
 
     for( size_t i = 0; i < n; )
     {
-        S3D::FormatVector( tmp, norms[i] );
+        if( singlePrecision )
+            S3D::FormatVector( tmp, SGVECTOR( fnorms[i].x, fnorms[i].y, fnorms[i].z ) );
+        else
+            S3D::FormatVector( tmp, norms[i] );
+
         aFile << tmp ;
         ++i;
 
@@ -318,12 +436,17 @@ bool SGNORMALS::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    aFile << "[" << GetName() << "]";
-    size_t npts = norms.size();
+    S3D::WriteTag( aFile, this );
+    size_t npts = GetSize();
     aFile.write( (char*)&npts, sizeof(size_t) );
 
     for( size_t i = 0; i < npts; ++i )
-        S3D::WriteVector( aFile, norms[i] );
+    {
+        if( singlePrecision )
+            S3D::WriteVector( aFile, SGVECTOR( fnorms[i].x, fnorms[i].y, fnorms[i].z ) );
+        else
+            S3D::WriteVector( aFile, norms[i] );
+    }
 
     if( aFile.fail() )
         return false;
@@ -335,7 +458,7 @@ bool SGNORMALS::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
 
 bool SGNORMALS::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 {
-    if( !norms.empty() )
+    if( 0 != GetSize() )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
@@ -354,12 +477,14 @@ bool SGNORMALS::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
     if( aFile.fail() )
         return false;
 
+    std::vector< SGVECTOR >& data = norms.Edit();
+
     for( size_t i = 0; i < npts; ++i )
     {
         if( !S3D::ReadVector( aFile, tmp ) || aFile.fail() )
             return false;
 
-        norms.push_back( tmp );
+        data.push_back( tmp );
     }
 
     return true;
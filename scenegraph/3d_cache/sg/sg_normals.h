@@ -31,11 +31,16 @@
 
 #include <vector>
 #include "3d_cache/sg/sg_node.h"
+#include "3d_cache/sg/sg_buffer.h"
 
 class SGNORMALS : public SGNODE
 {
+private:
+    bool singlePrecision;   // true if the normals are held in 'fnorms'
+
 public:
-    std::vector< SGVECTOR > norms;
+    SGBUFFER< SGVECTOR > norms;     // double precision normals
+    SGBUFFER< SFVEC3F > fnorms;     // single precision normals
 
     void unlinkChildNode( const SGNODE* aNode );
     void unlinkRefNode( const SGNODE* aNode );
@@ -55,7 +60,48 @@ public:
     void AddNormal( double aXValue, double aYValue, double aZValue );
     void AddNormal( const SGVECTOR& aNormal );
 
-    void ReNameNodes( void );
+    /**
+     * Function SetNormalList
+     * sets single precision normals; unlike SGVECTOR the values are not
+     * normalized so the caller must supply unit vectors
+     */
+    bool GetNormalList( size_t& aListSize, SFVEC3F*& aNormalList );
+    void SetNormalList( size_t aListSize, const SFVEC3F* aNormalList );
+
+    /**
+     * Function TakeNormalList
+     * takes ownership of the data in the given list without copying it;
+     * aNormalList is left empty.
+     */
+    void TakeNormalList( std::vector< SGVECTOR >& aNormalList );
+
+    /**
+     * Function ShareNormalList
+     * makes this node refer to the normal data held by aSource; no data
+     * is copied and both nodes remain free to modify their data later.
+     */
+    void ShareNormalList( const SGNORMALS* aSource );
+
+    /**
+     * Function SetSinglePrecision
+     * selects single or double precision storage for the normals; any
+     * existing normals are converted. Only the accessors which match
+     * the current storage return data.
+     */
+    void SetSinglePrecision( bool aSinglePrecision );
+
+    bool IsSinglePrecision( void ) const
+    {
+        return singlePrecision;
+    }
+
+    // returns the number of normals regardless of the storage precision
+    size_t GetSize( void ) const
+    {
+        return singlePrecision ? fnorms.size() : norms.size();
+    }
+
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
@@ -22,6 +22,7 @@
  */
 
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -29,12 +30,14 @@
 
 #include "3d_cache/sg/sg_shape.h"
 #include "3d_cache/sg/sg_faceset.h"
+#include "3d_cache/sg/sg_lineset.h"
 #include "3d_cache/sg/sg_appearance.h"
 #include "3d_cache/sg/sg_helpers.h"
 #include "3d_cache/sg/sg_coordindex.h"
 #include "3d_cache/sg/sg_coords.h"
 #include "3d_cache/sg/sg_colors.h"
 #include "3d_cache/sg/sg_normals.h"
+#include "3d_cache/sg/scenegraph.h"
 
 
 SGSHAPE::SGSHAPE( SGNODE* aParent ) : SGNODE( aParent )
@@ -44,6 +47,11 @@ SGSHAPE::SGSHAPE( SGNODE* aParent ) : SGNODE( aParent )
     m_RAppearance = NULL;
     m_FaceSet = NULL;
     m_RFaceSet = NULL;
+    m_LineSet = NULL;
+    m_RLineSet = NULL;
+    m_PrepareRoot = NULL;
+    m_PreparePass = 0;
+    m_HasBounds = false;
 
     if( NULL != aParent && S3D::SGTYPE_TRANSFORM != aParent->GetNodeType() )
     {
@@ -68,19 +76,34 @@ SGSHAPE::SGSHAPE( SGNODE* aParent ) : SGNODE( aParent )
 
 SGSHAPE::~SGSHAPE()
 {
-    // drop references
+    ReleasePrepared();
+
+    // drop references; a node released by DestroyTree()
+    // no longer needs to unlink itself from its references
     if( m_RAppearance )
     {
-        m_RAppearance->delNodeRef( this );
+        if( !m_detached )
+            m_RAppearance->delNodeRef( this );
+
         m_RAppearance = NULL;
     }
 
     if( m_RFaceSet )
     {
-        m_RFaceSet->delNodeRef( this );
+        if( !m_detached )
+            m_RFaceSet->delNodeRef( this );
+
         m_RFaceSet = NULL;
     }
 
+    if( m_RLineSet )
+    {
+        if( !m_detached )
+            m_RLineSet->delNodeRef( this );
+
+        m_RLineSet = NULL;
+    }
+
     // delete objects
     if( m_Appearance )
     {
@@ -96,6 +119,13 @@ SGSHAPE::~SGSHAPE()
         m_FaceSet = NULL;
     }
 
+    if( m_LineSet )
+    {
+        m_LineSet->SetParent( NULL, false );
+        delete m_LineSet;
+        m_LineSet = NULL;
+    }
+
     return;
 }
 
@@ -135,7 +165,7 @@ SGNODE* SGSHAPE::FindNode(const char *aNodeName, const SGNODE *aCaller)
     if( NULL == aNodeName || 0 == aNodeName[0] )
         return NULL;
 
-    if( !m_Name.compare( aNodeName ) )
+    if( IsNamed( aNodeName ) )
         return this;
 
     SGNODE* tmp = NULL;
@@ -160,6 +190,16 @@ SGNODE* SGSHAPE::FindNode(const char *aNodeName, const SGNODE *aCaller)
         }
     }
 
+    if( NULL != m_LineSet )
+    {
+        tmp = m_LineSet->FindNode( aNodeName, this );
+
+        if( tmp )
+        {
+            return tmp;
+        }
+    }
+
     // query the parent if appropriate
     if( aCaller == m_Parent || NULL == m_Parent )
         return NULL;
@@ -173,6 +213,8 @@ void SGSHAPE::unlinkNode( const SGNODE* aNode, bool isChild )
     if( NULL == aNode )
         return;
 
+    setDirty();
+
     if( isChild )
     {
         if( aNode == m_Appearance )
@@ -186,22 +228,32 @@ void SGSHAPE::unlinkNode( const SGNODE* aNode, bool isChild )
             m_FaceSet = NULL;
             return;
         }
+
+        if( aNode == m_LineSet )
+        {
+            m_LineSet = NULL;
+            return;
+        }
     }
     else
     {
         if( aNode == m_RAppearance )
         {
-            delNodeRef( this );
             m_RAppearance = NULL;
             return;
         }
 
         if( aNode == m_RFaceSet )
         {
-            delNodeRef( this );
             m_RFaceSet = NULL;
             return;
         }
+
+        if( aNode == m_RLineSet )
+        {
+            m_RLineSet = NULL;
+            return;
+        }
     }
 
     #ifdef DEBUG
@@ -231,6 +283,31 @@ void SGSHAPE::unlinkRefNode( const SGNODE* aNode )
 }
 
 
+void SGSHAPE::getLinkedNodes( std::vector< SGNODE* >& aChildren,
+    std::vector< SGNODE* >& aRefs ) const
+{
+    if( m_Appearance )
+        aChildren.push_back( m_Appearance );
+
+    if( m_FaceSet )
+        aChildren.push_back( m_FaceSet );
+
+    if( m_LineSet )
+        aChildren.push_back( m_LineSet );
+
+    if( m_RAppearance )
+        aRefs.push_back( m_RAppearance );
+
+    if( m_RFaceSet )
+        aRefs.push_back( m_RFaceSet );
+
+    if( m_RLineSet )
+        aRefs.push_back( m_RLineSet );
+
+    return;
+}
+
+
 bool SGSHAPE::addNode( SGNODE* aNode, bool isChild )
 {
     if( NULL == aNode )
@@ -280,6 +357,18 @@ bool SGSHAPE::addNode( SGNODE* aNode, bool isChild )
 
     if( S3D::SGTYPE_FACESET == aNode->GetNodeType() )
     {
+        if( m_LineSet || m_RLineSet )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [BUG] assigning a FaceSet to a Shape holding a LineSet";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+
         if( m_FaceSet || m_RFaceSet )
         {
             if( aNode != m_FaceSet && aNode != m_RFaceSet )
@@ -308,6 +397,55 @@ bool SGSHAPE::addNode( SGNODE* aNode, bool isChild )
             m_RFaceSet->addNodeRef( this );
         }
 
+        setDirty();
+        return true;
+    }
+
+    // a VRML Shape has a single geometry node so a LineSet
+    // is mutually exclusive with a FaceSet
+    if( S3D::SGTYPE_LINESET == aNode->GetNodeType() )
+    {
+        if( m_FaceSet || m_RFaceSet )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [BUG] assigning a LineSet to a Shape holding a FaceSet";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+
+        if( m_LineSet || m_RLineSet )
+        {
+            if( aNode != m_LineSet && aNode != m_RLineSet )
+            {
+                #ifdef DEBUG
+                std::ostringstream ostr;
+                ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+                ostr << " * [BUG] assigning multiple LineSet nodes";
+                wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+                #endif
+
+                return false;
+            }
+
+            return true;
+        }
+
+        if( isChild )
+        {
+            m_LineSet = (SGLINESET*)aNode;
+            m_LineSet->SetParent( this );
+        }
+        else
+        {
+            m_RLineSet = (SGLINESET*)aNode;
+            m_RLineSet->addNodeRef( this );
+        }
+
+        setDirty();
         return true;
     }
 
@@ -337,21 +475,24 @@ bool SGSHAPE::AddChildNode( SGNODE* aNode )
 }
 
 
-void SGSHAPE::ReNameNodes( void )
+void SGSHAPE::ReNameNodes( S3D::NAMECTX& aNames )
 {
     m_written = false;
 
     // rename this node
-    m_Name.clear();
-    GetName();
+    SetName( aNames );
 
     // rename Appearance
     if( m_Appearance )
-        m_Appearance->ReNameNodes();
+        m_Appearance->ReNameNodes( aNames );
 
     // rename FaceSet
     if( m_FaceSet )
-        m_FaceSet->ReNameNodes();
+        m_FaceSet->ReNameNodes( aNames );
+
+    // rename LineSet
+    if( m_LineSet )
+        m_LineSet->ReNameNodes( aNames );
 
     return;
 }
@@ -360,7 +501,8 @@ void SGSHAPE::ReNameNodes( void )
 bool SGSHAPE::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
 {
     if( !m_Appearance && !m_RAppearance
-        && !m_FaceSet && !m_RFaceSet )
+        && !m_FaceSet && !m_RFaceSet
+        && !m_LineSet && !m_RLineSet )
     {
         return false;
     }
@@ -395,6 +537,12 @@ bool SGSHAPE::WriteVRML( std::ofstream& aFile, bool aReuseFlag )
     if( m_RFaceSet )
         m_RFaceSet->WriteVRML( aFile, aReuseFlag );
 
+    if( m_LineSet )
+        m_LineSet->WriteVRML( aFile, aReuseFlag );
+
+    if( m_RLineSet )
+        m_RLineSet->WriteVRML( aFile, aReuseFlag );
+
     aFile << "}\n";
 
     return true;
@@ -462,8 +610,11 @@ bool SGSHAPE::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     if( NULL != m_RFaceSet && !m_RFaceSet->isWritten() )
         m_RFaceSet->SwapParent( this );
 
-    aFile << "[" << GetName() << "]";
-    #define NITEMS 4
+    if( NULL != m_RLineSet && !m_RLineSet->isWritten() )
+        m_RLineSet->SwapParent( this );
+
+    S3D::WriteTag( aFile, this );
+    #define NITEMS 6
     bool items[NITEMS];
     int i;
 
@@ -486,6 +637,14 @@ bool SGSHAPE::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
     if( NULL != m_RFaceSet )
         items[i] = true;
 
+    ++i;
+    if( NULL != m_LineSet )
+        items[i] = true;
+
+    ++i;
+    if( NULL != m_RLineSet )
+        items[i] = true;
+
     for( int i = 0; i < NITEMS; ++i )
         aFile.write( (char*)&items[i], sizeof(bool) );
 
@@ -493,13 +652,19 @@ bool SGSHAPE::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
         m_Appearance->WriteCache( aFile, this );
 
     if( items[1] )
-        aFile << "[" << m_RAppearance->GetName() << "]";
+        S3D::WriteTag( aFile, m_RAppearance );
 
     if( items[2] )
         m_FaceSet->WriteCache( aFile, this );
 
     if( items[3] )
-        aFile << "[" << m_RFaceSet->GetName() << "]";
+        S3D::WriteTag( aFile, m_RFaceSet );
+
+    if( items[4] )
+        m_LineSet->WriteCache( aFile, this );
+
+    if( items[5] )
+        S3D::WriteTag( aFile, m_RLineSet );
 
     if( aFile.fail() )
         return false;
@@ -511,7 +676,8 @@ bool SGSHAPE::WriteCache( std::ofstream& aFile, SGNODE* parentNode )
 
 bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 {
-    if( m_Appearance || m_RAppearance || m_FaceSet || m_RFaceSet )
+    if( m_Appearance || m_RAppearance || m_FaceSet || m_RFaceSet
+        || m_LineSet || m_RLineSet )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
@@ -523,13 +689,14 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    #define NITEMS 4
+    #define NITEMS 6
     bool items[NITEMS];
 
     for( int i = 0; i < NITEMS; ++i )
         aFile.read( (char*)&items[i], sizeof(bool) );
 
-    if( ( items[0] && items[1] ) || ( items[2] && items[3] ) )
+    if( ( items[0] && items[1] ) || ( items[2] && items[3] )
+        || ( items[4] && items[5] ) )
     {
         #ifdef DEBUG
         std::ostringstream ostr;
@@ -542,11 +709,11 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         return false;
     }
 
-    std::string name;
+    unsigned int id = 0;
 
     if( items[0] )
     {
-        if( S3D::SGTYPE_APPEARANCE != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_APPEARANCE != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -560,7 +727,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         m_Appearance = new SGAPPEARANCE( this );
-        m_Appearance->SetName( name.c_str() );
+        m_Appearance->SetID( id );
 
         if( !m_Appearance->ReadCache( aFile, this ) )
         {
@@ -568,7 +735,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading appearance '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -578,7 +745,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[1] )
     {
-        if( S3D::SGTYPE_APPEARANCE != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_APPEARANCE != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -591,7 +758,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* np = FindNode( name.c_str(), this );
+        SGNODE* np = FindNodeID( S3D::SGTYPE_APPEARANCE, id, this );
 
         if( !np )
         {
@@ -599,7 +766,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref appearance '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -612,7 +779,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not SGAPPEARANCE '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -625,7 +792,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[2] )
     {
-        if( S3D::SGTYPE_FACESET != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_FACESET != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -639,7 +806,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         }
 
         m_FaceSet = new SGFACESET( this );
-        m_FaceSet->SetName( name.c_str() );
+        m_FaceSet->SetID( id );
 
         if( !m_FaceSet->ReadCache( aFile, this ) )
         {
@@ -647,7 +814,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data while reading face set '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -657,7 +824,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 
     if( items[3] )
     {
-        if( S3D::SGTYPE_FACESET != S3D::ReadTag( aFile, name ) )
+        if( S3D::SGTYPE_FACESET != S3D::ReadTag( aFile, id ) )
         {
             #ifdef DEBUG
             std::ostringstream ostr;
@@ -670,7 +837,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             return false;
         }
 
-        SGNODE* np = FindNode( name.c_str(), this );
+        SGNODE* np = FindNodeID( S3D::SGTYPE_FACESET, id, this );
 
         if( !np )
         {
@@ -678,7 +845,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: cannot find ref face set '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -691,7 +858,7 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
             std::ostringstream ostr;
             ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
             ostr << " * [INFO] corrupt data: type is not SGFACESET '";
-            ostr << name << "'";
+            ostr << id << "'";
             wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
             #endif
 
@@ -702,6 +869,72 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
         m_RFaceSet->addNodeRef( this );
     }
 
+    if( items[4] )
+    {
+        if( S3D::SGTYPE_LINESET != S3D::ReadTag( aFile, id ) )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [INFO] corrupt data; bad child line set tag at position ";
+            ostr << aFile.tellg();
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+
+        m_LineSet = new SGLINESET( this );
+        m_LineSet->SetID( id );
+
+        if( !m_LineSet->ReadCache( aFile, this ) )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [INFO] corrupt data while reading line set '";
+            ostr << id << "'";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+    }
+
+    if( items[5] )
+    {
+        if( S3D::SGTYPE_LINESET != S3D::ReadTag( aFile, id ) )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [INFO] corrupt data; bad ref line set tag at position ";
+            ostr << aFile.tellg();
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+
+        SGNODE* np = FindNodeID( S3D::SGTYPE_LINESET, id, this );
+
+        if( !np || S3D::SGTYPE_LINESET != np->GetNodeType() )
+        {
+            #ifdef DEBUG
+            std::ostringstream ostr;
+            ostr << __FILE__ << ": " << __FUNCTION__ << ": " << __LINE__ << "\n";
+            ostr << " * [INFO] corrupt data: cannot find ref line set '";
+            ostr << id << "'";
+            wxLogTrace( MASK_3D_SG, "%s\n", ostr.str().c_str() );
+            #endif
+
+            return false;
+        }
+
+        m_RLineSet = (SGLINESET*)np;
+        m_RLineSet->addNodeRef( this );
+    }
+
     if( aFile.fail() )
         return false;
 
@@ -709,14 +942,221 @@ bool SGSHAPE::ReadCache( std::ifstream& aFile, SGNODE* parentNode )
 }
 
 
-bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
-    S3D::MATLIST& materials, std::vector< SMESH >& meshes )
+bool SGSHAPE::Prepare( const glm::dmat4* aTransform, S3D::MATLIST& materials,
+    std::vector< SMESH >& meshes, std::vector< SLINES >& lines )
+{
+    // the data prepared for a modified shape is stale for every transform;
+    // nothing is retained unless the caller asked for it
+    if( m_dirty || !materials.keep )
+        ReleasePrepared();
+
+    // entries which were not used by the previous run from the same root
+    // belong to transforms which have since changed or which no longer hold
+    // this shape; run numbers of different roots are unrelated so entries
+    // last used from another root are left alone
+    if( m_PrepareRoot != materials.root || m_PreparePass != materials.pass )
+    {
+        size_t j = 0;
+
+        for( size_t i = 0; i < m_Prepared.size(); ++i )
+        {
+            if( m_Prepared[i].root == materials.root
+                && materials.pass - m_Prepared[i].pass > 1 )
+            {
+                for( size_t k = 0; k < m_Prepared[i].meshes.size(); ++k )
+                    S3D::FREE_SMESH( m_Prepared[i].meshes[k] );
+
+                for( size_t k = 0; k < m_Prepared[i].lines.size(); ++k )
+                    S3D::FREE_SLINES( m_Prepared[i].lines[k] );
+
+                continue;
+            }
+
+            if( j != i )
+                std::swap( m_Prepared[j], m_Prepared[i] );
+
+            ++j;
+        }
+
+        m_Prepared.resize( j );
+        m_PrepareRoot = materials.root;
+        m_PreparePass = materials.pass;
+    }
+
+    glm::dmat4 tx( 1.0 );
+
+    if( NULL != aTransform )
+        tx = *aTransform;
+
+    PREPARED data;
+    PREPARED* pp = NULL;
+
+    for( size_t i = 0; i < m_Prepared.size() && NULL == pp; ++i )
+    {
+        if( m_Prepared[i].transform == tx )
+            pp = &m_Prepared[i];
+    }
+
+    if( NULL == pp )
+    {
+        if( materials.keep )
+        {
+            m_Prepared.push_back( PREPARED() );
+            pp = &m_Prepared.back();
+        }
+        else
+        {
+            pp = &data;
+        }
+
+        pp->transform = tx;
+        pp->material = false;
+
+        if( !prepareData( &tx, *pp ) )
+        {
+            for( size_t k = 0; k < pp->meshes.size(); ++k )
+                S3D::FREE_SMESH( pp->meshes[k] );
+
+            for( size_t k = 0; k < pp->lines.size(); ++k )
+                S3D::FREE_SLINES( pp->lines[k] );
+
+            if( materials.keep )
+                m_Prepared.pop_back();
+
+            return false;
+        }
+
+        markClean();
+    }
+
+    pp->root = materials.root;
+    pp->pass = materials.pass;
+
+    // the lookup registers the material in the same order as the
+    // original preparation of the data
+    int idx = 0;
+    SGAPPEARANCE* pa = m_Appearance;
+
+    if( NULL == pa )
+        pa = m_RAppearance;
+
+    if( pp->material && !S3D::GetMatIndex( materials, pa, idx ) )
+        idx = 0;
+
+    // retained data is copied; otherwise the new data is handed over as is
+    for( size_t i = 0; i < pp->meshes.size(); ++i )
+    {
+        SMESH m = pp->meshes[i];
+
+        if( materials.keep )
+            S3D::COPY_SMESH( m, pp->meshes[i] );
+
+        m.m_MaterialIdx = idx;
+        meshes.push_back( m );
+    }
+
+    for( size_t i = 0; i < pp->lines.size(); ++i )
+    {
+        SLINES l = pp->lines[i];
+
+        if( materials.keep )
+            S3D::COPY_SLINES( l, pp->lines[i] );
+
+        l.m_MaterialIdx = idx;
+        lines.push_back( l );
+    }
+
+    return true;
+}
+
+
+void SGSHAPE::ReleasePrepared( void )
+{
+    for( size_t i = 0; i < m_Prepared.size(); ++i )
+    {
+        for( size_t k = 0; k < m_Prepared[i].meshes.size(); ++k )
+            S3D::FREE_SMESH( m_Prepared[i].meshes[k] );
+
+        for( size_t k = 0; k < m_Prepared[i].lines.size(); ++k )
+            S3D::FREE_SLINES( m_Prepared[i].lines[k] );
+    }
+
+    m_Prepared.clear();
+    return;
+}
+
+
+size_t SGSHAPE::GetPreparedSize( void ) const
+{
+    size_t bytes = 0;
+
+    for( size_t i = 0; i < m_Prepared.size(); ++i )
+    {
+        bytes += sizeof( PREPARED );
+
+        for( size_t k = 0; k < m_Prepared[i].meshes.size(); ++k )
+        {
+            const SMESH& m = m_Prepared[i].meshes[k];
+            bytes += sizeof( SMESH ) + m.m_FaceIdxSize * sizeof( unsigned int );
+            bytes += m.m_VertexSize * sizeof( SFVEC3F ) * ( m.m_Color ? 3 : 2 );
+
+            if( m.m_Texcoords )
+                bytes += m.m_VertexSize * sizeof( SFVEC2F );
+        }
+
+        for( size_t k = 0; k < m_Prepared[i].lines.size(); ++k )
+        {
+            const SLINES& l = m_Prepared[i].lines[k];
+            bytes += sizeof( SLINES ) + l.m_LineIdxSize * sizeof( unsigned int );
+            bytes += l.m_VertexSize * sizeof( SFVEC3F );
+        }
+    }
+
+    return bytes;
+}
+
+
+void SGSHAPE::markClean( void )
+{
+    // the shape and the nodes holding its data now match the prepared data
+    clearDirty();
+
+    SGAPPEARANCE* pa = m_Appearance ? m_Appearance : m_RAppearance;
+    SGFACESET* pf = m_FaceSet ? m_FaceSet : m_RFaceSet;
+    SGLINESET* pl = m_LineSet ? m_LineSet : m_RLineSet;
+
+    if( pa )
+        pa->clearDirty();
+
+    if( pl )
+        pl->clearDirty();
+
+    if( NULL == pf )
+        return;
+
+    pf->clearDirty();
+
+    SGNODE* data[] = { pf->m_Coords, pf->m_RCoords, pf->m_Normals, pf->m_RNormals,
+                       pf->m_Colors, pf->m_RColors, pf->m_CoordIndices };
+
+    for( size_t i = 0; i < sizeof( data ) / sizeof( data[0] ); ++i )
+    {
+        if( data[i] )
+            data[i]->clearDirty();
+    }
+
+    return;
+}
+
+
+bool SGSHAPE::prepareData( const glm::dmat4* aTransform, PREPARED& aData )
 {
     SMESH m;
     S3D::INIT_SMESH( m );
 
     SGAPPEARANCE* pa = m_Appearance;
     SGFACESET* pf = m_FaceSet;
+    SGLINESET* pl = m_LineSet;
 
     if( NULL == pa )
         pa = m_RAppearance;
@@ -724,6 +1164,15 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
     if( NULL == pf )
         pf = m_RFaceSet;
 
+    if( NULL == pl )
+        pl = m_RLineSet;
+
+    if( NULL != pl )
+    {
+        aData.material = ( NULL != pa );
+        return pl->Prepare( aTransform, 0, aData.lines );
+    }
+
     // no face sets = nothing to render, which is valid though pointless
     if( NULL == pf )
         return true;
@@ -739,23 +1188,8 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
         return true;
     }
 
-    if( NULL == pa )
-    {
-        m.m_MaterialIdx = 0;
-    }
-    else
-    {
-        int idx;
-
-        if( !S3D::GetMatIndex( materials, pa, idx ) )
-        {
-            m.m_MaterialIdx = 0;
-        }
-        else
-        {
-            m.m_MaterialIdx = idx;
-        }
-    }
+    // the material index is assigned by Prepare()
+    aData.material = ( NULL != pa );
 
     SGCOLORS* pc = pf->m_Colors;
     SGCOORDS* pv = pf->m_Coords;
@@ -771,18 +1205,27 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
     if( NULL == pn )
         pn = pf->m_RNormals;
 
-    // set the vertex points and indices
-    size_t nCoords = 0;
-    SGPOINT* pCoords = NULL;
-    pv->GetCoordsList( nCoords, pCoords );
+    // set the vertex points and indices; the vertices and normals
+    // may be held in either single or double precision. The data is
+    // only read so it is accessed directly rather than via the Get*()
+    // functions, which would make private copies of shared buffers.
+    size_t nCoords = pv->GetSize();
+    const SGPOINT* pCoords = NULL;
+    const SFVEC3F* fCoords = NULL;
+
+    if( pv->IsSinglePrecision() )
+        fCoords = pv->fcoords.data();
+    else
+        pCoords = pv->coords.data();
 
     size_t nColors = 0;
-    SGCOLOR* pColors = NULL;
+    const SGCOLOR* pColors = NULL;
 
     if( pc )
     {
         // check the vertex colors
-        pc->GetColorList( nColors, pColors );
+        nColors = pc->colors.size();
+        pColors = pc->colors.data();
 
         if( nColors < nCoords )
         {
@@ -798,23 +1241,23 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
     }
 
     // set the vertex indices
-    size_t nvidx = 0;
-    int*   lv = NULL;
-    vidx->GetIndices( nvidx, lv );
+    size_t nvidx = vidx->GetSize();
 
     // note: reduce the vertex set to include only the referenced vertices
     std::vector< int > vertices;            // store the list of temp vertex indices
     std::map< int, unsigned int > indexmap; // map temp vertex to true vertex
     std::map< int, unsigned int >::iterator mit;
+    int ti;
 
     for( unsigned int i = 0; i < nvidx; ++i )
     {
-        mit = indexmap.find( lv[i] );
+        ti = vidx->GetIndex( i );
+        mit = indexmap.find( ti );
 
         if( mit == indexmap.end() )
         {
-            indexmap.insert( std::pair< int, unsigned int >( lv[i], vertices.size() ) );
-            vertices.push_back( lv[i] );
+            indexmap.insert( std::pair< int, unsigned int >( ti, vertices.size() ) );
+            vertices.push_back( ti );
         }
     }
 
@@ -832,7 +1275,6 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
     // construct the final vertex/color list
     SFVEC3F* lColors = NULL;
     SFVEC3F* lCoords = new SFVEC3F[ vertices.size() ];
-    int ti;
 
     if( pc )
     {
@@ -841,14 +1283,13 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
     }
 
 
-    if( pc )
+    if( fCoords )
     {
         for( size_t i = 0; i < vertices.size(); ++i )
         {
             ti = vertices[i];
-            glm::dvec4 pt( pCoords[ti].x, pCoords[ti].y, pCoords[ti].z, 1.0 );
+            glm::dvec4 pt( fCoords[ti].x, fCoords[ti].y, fCoords[ti].z, 1.0 );
             pt = (*aTransform) * pt;
-            pColors[ti].GetColor( lColors[i].x, lColors[i].y, lColors[i].z );
             lCoords[i] = SFVEC3F( pt.x, pt.y, pt.z );
         }
     }
@@ -863,13 +1304,31 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
         }
     }
 
+    if( pc )
+    {
+        for( size_t i = 0; i < vertices.size(); ++i )
+        {
+            ti = vertices[i];
+            pColors[ti].GetColor( lColors[i].x, lColors[i].y, lColors[i].z );
+        }
+    }
+
     m.m_VertexSize = (unsigned int) vertices.size();
     m.m_Positions = lCoords;
+    m.m_BBoxMin = lCoords[0];
+    m.m_BBoxMax = lCoords[0];
+
+    for( size_t i = 1; i < vertices.size(); ++i )
+    {
+        m.m_BBoxMin = glm::min( m.m_BBoxMin, lCoords[i] );
+        m.m_BBoxMax = glm::max( m.m_BBoxMax, lCoords[i] );
+    }
+
     unsigned int* lvidx = new unsigned int[ nvidx ];
 
     for( unsigned int i = 0; i < nvidx; ++i )
     {
-        mit = indexmap.find( lv[i] );
+        mit = indexmap.find( vidx->GetIndex( i ) );
         lvidx[i] = mit->second;
     }
 
@@ -877,25 +1336,392 @@ bool SGSHAPE::Prepare( const glm::dmat4* aTransform,
     m.m_FaceIdx = lvidx;
 
     // set the per-vertex normals
-    size_t nNorms = 0;
-    SGVECTOR* pNorms = NULL;
-    double x, y, z;
-
-    pn->GetNormalList( nNorms, pNorms );
     SFVEC3F* lNorms = new SFVEC3F[ vertices.size() ];
 
-    for( size_t i = 0; i < vertices.size(); ++i )
+    if( NULL == pn )
+    {
+        // the face set carries no normals; they are derived from the
+        // transformed triangles so that they remain correct under any
+        // scaling. A mirroring transform reverses the winding of the
+        // triangles and hence the direction of the computed normals.
+        std::vector< glm::dvec3 > lSums( vertices.size(), glm::dvec3( 0.0, 0.0, 0.0 ) );
+
+        S3D::AccumulateNormals( lCoords, vertices.size(), m.m_FaceIdx, nvidx,
+            &lSums[0], S3D::NORMALWEIGHT_AREA );
+
+        glm::dvec3 axes[3];
+
+        for( int i = 0; i < 3; ++i )
+            axes[i] = glm::dvec3( (*aTransform)[i][0], (*aTransform)[i][1],
+                (*aTransform)[i][2] );
+
+        double sense = glm::dot( axes[0], glm::cross( axes[1], axes[2] ) ) < 0.0 ? -1.0 : 1.0;
+
+        for( size_t i = 0; i < vertices.size(); ++i )
+        {
+            double len = glm::length( lSums[i] );
+
+            if( len > 0.0 )
+                lNorms[i] = SFVEC3F( lSums[i] * ( sense / len ) );
+            else
+                lNorms[i] = SFVEC3F( 0.0, 0.0, 1.0 );
+        }
+    }
+    else
     {
-        ti = vertices[i];
-        pNorms[ti].GetVector( x, y, z );
-        glm::dvec4 pt( x, y, z, 0.0 );
-        pt = (*aTransform) * pt;
+        const SGVECTOR* pNorms = NULL;
+        const SFVEC3F* fNorms = NULL;
+        double x, y, z;
+
+        if( pn->IsSinglePrecision() )
+            fNorms = pn->fnorms.data();
+        else
+            pNorms = pn->norms.data();
+
+        for( size_t i = 0; i < vertices.size(); ++i )
+        {
+            ti = vertices[i];
+
+            if( fNorms )
+            {
+                x = fNorms[ti].x;
+                y = fNorms[ti].y;
+                z = fNorms[ti].z;
+            }
+            else
+            {
+                pNorms[ti].GetVector( x, y, z );
+            }
 
-        lNorms[i] = SFVEC3F( pt.x, pt.y, pt.z );
+            glm::dvec4 pt( x, y, z, 0.0 );
+            pt = (*aTransform) * pt;
+
+            lNorms[i] = SFVEC3F( pt.x, pt.y, pt.z );
+        }
     }
 
     m.m_Normals = lNorms;
-    meshes.push_back( m );
+    aData.meshes.push_back( m );
+
+    return true;
+}
+
+
+template< typename T >
+static void tallyShared( const SGBUFFER< T >& aBuffer, std::map< const void*, long >& aShared )
+{
+    if( !aBuffer.IsShared() )
+        return;
+
+    std::map< const void*, long >::iterator it = aShared.find( aBuffer.data() );
+
+    if( it == aShared.end() )
+        it = aShared.insert( std::make_pair( (const void*) aBuffer.data(),
+                                             aBuffer.Holders() ) ).first;
+
+    --it->second;
+
+    return;
+}
+
+
+bool SGSHAPE::CanBake( std::map< const void*, long >& aShared ) const
+{
+    // the geometry may only be modified in place if no other
+    // node is able to see it
+    if( isReferenced() || NULL != m_RFaceSet || NULL != m_RLineSet )
+        return false;
+
+    if( NULL != m_FaceSet )
+    {
+        if( m_FaceSet->isReferenced() || NULL != m_FaceSet->m_RCoords
+            || NULL != m_FaceSet->m_RNormals )
+            return false;
+
+        if( NULL != m_FaceSet->m_Coords )
+        {
+            if( m_FaceSet->m_Coords->isReferenced() )
+                return false;
+
+            tallyShared( m_FaceSet->m_Coords->coords, aShared );
+            tallyShared( m_FaceSet->m_Coords->fcoords, aShared );
+        }
+
+        if( NULL != m_FaceSet->m_Normals )
+        {
+            if( m_FaceSet->m_Normals->isReferenced() )
+                return false;
+
+            tallyShared( m_FaceSet->m_Normals->norms, aShared );
+            tallyShared( m_FaceSet->m_Normals->fnorms, aShared );
+        }
+    }
+
+    if( NULL != m_LineSet && m_LineSet->isReferenced() )
+        return false;
+
+    return true;
+}
+
+
+static void bakePoints( std::vector< SGPOINT >& aPoints, const glm::dmat4& aTransform )
+{
+    std::vector< SGPOINT >::iterator sP = aPoints.begin();
+    std::vector< SGPOINT >::iterator eP = aPoints.end();
+
+    while( sP != eP )
+    {
+        glm::dvec4 pt = aTransform * glm::dvec4( sP->x, sP->y, sP->z, 1.0 );
+        sP->x = pt.x;
+        sP->y = pt.y;
+        sP->z = pt.z;
+        ++sP;
+    }
+
+    return;
+}
+
+
+static void bakeFPoints( std::vector< SFVEC3F >& aPoints, const glm::dmat4& aTransform )
+{
+    std::vector< SFVEC3F >::iterator sF = aPoints.begin();
+    std::vector< SFVEC3F >::iterator eF = aPoints.end();
+
+    while( sF != eF )
+    {
+        glm::dvec4 pt = aTransform * glm::dvec4( sF->x, sF->y, sF->z, 1.0 );
+        *sF = SFVEC3F( pt.x, pt.y, pt.z );
+        ++sF;
+    }
+
+    return;
+}
+
+
+// the transform is rigid so normals only need to be rotated
+static void bakeNormals( std::vector< SGVECTOR >& aNorms, const glm::dmat4& aTransform )
+{
+    std::vector< SGVECTOR >::iterator sN = aNorms.begin();
+    std::vector< SGVECTOR >::iterator eN = aNorms.end();
+    double nX, nY, nZ;
+
+    while( sN != eN )
+    {
+        sN->GetVector( nX, nY, nZ );
+        glm::dvec4 nv = aTransform * glm::dvec4( nX, nY, nZ, 0.0 );
+        *sN = SGVECTOR( nv.x, nv.y, nv.z );
+        ++sN;
+    }
+
+    return;
+}
+
+
+static void bakeFNormals( std::vector< SFVEC3F >& aNorms, const glm::dmat4& aTransform )
+{
+    std::vector< SFVEC3F >::iterator sF = aNorms.begin();
+    std::vector< SFVEC3F >::iterator eF = aNorms.end();
+
+    while( sF != eF )
+    {
+        glm::dvec4 nv = aTransform * glm::dvec4( sF->x, sF->y, sF->z, 0.0 );
+        *sF = SFVEC3F( nv.x, nv.y, nv.z );
+        ++sF;
+    }
+
+    return;
+}
+
+
+// transforms the array held by aBuffer unless the same array was already
+// transformed for another holder, in which case that result is shared
+template< typename T >
+static void bakeBuffer( SGBUFFER< T >& aBuffer, std::map< const T*, SGBUFFER< T >* >& aBaked,
+    void (*aBake)( std::vector< T >&, const glm::dmat4& ), const glm::dmat4& aTransform )
+{
+    if( aBuffer.empty() )
+        return;
+
+    const T* key = aBuffer.data();
+    typename std::map< const T*, SGBUFFER< T >* >::iterator it = aBaked.find( key );
+
+    if( it != aBaked.end() )
+    {
+        aBuffer.Share( *it->second );
+        return;
+    }
+
+    aBake( aBuffer.Edit(), aTransform );
+
+    if( aBuffer.data() != key )
+        aBaked[key] = &aBuffer;
+
+    return;
+}
+
+
+void SGSHAPE::Bake( const glm::dmat4& aTransform, SGBAKED& aBaked )
+{
+    setDirty();
+
+    if( NULL != m_FaceSet && NULL != m_FaceSet->m_Coords )
+    {
+        bakeBuffer( m_FaceSet->m_Coords->coords, aBaked.points, bakePoints, aTransform );
+        bakeBuffer( m_FaceSet->m_Coords->fcoords, aBaked.fvectors, bakeFPoints, aTransform );
+    }
+
+    if( NULL != m_FaceSet && NULL != m_FaceSet->m_Normals )
+    {
+        bakeBuffer( m_FaceSet->m_Normals->norms, aBaked.vectors, bakeNormals, aTransform );
+        bakeBuffer( m_FaceSet->m_Normals->fnorms, aBaked.fvectors, bakeFNormals, aTransform );
+    }
+
+    if( NULL != m_LineSet )
+        bakePoints( m_LineSet->coords, aTransform );
+
+    return;
+}
+
+
+static void expandBounds( SGPOINT& aMin, SGPOINT& aMax, double aX, double aY, double aZ )
+{
+    if( aX < aMin.x )
+        aMin.x = aX;
+
+    if( aX > aMax.x )
+        aMax.x = aX;
+
+    if( aY < aMin.y )
+        aMin.y = aY;
+
+    if( aY > aMax.y )
+        aMax.y = aY;
+
+    if( aZ < aMin.z )
+        aMin.z = aZ;
+
+    if( aZ > aMax.z )
+        aMax.z = aZ;
+
+    return;
+}
+
+
+void SGSHAPE::calcBounds( void )
+{
+    m_HasBounds = false;
+    m_BBoxMin = SGPOINT( 0.0, 0.0, 0.0 );
+    m_BBoxMax = SGPOINT( 0.0, 0.0, 0.0 );
+
+    SGFACESET* pf = m_FaceSet ? m_FaceSet : m_RFaceSet;
+    SGLINESET* pl = m_LineSet ? m_LineSet : m_RLineSet;
+
+    // only the indexed vertices are bounded since coordinate lists
+    // may be shared by several shapes; invalid indices are skipped
+    // here and rejected later by Prepare()
+    const int* idx = NULL;
+    const SGCOORDINDEX* pidx = NULL;
+    size_t nidx = 0;
+    const SGPOINT* pCoords = NULL;
+    const SFVEC3F* fCoords = NULL;
+    size_t ncoords = 0;
+
+    if( NULL != pf )
+    {
+        SGCOORDS* pc = pf->m_Coords ? pf->m_Coords : pf->m_RCoords;
+        SGCOORDINDEX* pi = pf->m_CoordIndices;
+
+        pf->setBounded();
+
+        if( NULL != pc && NULL != pi )
+        {
+            pc->setBounded();
+            pi->setBounded();
+            pidx = pi;
+            nidx = pi->GetSize();
+            ncoords = pc->GetSize();
+
+            if( pc->IsSinglePrecision() )
+                fCoords = pc->fcoords.data();
+            else
+                pCoords = pc->coords.data();
+        }
+    }
+    else if( NULL != pl )
+    {
+        pl->setBounded();
+
+        if( !pl->index.empty() )
+        {
+            idx = &pl->index[0];
+            nidx = pl->index.size();
+            ncoords = pl->coords.size();
+            pCoords = ncoords ? &pl->coords[0] : NULL;
+        }
+    }
+
+    for( size_t i = 0; i < nidx; ++i )
+    {
+        int ti = pidx ? pidx->GetIndex( i ) : idx[i];
+
+        if( ti < 0 || (size_t)ti >= ncoords )
+            continue;
+
+        double x, y, z;
+
+        if( fCoords )
+        {
+            x = fCoords[ti].x;
+            y = fCoords[ti].y;
+            z = fCoords[ti].z;
+        }
+        else
+        {
+            x = pCoords[ti].x;
+            y = pCoords[ti].y;
+            z = pCoords[ti].z;
+        }
+
+        if( !m_HasBounds )
+        {
+            m_BBoxMin = SGPOINT( x, y, z );
+            m_BBoxMax = m_BBoxMin;
+            m_HasBounds = true;
+            continue;
+        }
+
+        expandBounds( m_BBoxMin, m_BBoxMax, x, y, z );
+    }
+
+    setBounded();
+
+    return;
+}
+
+
+bool SGSHAPE::GetBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( !m_bounded )
+        calcBounds();
+
+    aMin = m_BBoxMin;
+    aMax = m_BBoxMax;
+
+    return m_HasBounds;
+}
+
+
+bool SGSHAPE::GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax )
+{
+    if( !GetBounds( aMin, aMax ) )
+        return false;
+
+    if( NULL != m_Parent )
+    {
+        glm::dmat4 tx;
+        ( (SCENEGRAPH*)m_Parent )->GetWorldTransform( tx );
+        S3D::TransformBounds( tx, aMin, aMax );
+    }
 
     return true;
 }
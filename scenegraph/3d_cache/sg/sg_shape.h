@@ -30,29 +30,73 @@
 #ifndef SG_SHAPE_H
 #define SG_SHAPE_H
 
+#include <map>
 #include <vector>
 #include "3d_cache/sg/sg_node.h"
+#include "3d_cache/sg/sg_buffer.h"
 
 class SGAPPEARANCE;
 class SGFACESET;
+class SGLINESET;
+
+// geometry arrays transformed by SGSHAPE::Bake() keyed by the data which
+// they held before, so that shapes baked together which shared an array
+// share the transformed array as well
+struct SGBAKED
+{
+    std::map< const SGPOINT*, SGBUFFER< SGPOINT >* > points;
+    std::map< const SGVECTOR*, SGBUFFER< SGVECTOR >* > vectors;
+    std::map< const SFVEC3F*, SGBUFFER< SFVEC3F >* > fvectors;
+};
 
 class SGSHAPE : public SGNODE
 {
 private:
+    // geometry produced by Prepare() for one transform; the material
+    // index is assigned on every use since it depends on the whole model
+    struct PREPARED
+    {
+        glm::dmat4 transform;
+        SGNODE const* root;         // the node which started the last run to use the entry
+        unsigned int pass;          // the sequence number of that run
+        bool material;              // true if the appearance is assigned a material index
+        std::vector< SMESH > meshes;
+        std::vector< SLINES > lines;
+    };
+
+    // one entry per transform since a shape may be instanced by several
+    // transforms; all entries are discarded once the shape is modified
+    std::vector< PREPARED > m_Prepared;
+    SGNODE const* m_PrepareRoot;    // the node which started the last Prepare() run
+    unsigned int m_PreparePass;     // to visit this shape and the number of that run
+
+    // extent of the geometry in the coordinate system of the shape;
+    // it is valid while the node is flagged as bounded
+    SGPOINT m_BBoxMin;
+    SGPOINT m_BBoxMax;
+    bool m_HasBounds;               // false if there is no geometry to bound
+
     void unlinkNode( const SGNODE* aNode, bool isChild );
     bool addNode( SGNODE* aNode, bool isChild );
+    bool prepareData( const glm::dmat4* aTransform, PREPARED& aData );
+    void markClean( void );
+    void calcBounds( void );
 
 public:
     // owned node
     SGAPPEARANCE* m_Appearance;
     SGFACESET*    m_FaceSet;
+    SGLINESET*    m_LineSet;
 
     // referenced nodes
     SGAPPEARANCE* m_RAppearance;
     SGFACESET*    m_RFaceSet;
+    SGLINESET*    m_RLineSet;
 
     void unlinkChildNode( const SGNODE* aNode );
     void unlinkRefNode( const SGNODE* aNode );
+    void getLinkedNodes( std::vector< SGNODE* >& aChildren,
+        std::vector< SGNODE* >& aRefs ) const;
 
 public:
     SGSHAPE( SGNODE* aParent );
@@ -64,14 +108,78 @@ public:
     bool AddRefNode( SGNODE* aNode );
     bool AddChildNode( SGNODE* aNode );
 
-    void ReNameNodes( void );
+    void ReNameNodes( S3D::NAMECTX& aNames );
     bool WriteVRML( std::ofstream& aFile, bool aReuseFlag );
 
     bool WriteCache( std::ofstream& aFile, SGNODE* parentNode );
     bool ReadCache( std::ifstream& aFile, SGNODE* parentNode );
 
-    bool Prepare( const glm::dmat4* aTransform,
-        S3D::MATLIST& materials, std::vector< SMESH >& meshes );
+    /**
+     * Function Prepare
+     * appends the meshes or lines of this shape, transformed by aTransform,
+     * to the given lists. If materials.keep is set the result is kept for
+     * each transform so that subsequent calls only copy it until the shape
+     * or its data changes.
+     */
+    bool Prepare( const glm::dmat4* aTransform, S3D::MATLIST& materials,
+        std::vector< SMESH >& meshes, std::vector< SLINES >& lines );
+
+    /**
+     * Function ReleasePrepared
+     * frees the data kept by Prepare()
+     */
+    void ReleasePrepared( void );
+
+    /**
+     * Function GetPreparedSize
+     * returns the number of bytes held by the data kept by Prepare()
+     */
+    size_t GetPreparedSize( void ) const;
+
+    /**
+     * Function GetBounds
+     * retrieves the axis aligned bounds of the vertices used by this shape
+     * in the coordinate system of the shape. The bounds are computed on
+     * first use and kept until the shape or its data changes.
+     *
+     * @return false if the shape has no geometry
+     */
+    bool GetBounds( SGPOINT& aMin, SGPOINT& aMax );
+
+    /**
+     * Function GetWorldBounds
+     * retrieves the bounds of this shape with the transforms of its parent
+     * and all further ancestors applied; a shape which is also referenced
+     * by other transforms is bounded at the position given by its owner.
+     *
+     * @return false if the shape has no geometry
+     */
+    bool GetWorldBounds( SGPOINT& aMin, SGPOINT& aMax );
+
+    /**
+     * Function CanBake
+     * returns true if the geometry of this shape is used only by
+     * this shape so that a transform may be applied to it in place.
+     * Geometry arrays which are shared with other buffers are tallied
+     * in aShared as the number of holders not yet accounted for; the
+     * caller must also ensure that every such count drops to zero, i.e.
+     * that the arrays are held only by the shapes which are baked together.
+     *
+     * @param aShared maps the data of each shared array to its remaining holders
+     */
+    bool CanBake( std::map< const void*, long >& aShared ) const;
+
+    /**
+     * Function Bake
+     * applies the given rigid transform to the vertices and normals
+     * held by this shape; the caller must first ensure CanBake() is true.
+     * An array already transformed for another shape is shared rather
+     * than transformed again.
+     *
+     * @param aTransform is the transform to apply
+     * @param aBaked holds the arrays transformed by the current bake
+     */
+    void Bake( const glm::dmat4& aTransform, SGBAKED& aBaked );
 };
 
 /*